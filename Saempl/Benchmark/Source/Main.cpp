@@ -0,0 +1,51 @@
+/*
+ ==============================================================================
+ 
+ Main.cpp
+ Author:  Jonas Blome
+ 
+ ==============================================================================
+ */
+
+#include "JuceHeader.h"
+#include "../../Source/SampleGridClusterer.h"
+
+/**
+ Clusters synthetic sample collections headlessly and prints the speed and layout quality of each run.
+ 
+ Usage: SaemplBenchmark [--samples N] [--dimensions N] [--seed N] [--runs N]
+ */
+int main(int argc, char* argv[])
+{
+    ArgumentList arguments(argc, argv);
+    int numSamples = arguments.containsOption("--samples") ? arguments.getValueForOption("--samples").getIntValue() : 2000;
+    int numDimensions = arguments.containsOption("--dimensions") ? arguments.getValueForOption("--dimensions").getIntValue() : 40;
+    int seed = arguments.containsOption("--seed") ? arguments.getValueForOption("--seed").getIntValue() : 1;
+    int numRuns = arguments.containsOption("--runs") ? arguments.getValueForOption("--runs").getIntValue() : 3;
+    
+    if (numSamples < SampleGridClusterer::minNumBenchmarkSamples || numDimensions <= 0 || seed <= 0 || numRuns <= 0)
+    {
+        std::cerr << "Usage: SaemplBenchmark [--samples N] [--dimensions N] [--seed N] [--runs N]" << std::endl;
+        std::cerr << "At least " << SampleGridClusterer::minNumBenchmarkSamples << " samples are needed" << std::endl;
+        return 1;
+    }
+    
+    // The clusterer is a progress window thread, so it needs the message manager even without a window
+    ScopedJuceInitialiser_GUI juceInitialiser;
+    SampleGridClusterer gridClusterer;
+    
+    std::cout << "Clustering " << numSamples << " samples with " << numDimensions << " dimensions" << std::endl;
+    
+    for (int r = 0; r < numRuns; r++)
+    {
+        // Every run uses the next seed, so the runs cover different collections of the same size
+        SampleGridClusterer::BenchmarkResult result = gridClusterer.runBenchmark(numSamples, numDimensions, (unsigned) (seed + r));
+        std::cout << "Run " << r + 1
+        << ": wall time " << String(result.wallTimeSeconds, 3) << " s"
+        << ", " << result.numCheckedSwaps << " swaps"
+        << ", " << String(result.swapsPerSecond, 0) << " swaps/s"
+        << ", DPQ " << String(result.distancePreservationQuality, 4) << std::endl;
+    }
+    
+    return 0;
+}
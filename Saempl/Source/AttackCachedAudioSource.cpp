@@ -0,0 +1,86 @@
+/*
+ ==============================================================================
+ 
+ AttackCachedAudioSource.cpp
+ Author:  Jonas Blome
+ 
+ ==============================================================================
+ */
+
+#include "AttackCachedAudioSource.h"
+
+AttackCachedAudioSource::AttackCachedAudioSource(std::shared_ptr<AudioBuffer<float> const> inAttack,
+                                                 PositionableAudioSource& inStreamingSource)
+:
+mAttack(inAttack),
+streamingSource(inStreamingSource),
+nextReadPosition(0)
+{
+    
+}
+
+AttackCachedAudioSource::~AttackCachedAudioSource()
+{
+    
+}
+
+void AttackCachedAudioSource::prepareToPlay(int samplesPerBlockExpected, double sampleRate)
+{
+    streamingSource.prepareToPlay(samplesPerBlockExpected, sampleRate);
+}
+
+void AttackCachedAudioSource::releaseResources()
+{
+    streamingSource.releaseResources();
+}
+
+void AttackCachedAudioSource::getNextAudioBlock(AudioSourceChannelInfo const & bufferToFill)
+{
+    AudioBuffer<float> const & attackBuffer = *mAttack;
+    int numCachedSamples = (int) jlimit<int64>(0, bufferToFill.numSamples, attackBuffer.getNumSamples() - nextReadPosition);
+    
+    // Copy the part of the block that lies inside the cached attack
+    if (numCachedSamples > 0)
+    {
+        for (int ch = 0; ch < bufferToFill.buffer->getNumChannels(); ch++)
+        {
+            bufferToFill.buffer->copyFrom(ch,
+                                          bufferToFill.startSample,
+                                          attackBuffer,
+                                          jmin<int>(ch, attackBuffer.getNumChannels() - 1),
+                                          (int) nextReadPosition,
+                                          numCachedSamples);
+        }
+    }
+    
+    // Stream the rest of the block from the file
+    if (numCachedSamples < bufferToFill.numSamples)
+    {
+        streamingSource.setNextReadPosition(nextReadPosition + numCachedSamples);
+        streamingSource.getNextAudioBlock(AudioSourceChannelInfo(bufferToFill.buffer,
+                                                                 bufferToFill.startSample + numCachedSamples,
+                                                                 bufferToFill.numSamples - numCachedSamples));
+    }
+    
+    nextReadPosition += bufferToFill.numSamples;
+}
+
+void AttackCachedAudioSource::setNextReadPosition(int64 newPosition)
+{
+    nextReadPosition = newPosition;
+}
+
+int64 AttackCachedAudioSource::getNextReadPosition() const
+{
+    return nextReadPosition;
+}
+
+int64 AttackCachedAudioSource::getTotalLength() const
+{
+    return streamingSource.getTotalLength();
+}
+
+bool AttackCachedAudioSource::isLooping() const
+{
+    return false;
+}
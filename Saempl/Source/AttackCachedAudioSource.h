@@ -0,0 +1,42 @@
+/*
+ ==============================================================================
+ 
+ AttackCachedAudioSource.h
+ Author:  Jonas Blome
+ 
+ ==============================================================================
+ */
+
+#pragma once
+
+#include "JuceHeader.h"
+
+/**
+ Plays the cached attack of a sample from memory and continues with the streaming reader after it.
+ */
+class AttackCachedAudioSource
+:
+public PositionableAudioSource
+{
+public:
+    /**
+     @param inAttack the decoded first samples of the file, at the file's sample rate.
+     @param inStreamingSource the source that reads the whole file.
+     */
+    AttackCachedAudioSource(std::shared_ptr<AudioBuffer<float> const> inAttack, PositionableAudioSource& inStreamingSource);
+    ~AttackCachedAudioSource();
+    void prepareToPlay(int samplesPerBlockExpected, double sampleRate) override;
+    void releaseResources() override;
+    void getNextAudioBlock(AudioSourceChannelInfo const & bufferToFill) override;
+    void setNextReadPosition(int64 newPosition) override;
+    int64 getNextReadPosition() const override;
+    int64 getTotalLength() const override;
+    bool isLooping() const override;
+    
+private:
+    std::shared_ptr<AudioBuffer<float> const> mAttack;
+    PositionableAudioSource& streamingSource;
+    int64 nextReadPosition;
+    
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(AttackCachedAudioSource);
+};
@@ -9,7 +9,9 @@
 
 #include "AudioPlayer.h"
 
-AudioPlayer::AudioPlayer()
+AudioPlayer::AudioPlayer(SamplePreviewVoice& inPreviewVoice)
+:
+previewVoice(inPreviewVoice)
 {
     // Create thread for the audio player
     mThread = std::make_unique<TimeSliceThread>("AudioPlayerThread");
@@ -19,26 +21,46 @@ AudioPlayer::AudioPlayer()
     currentMaxLevel = 0.0;
     currentUserLevel = 1.0;
     currentNormalisationGain = 1.0;
+    mPlaysThroughHost = false;
+    mFollowsDefaultDevice = false;
+    deviceIsFadingIn = false;
+    mUsesPreviewVoice = false;
+    attackCacheBudget = 64 * 1024 * 1024;
+    attackCacheSize = 0;
+    numAttackCacheHits = 0;
+    numAttackCacheMisses = 0;
     mFormatManager = std::make_unique<AudioFormatManager>();
     mTransportSource = std::make_unique<AudioTransportSource>();
     mAudioDeviceManager = std::make_unique<AudioDeviceManager>();
+    mDeviceThreadPool = std::make_unique<ThreadPool>(1);
     mAudioSourcePlayer = std::make_unique<AudioSourcePlayer>();
-    initialiseDefaultDevice();
     mFormatManager->registerBasicFormats();
+    
+    // Create thread for prefetching sample attacks once the formats are known
+    mPrefetchThread = std::make_unique<TimeSliceThread>("AudioPlayerPrefetchThread");
+    mPrefetchThread->addTimeSliceClient(this);
+    mPrefetchThread->startThread(Thread::Priority::low);
+    
     mAudioDeviceManager->addAudioCallback(&*mAudioSourcePlayer);
+    mAudioDeviceManager->addAudioCallback(this);
     mAudioSourcePlayer->setSource(&*mTransportSource);
-    // Start timer to automatically switch audio device along with the current system output
-    // Currently deactivated to enable custom audio output device option
-    // startTimerHz(5);
+    
+    // Get notified about added and removed devices instead of polling the device types
+    mAudioDeviceManager->addChangeListener(this);
 }
 
 AudioPlayer::~AudioPlayer()
 {
-    mTransportSource->setSource(nullptr);
+    mAudioDeviceManager->removeChangeListener(this);
+    mDeviceThreadPool->removeAllJobs(false, 10000);
+    cancelPendingUpdate();
+    mPrefetchThread->removeTimeSliceClient(this);
+    mPrefetchThread->stopThread(10000);
+    releaseCurrentSources();
     mAudioSourcePlayer->setSource(nullptr);
+    mAudioDeviceManager->removeAudioCallback(this);
     mAudioDeviceManager->removeAudioCallback(&*mAudioSourcePlayer);
     mThread->stopThread(10000);
-    stopTimer();
 }
 
 AudioFormatManager& AudioPlayer::getFormatManager()
@@ -48,6 +70,21 @@ AudioFormatManager& AudioPlayer::getFormatManager()
 
 void AudioPlayer::startOrStop()
 {
+    if (mUsesPreviewVoice)
+    {
+        if (previewVoice.isPlaying())
+        {
+            previewVoice.stop();
+        }
+        else
+        {
+            previewVoice.setPosition(0);
+            previewVoice.start();
+        }
+        
+        return;
+    }
+    
     if (mTransportSource->isPlaying())
     {
         mTransportSource->stop();
@@ -61,35 +98,103 @@ void AudioPlayer::startOrStop()
 
 void AudioPlayer::setTransportSourcePosition(double inPosition)
 {
+    if (mUsesPreviewVoice)
+    {
+        previewVoice.setPosition(inPosition);
+        return;
+    }
+    
     mTransportSource->setPosition(inPosition);
 }
 
 void AudioPlayer::start()
 {
+    if (mUsesPreviewVoice)
+    {
+        previewVoice.start();
+        return;
+    }
+    
     mTransportSource->start();
 }
 
 bool AudioPlayer::isPlaying()
 {
-    return mTransportSource->isPlaying();
+    return mUsesPreviewVoice ? previewVoice.isPlaying() : mTransportSource->isPlaying();
 }
 
 double AudioPlayer::getCurrentPosition()
 {
-    return mTransportSource->getCurrentPosition();
+    return mUsesPreviewVoice ? previewVoice.getPosition() : mTransportSource->getCurrentPosition();
 }
 
 void AudioPlayer::stop()
 {
+    previewVoice.stop();
     mTransportSource->stop();
 }
 
-bool AudioPlayer::loadURLIntoTransport(URL const & inURL)
+bool AudioPlayer::loadURLIntoTransport(URL const & inURL, SampleItem const * inSampleItem)
 {
     // Unload the previous file source and delete it
-    mTransportSource->stop();
-    mTransportSource->setSource(nullptr);
-    mCurrentAudioFileSource.reset();
+    releaseCurrentSources();
+    
+    if (inURL.isLocalFile() && !inURL.getLocalFile().existsAsFile())
+    {
+        return false;
+    }
+    
+    // Normalise volume with the peak level from the sample analysis
+    currentMaxLevel = inSampleItem == nullptr ? 0.0 : inSampleItem->getPeakLevel();
+    
+    // Files that were never analysed play unnormalised until the prefetch thread has read them in full
+    if (currentMaxLevel <= 0 && inURL.isLocalFile())
+    {
+        File audioFile = inURL.getLocalFile();
+        currentMaxLevel = findScannedPeakLevel(audioFile.getFullPathName(), audioFile.getLastModificationTime());
+    }
+    
+    setVolumeIsNormalised(mVolumeIsNormalised);
+    
+    // Play the attack of local files from memory while the reader catches up
+    std::shared_ptr<AudioBuffer<float> const> attackBuffer;
+    
+    if (inURL.isLocalFile())
+    {
+        File audioFile = inURL.getLocalFile();
+        String filePath = audioFile.getFullPathName();
+        Time modificationTime = audioFile.getLastModificationTime();
+        std::shared_ptr<SampleAttack const> attack = findCachedAttack(filePath, modificationTime);
+        
+        if (attack != nullptr)
+        {
+            attackBuffer = std::shared_ptr<AudioBuffer<float> const>(attack, &attack->buffer);
+        }
+        else
+        {
+            // Stream right away and let the prefetch thread decode the attack for the next preview
+            {
+                const ScopedLock lock(mAttackCacheLock);
+                mMissedAttackFilePath = filePath;
+            }
+            
+            mPrefetchThread->moveToFrontOfQueue(this);
+        }
+    }
+    
+    // Stream local files through the host's audio callback unless a separate output device was chosen
+    mUsesPreviewVoice = mPlaysThroughHost && inURL.isLocalFile();
+    
+    // The voice opens the file on its own thread, so no reader is created here
+    if (mUsesPreviewVoice)
+    {
+        previewVoice.load(inURL.getLocalFile(),
+                          inSampleItem == nullptr ? 0.0 : inSampleItem->getTempo(),
+                          inSampleItem == nullptr ? NO_KEY_INDEX : inSampleItem->getKey(),
+                          attackBuffer);
+        
+        return true;
+    }
     
     auto const source = std::make_unique<URLInputSource>(inURL);
     
@@ -113,61 +218,350 @@ bool AudioPlayer::loadURLIntoTransport(URL const & inURL)
     }
     
     mCurrentAudioFileSource = std::make_unique<AudioFormatReaderSource>(reader.release(), true);
+    AudioFormatReader* fileReader = mCurrentAudioFileSource->getAudioFormatReader();
+    PositionableAudioSource* playbackSource = mCurrentAudioFileSource.get();
     
-    // Read max level from file and normalise volume
-    float lowestLeft = 0;
-    float hightestLeft = 0;
-    float lowestRight = 0;
-    float hightestRight = 0;
-    mCurrentAudioFileSource->getAudioFormatReader()->readMaxLevels(0,
-                                                                   mCurrentAudioFileSource->getTotalLength(),
-                                                                   lowestLeft,
-                                                                   hightestLeft,
-                                                                   lowestRight,
-                                                                   hightestRight);
-    currentMaxLevel = juce::jmax<float>(hightestLeft - lowestLeft, hightestRight - lowestRight) / 2.0;
-    setVolumeIsNormalised(mVolumeIsNormalised);
+    if (attackBuffer != nullptr)
+    {
+        mCurrentAttackSource = std::make_unique<AttackCachedAudioSource>(attackBuffer, *mCurrentAudioFileSource);
+        playbackSource = mCurrentAttackSource.get();
+    }
     
     // Plug new audio source into our transport source
-    mTransportSource->setSource(mCurrentAudioFileSource.get(),
+    mTransportSource->setSource(playbackSource,
                                 32768,                   // Tells it to buffer this many samples ahead
                                 &*mThread,                 // This is the background thread to use for reading-ahead
-                                mCurrentAudioFileSource->getAudioFormatReader()->sampleRate);     // Allows for sample rate correction
+                                fileReader->sampleRate);     // Allows for sample rate correction
     
     return true;
 }
 
 void AudioPlayer::emptyTransport()
 {
+    releaseCurrentSources();
+    previewVoice.load(File(), 0.0, NO_KEY_INDEX);
+    mUsesPreviewVoice = false;
+}
+
+void AudioPlayer::releaseCurrentSources()
+{
+    previewVoice.stop();
     mTransportSource->stop();
     mTransportSource->setSource(nullptr);
+    mCurrentAttackSource.reset();
     mCurrentAudioFileSource.reset();
 }
 
-void AudioPlayer::timerCallback()
+std::shared_ptr<AudioPlayer::SampleAttack const> AudioPlayer::findCachedAttack(String const & inFilePath, Time inModificationTime)
+{
+    const ScopedLock lock(mAttackCacheLock);
+    auto entry = mAttackCache.find(inFilePath);
+    
+    if (entry == mAttackCache.end())
+    {
+        numAttackCacheMisses++;
+        return nullptr;
+    }
+    
+    // The file was changed since its attack was decoded
+    if (entry->second.attack->modificationTime != inModificationTime)
+    {
+        removeCachedAttack(entry);
+        numAttackCacheMisses++;
+        return nullptr;
+    }
+    
+    mAttackCacheOrder.splice(mAttackCacheOrder.begin(), mAttackCacheOrder, entry->second.orderPosition);
+    numAttackCacheHits++;
+    
+    return entry->second.attack;
+}
+
+std::shared_ptr<AudioPlayer::SampleAttack const> AudioPlayer::cacheAttack(String const & inFilePath, Time inModificationTime, AudioFormatReader& inReader)
+{
+    // Decode the attack in stereo like the playback
+    std::shared_ptr<SampleAttack> attack = std::make_shared<SampleAttack>();
+    int numSamples = (int) jmin<int64>(inReader.lengthInSamples, (int64) (inReader.sampleRate * attackLengthInSeconds));
+    attack->buffer.setSize(2, numSamples);
+    inReader.read(&attack->buffer, 0, numSamples, 0, true, true);
+    attack->modificationTime = inModificationTime;
+    attack->numBytes = (size_t) attack->buffer.getNumChannels() * (size_t) numSamples * sizeof(float);
+    
+    const ScopedLock lock(mAttackCacheLock);
+    auto entry = mAttackCache.find(inFilePath);
+    
+    if (entry != mAttackCache.end())
+    {
+        removeCachedAttack(entry);
+    }
+    
+    mAttackCacheOrder.push_front(inFilePath);
+    mAttackCache[inFilePath] = { attack, mAttackCacheOrder.begin() };
+    attackCacheSize += attack->numBytes;
+    evictAttacks();
+    
+    return attack;
+}
+
+float AudioPlayer::findScannedPeakLevel(String const & inFilePath, Time inModificationTime)
+{
+    {
+        const ScopedLock lock(mAttackCacheLock);
+        auto entry = mScannedPeakLevels.find(inFilePath);
+        
+        if (entry != mScannedPeakLevels.end() && entry->second.modificationTime == inModificationTime)
+        {
+            return entry->second.peakLevel;
+        }
+        
+        mUnknownPeakFilePath = inFilePath;
+    }
+    
+    mPrefetchThread->moveToFrontOfQueue(this);
+    
+    return 0.0;
+}
+
+void AudioPlayer::scanPeakLevel(String const & inFilePath)
+{
+    File audioFile = File(inFilePath);
+    Time modificationTime = audioFile.getLastModificationTime();
+    std::unique_ptr<AudioFormatReader> reader(mFormatManager->createReaderFor(audioFile));
+    
+    if (reader == nullptr)
+    {
+        return;
+    }
+    
+    float lowestLeft = 0;
+    float hightestLeft = 0;
+    float lowestRight = 0;
+    float hightestRight = 0;
+    reader->readMaxLevels(0,
+                          reader->lengthInSamples,
+                          lowestLeft,
+                          hightestLeft,
+                          lowestRight,
+                          hightestRight);
+    float peakLevel = juce::jmax<float>(hightestLeft - lowestLeft, hightestRight - lowestRight) / 2.0;
+    
+    const ScopedLock lock(mAttackCacheLock);
+    
+    // Start over instead of tracking the use of every scanned file
+    if ((int) mScannedPeakLevels.size() >= maxNumScannedPeakLevels)
+    {
+        mScannedPeakLevels.clear();
+    }
+    
+    mScannedPeakLevels[inFilePath] = { peakLevel, modificationTime };
+}
+
+bool AudioPlayer::attackIsCached(String const & inFilePath, Time inModificationTime)
 {
-    int defaultDeviceIndex = mAudioDeviceManager->getCurrentDeviceTypeObject()->getDefaultDeviceIndex(false);
-    String defaultDeviceName = mAudioDeviceManager->getCurrentDeviceTypeObject()->getDeviceNames()[defaultDeviceIndex];
+    const ScopedLock lock(mAttackCacheLock);
+    auto entry = mAttackCache.find(inFilePath);
     
-    if (defaultDeviceName != mAudioDeviceManager->getCurrentAudioDevice()->getName())
+    return entry != mAttackCache.end() && entry->second.attack->modificationTime == inModificationTime;
+}
+
+void AudioPlayer::prefetchSampleAttacks(StringArray const & inFilePaths)
+{
     {
-        initialiseDefaultDevice();
+        const ScopedLock lock(mAttackCacheLock);
+        mPrefetchFilePaths = inFilePaths;
     }
+    
+    mPrefetchThread->moveToFrontOfQueue(this);
 }
 
-void AudioPlayer::initialiseDefaultDevice()
+int AudioPlayer::useTimeSlice()
 {
-    int numInputChannels = 0;
-    RuntimePermissions::request(RuntimePermissions::recordAudio,
-                                [&numInputChannels] (bool granted)
-                                { numInputChannels = granted ? 2 : 0; });
-    mAudioDeviceManager->initialise(numInputChannels, 2, nullptr, true, {}, nullptr);
+    String filePath;
+    String peakFilePath;
+    
+    {
+        const ScopedLock lock(mAttackCacheLock);
+        
+        if (mMissedAttackFilePath.isNotEmpty())
+        {
+            filePath = mMissedAttackFilePath;
+            mMissedAttackFilePath.clear();
+        }
+        else if (mUnknownPeakFilePath.isNotEmpty())
+        {
+            peakFilePath = mUnknownPeakFilePath;
+            mUnknownPeakFilePath.clear();
+        }
+        else if (mPrefetchFilePaths.isEmpty())
+        {
+            return 500;
+        }
+        else
+        {
+            filePath = mPrefetchFilePaths[0];
+            mPrefetchFilePaths.remove(0);
+        }
+    }
+    
+    if (peakFilePath.isNotEmpty())
+    {
+        scanPeakLevel(peakFilePath);
+        return 0;
+    }
+    
+    File audioFile = File(filePath);
+    Time modificationTime = audioFile.getLastModificationTime();
+    
+    if (!attackIsCached(filePath, modificationTime))
+    {
+        std::unique_ptr<AudioFormatReader> reader(mFormatManager->createReaderFor(audioFile));
+        
+        if (reader != nullptr)
+        {
+            cacheAttack(filePath, modificationTime, *reader);
+        }
+    }
+    
+    return 0;
+}
+
+void AudioPlayer::evictAttacks()
+{
+    while (attackCacheSize > attackCacheBudget && !mAttackCacheOrder.empty())
+    {
+        removeCachedAttack(mAttackCache.find(mAttackCacheOrder.back()));
+    }
+}
+
+void AudioPlayer::removeCachedAttack(std::map<String, AttackCacheEntry>::iterator inEntry)
+{
+    attackCacheSize -= inEntry->second.attack->numBytes;
+    mAttackCacheOrder.erase(inEntry->second.orderPosition);
+    mAttackCache.erase(inEntry);
+}
+
+void AudioPlayer::setAttackCacheBudget(size_t inNumBytes)
+{
+    const ScopedLock lock(mAttackCacheLock);
+    attackCacheBudget = inNumBytes;
+    evictAttacks();
+}
+
+int AudioPlayer::getNumAttackCacheHits()
+{
+    const ScopedLock lock(mAttackCacheLock);
+    return numAttackCacheHits;
+}
+
+int AudioPlayer::getNumAttackCacheMisses()
+{
+    const ScopedLock lock(mAttackCacheLock);
+    return numAttackCacheMisses;
+}
+
+void AudioPlayer::changeListenerCallback(ChangeBroadcaster* source)
+{
+    // The system's default device may have changed, e.g. because headphones were plugged in
+    if (mFollowsDefaultDevice && !mPlaysThroughHost)
+    {
+        String deviceTypeName = mAudioDeviceManager->getCurrentAudioDeviceType();
+        mDeviceThreadPool->addJob([this, deviceTypeName] { scanForDefaultDevice(deviceTypeName); });
+    }
+}
+
+void AudioPlayer::scanForDefaultDevice(String inDeviceTypeName)
+{
+    // Scanning can block on the driver, so it uses device types of its own instead of the device manager's
+    if (mScanDeviceTypes.isEmpty())
+    {
+        AudioDeviceManager().createAudioDeviceTypes(mScanDeviceTypes);
+    }
+    
+    for (AudioIODeviceType* deviceType : mScanDeviceTypes)
+    {
+        if (deviceType->getTypeName() == inDeviceTypeName)
+        {
+            deviceType->scanForDevices();
+            
+            {
+                CriticalSection::ScopedLockType const scopedLock(mScanLock);
+                scannedDefaultDeviceName = deviceType->getDeviceNames()[deviceType->getDefaultDeviceIndex(false)];
+            }
+            
+            triggerAsyncUpdate();
+            return;
+        }
+    }
+}
+
+void AudioPlayer::handleAsyncUpdate()
+{
+    String defaultDeviceName;
+    
+    {
+        CriticalSection::ScopedLockType const scopedLock(mScanLock);
+        defaultDeviceName = scannedDefaultDeviceName;
+    }
+    
+    // Reopening the device broadcasts a change as well, so only a different default device is followed
+    if (mFollowsDefaultDevice && !mPlaysThroughHost && defaultDeviceName != lastDefaultDeviceName)
+    {
+        openOutputDevice(String());
+    }
+}
+
+void AudioPlayer::openOutputDevice(String inDeviceName)
+{
+    // Mute the transport until the new device rendered its first block, the old device is closed by then
+    mAudioSourcePlayer->setGain(0.0);
+    mAudioDeviceManager->initialise(0, 2, nullptr, true, inDeviceName, nullptr);
+    deviceIsFadingIn = true;
+    
+    if (inDeviceName.isEmpty())
+    {
+        AudioIODeviceType* deviceType = mAudioDeviceManager->getCurrentDeviceTypeObject();
+        lastDefaultDeviceName = deviceType == nullptr ? String() : deviceType->getDeviceNames()[deviceType->getDefaultDeviceIndex(false)];
+    }
+}
+
+void AudioPlayer::audioDeviceIOCallbackWithContext(float const * const * inputChannelData,
+                                                   int numInputChannels,
+                                                   float * const * outputChannelData,
+                                                   int numOutputChannels,
+                                                   int numSamples,
+                                                   AudioIODeviceCallbackContext const & context)
+{
+    // The source player rendered before this callback and the device manager mixes both outputs
+    for (int ch = 0; ch < numOutputChannels; ch++)
+    {
+        if (outputChannelData[ch] != nullptr)
+        {
+            FloatVectorOperations::clear(outputChannelData[ch], numSamples);
+        }
+    }
+    
+    // The player ramps from the muted block to the restored gain across its next block
+    if (deviceIsFadingIn.exchange(false))
+    {
+        mAudioSourcePlayer->setGain(currentUserLevel / currentNormalisationGain);
+    }
+}
+
+void AudioPlayer::audioDeviceAboutToStart(AudioIODevice* device)
+{
+    
+}
+
+void AudioPlayer::audioDeviceStopped()
+{
+    
 }
 
 void AudioPlayer::setGain(float inGain)
 {
     currentUserLevel = inGain;
     mAudioSourcePlayer->setGain(currentUserLevel / currentNormalisationGain);
+    previewVoice.setGain(currentUserLevel / currentNormalisationGain);
 }
 
 void AudioPlayer::setVolumeIsNormalised(bool inVolumeIsNormalised)
@@ -179,5 +573,16 @@ void AudioPlayer::setVolumeIsNormalised(bool inVolumeIsNormalised)
 
 void AudioPlayer::selectOutputDevice(String inDeviceName)
 {
-    mAudioDeviceManager->initialise(0, 2, nullptr, true, inDeviceName, nullptr);
+    emptyTransport();
+    mPlaysThroughHost = inDeviceName == HOST_OUTPUT_DEVICE_NAME;
+    mFollowsDefaultDevice = inDeviceName.isEmpty();
+    
+    // The previews are rendered in the host's audio callback, so no second device is opened next to it
+    if (mPlaysThroughHost)
+    {
+        mAudioDeviceManager->closeAudioDevice();
+        return;
+    }
+    
+    openOutputDevice(inDeviceName);
 }
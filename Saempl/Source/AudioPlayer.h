@@ -9,17 +9,28 @@
 
 #pragma once
 #include "JuceHeader.h"
+#include "BlomeHelpers.h"
+#include "SamplePreviewVoice.h"
+#include "AttackCachedAudioSource.h"
+#include "SampleItem.h"
+#include <list>
+#include <map>
 
 /**
  Handles audio playback for different audio formats.
+ 
+ Local files are played by a preview voice inside the host's audio callback, unless a separate output device is selected.
  */
 class AudioPlayer
 :
-private Timer
+private ChangeListener,
+private TimeSliceClient,
+private AudioIODeviceCallback,
+private AsyncUpdater
 {
 public:
     
-    AudioPlayer();
+    AudioPlayer(SamplePreviewVoice& inPreviewVoice);
     ~AudioPlayer();
     /**
      @returns the player's audio format manager.
@@ -55,10 +66,11 @@ public:
      Loads the given URL into the audio transport source.
      
      @param audioURL the URL to load into the transport source.
+     @param inSampleItem the analysed sample item of the audio file for volume normalisation, tempo and key matching, nullptr if it is unknown.
      
      @returns if the loading was successful.
      */
-    bool loadURLIntoTransport(URL const & inURL);
+    bool loadURLIntoTransport(URL const & inURL, SampleItem const * inSampleItem);
     /**
      Empties and resets the audio sources.
      */
@@ -77,26 +89,201 @@ public:
     void setVolumeIsNormalised(bool inVolumeIsNormalised);
     /**
      Selects an output device for the audio player.
+     
+     The device manager isn't thread-safe, so the device is opened on the message thread.
+     Only the scans for a changed system default device run on a background thread.
+     
+     @param inDeviceName the name of the device, HOST_OUTPUT_DEVICE_NAME plays through the host instead of opening a device
+     and an empty name follows the system's default device.
      */
     void selectOutputDevice(String inDeviceName);
+    /**
+     Sets how much memory the cached sample attacks may use, evicting the least recently used ones if needed.
+     
+     @param inNumBytes the memory budget in bytes.
+     */
+    void setAttackCacheBudget(size_t inNumBytes);
+    /**
+     @returns how many previews were started from a cached sample attack.
+     */
+    int getNumAttackCacheHits();
+    /**
+     @returns how many previews had to decode their sample attack from disk.
+     */
+    int getNumAttackCacheMisses();
+    /**
+     Decodes the attacks of the given sample files into the cache on a background thread,
+     so they can be auditioned without waiting for the disk.
+     
+     Replaces the files that were requested before and have not been prefetched yet.
+     
+     @param inFilePaths the paths of the sample files to prefetch, most likely played first.
+     */
+    void prefetchSampleAttacks(StringArray const & inFilePaths);
     
 private:
+    /**
+     The decoded first moments of a sample file, kept in memory to start its preview instantly.
+     */
+    struct SampleAttack
+    {
+        AudioBuffer<float> buffer;
+        Time modificationTime;
+        size_t numBytes;
+    };
+    
+    /**
+     A cached sample attack together with its position in the least recently used order.
+     */
+    struct AttackCacheEntry
+    {
+        std::shared_ptr<SampleAttack const> attack;
+        std::list<String>::iterator orderPosition;
+    };
+    
+    /**
+     The peak level of a sample file that was never analysed, scanned on the prefetch thread.
+     */
+    struct ScannedPeakLevel
+    {
+        float peakLevel;
+        Time modificationTime;
+    };
+    
+    SamplePreviewVoice& previewVoice;
     std::unique_ptr<TimeSliceThread> mThread;
+    std::unique_ptr<TimeSliceThread> mPrefetchThread;
+    // The device manager isn't thread-safe, so it is only used on the message thread
     std::unique_ptr<AudioDeviceManager> mAudioDeviceManager;
+    // Scans for the system's default device one request after the other on a single thread
+    std::unique_ptr<ThreadPool> mDeviceThreadPool;
+    // Device types of their own for the scans, only used on the device thread
+    OwnedArray<AudioIODeviceType> mScanDeviceTypes;
+    // The last default device found by a scan, handed to the message thread
+    String scannedDefaultDeviceName;
+    CriticalSection mScanLock;
+    // The default device that was opened last, only used on the message thread
+    String lastDefaultDeviceName;
+    // Set when a device was opened muted, cleared by the audio thread once the muted block was rendered
+    std::atomic<bool> deviceIsFadingIn;
     std::unique_ptr<AudioFormatManager> mFormatManager;
     std::unique_ptr<AudioSourcePlayer> mAudioSourcePlayer;
     std::unique_ptr<AudioTransportSource> mTransportSource;
     std::unique_ptr<AudioFormatReaderSource> mCurrentAudioFileSource;
+    std::unique_ptr<AttackCachedAudioSource> mCurrentAttackSource;
+    std::map<String, AttackCacheEntry> mAttackCache;
+    std::list<String> mAttackCacheOrder;
+    CriticalSection mAttackCacheLock;
+    StringArray mPrefetchFilePaths;
+    // The last previewed file that missed the cache, decoded before the neighbours
+    String mMissedAttackFilePath;
+    // Peak levels of files without analysis, an entry is kept even if the file is silent
+    std::map<String, ScannedPeakLevel> mScannedPeakLevels;
+    // The last previewed file without a known peak level, scanned before the attacks are prefetched
+    String mUnknownPeakFilePath;
+    static int const maxNumScannedPeakLevels = 4096;
+    size_t attackCacheBudget;
+    size_t attackCacheSize;
+    int numAttackCacheHits;
+    int numAttackCacheMisses;
+    // Covers the quarter of a second the transport source buffers before starting playback
+    constexpr static double const attackLengthInSeconds = 0.4;
     bool mVolumeIsNormalised;
+    bool mPlaysThroughHost;
+    bool mFollowsDefaultDevice;
+    bool mUsesPreviewVoice;
     float currentMaxLevel;
-    float currentUserLevel;
-    float currentNormalisationGain;
+    // Written on the message thread, read on the audio thread
+    std::atomic<float> currentUserLevel;
+    std::atomic<float> currentNormalisationGain;
     
-    void timerCallback() override;
     /**
-     Gets permission for audio recording and set audio i/o to default in- and ouput channels.
+     Scans for the system's default device when the device manager reports a change of the available devices.
+     */
+    void changeListenerCallback(ChangeBroadcaster* source) override;
+    /**
+     Reopens the system's default device if a scan found a different one than was opened last.
+     */
+    void handleAsyncUpdate() override;
+    /**
+     Prefetches the attack of the next requested sample file.
+     */
+    int useTimeSlice() override;
+    /**
+     Fades the transport in after the first block a newly opened device rendered muted.
+     */
+    void audioDeviceIOCallbackWithContext(float const * const * inputChannelData,
+                                          int numInputChannels,
+                                          float * const * outputChannelData,
+                                          int numOutputChannels,
+                                          int numSamples,
+                                          AudioIODeviceCallbackContext const & context) override;
+    void audioDeviceAboutToStart(AudioIODevice* device) override;
+    void audioDeviceStopped() override;
+    /**
+     Opens an output device muted, so the transport fades in over the device's second block.
+     
+     @param inDeviceName the name of the device, empty for the system's default device.
+     */
+    void openOutputDevice(String inDeviceName);
+    /**
+     Rescans the devices of a device type for its default output device and hands it to the message thread.
+     Called on the device thread.
+     
+     @param inDeviceTypeName the name of the device type the device manager currently uses.
+     */
+    void scanForDefaultDevice(String inDeviceTypeName);
+    /**
+     Looks up the cached attack of a sample file and marks it as most recently used.
+     
+     @param inFilePath the path of the sample file.
+     @param inModificationTime the current modification time of the file, older cached attacks are discarded.
+     
+     @returns the cached attack or nullptr if there is none.
+     */
+    std::shared_ptr<SampleAttack const> findCachedAttack(String const & inFilePath, Time inModificationTime);
+    /**
+     Looks up the scanned peak level of a sample file that was never analysed.
+     Queues a scan on the prefetch thread if it is not known yet, so the file is normalised on its next preview.
+     
+     @param inFilePath the path of the sample file.
+     @param inModificationTime the current modification time of the file, older scans are discarded.
+     
+     @returns the peak level or 0 if it is not known yet.
+     */
+    float findScannedPeakLevel(String const & inFilePath, Time inModificationTime);
+    /**
+     Reads a whole sample file to find its peak level. Called on the prefetch thread.
+     
+     @param inFilePath the path of the sample file.
+     */
+    void scanPeakLevel(String const & inFilePath);
+    /**
+     @returns whether an up to date attack of the sample file is cached, without marking it as used.
+     */
+    bool attackIsCached(String const & inFilePath, Time inModificationTime);
+    /**
+     Decodes the attack of a sample file and adds it to the cache.
+     
+     @param inFilePath the path of the sample file.
+     @param inModificationTime the current modification time of the file.
+     @param inReader the reader to decode the attack with.
+     
+     @returns the decoded attack.
+     */
+    std::shared_ptr<SampleAttack const> cacheAttack(String const & inFilePath, Time inModificationTime, AudioFormatReader& inReader);
+    /**
+     Removes the least recently used attacks until the cache fits into its memory budget.
+     */
+    void evictAttacks();
+    /**
+     Removes the given attack from the cache.
+     */
+    void removeCachedAttack(std::map<String, AttackCacheEntry>::iterator inEntry);
+    /**
+     Unplugs the current audio sources from the transport source and deletes them.
      */
-    void initialiseDefaultDevice();
+    void releaseCurrentSources();
     
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(AudioPlayer);
 };
@@ -22,7 +22,8 @@ audioPlayer(inAudioPlayer),
 zoomSlider(inSlider),
 mThumbnailCache(std::make_unique<AudioThumbnailCache>(5)),
 mAudioPreview(std::make_unique<AudioThumbnail>(512, audioPlayer.getFormatManager(), *mThumbnailCache)),
-isFollowingTransport(false)
+isFollowingTransport(false),
+waveformIsCached(false)
 {
     setSize(style->SAMPLE_PREVIEW_WIDTH, style->SAMPLE_PREVIEW_HEIGHT);
     setPanelComponents();
@@ -56,7 +57,7 @@ void AudioPreviewPanel::paint(Graphics& g)
     previewArea = previewArea.withTrimmedBottom(mAudioPreviewScrollbar->getHeight() + 4 + style->PANEL_MARGIN);
     g.setColour(style->COLOUR_ACCENT_LIGHT);
     
-    if (mAudioPreview->getTotalLength() > 0.0)
+    if (getPreviewLength() > 0.0)
     {
         // Draw file name on title bar
         g.setFont(style->FONT_SMALL_BOLD);
@@ -69,11 +70,21 @@ void AudioPreviewPanel::paint(Graphics& g)
                          2);
         
         // Draw audio preview
-        mAudioPreview->drawChannels(g,
-                                    previewArea,
-                                    visibleRange.getStart(),
-                                    visibleRange.getEnd(),
-                                    1.0f);
+        if (waveformIsCached)
+        {
+            mWaveform.drawChannels(g,
+                                   previewArea,
+                                   visibleRange.getStart(),
+                                   visibleRange.getEnd());
+        }
+        else
+        {
+            mAudioPreview->drawChannels(g,
+                                        previewArea,
+                                        visibleRange.getStart(),
+                                        visibleRange.getEnd(),
+                                        1.0f);
+        }
     }
     else
     {
@@ -113,16 +124,23 @@ void AudioPreviewPanel::setPanelComponents()
 
 void AudioPreviewPanel::setURL(URL const & url)
 {
-    if (auto inputSource = std::make_unique<URLInputSource>(url))
+    // Analysed samples are drawn from their cached waveform without decoding them
+    waveformIsCached = url.isLocalFile() && mWaveform.loadFromCache(url.getLocalFile());
+    
+    if (waveformIsCached)
     {
-        mAudioPreview->setSource(inputSource.release());
-        
-        Range<double> newRange(0.0, mAudioPreview->getTotalLength());
-        mAudioPreviewScrollbar->setRangeLimits(newRange);
-        setRange(newRange);
-        
-        startTimerHz(40);
+        mAudioPreview->clear();
     }
+    else
+    {
+        mAudioPreview->setSource(new URLInputSource(url));
+    }
+    
+    Range<double> newRange(0.0, getPreviewLength());
+    mAudioPreviewScrollbar->setRangeLimits(newRange);
+    setRange(newRange);
+    
+    startTimerHz(40);
 }
 
 URL AudioPreviewPanel::getLastDroppedFile() const noexcept
@@ -133,9 +151,9 @@ URL AudioPreviewPanel::getLastDroppedFile() const noexcept
 void AudioPreviewPanel::setZoomFactor(double amount)
 {
     // Set preview and scrollbar zoom
-    if (mAudioPreview->getTotalLength() > 0)
+    if (getPreviewLength() > 0)
     {
-        auto newScale = jmax(0.001, mAudioPreview->getTotalLength() * (1.0 - jlimit(0.0, 0.99, amount)));
+        auto newScale = jmax(0.001, getPreviewLength() * (1.0 - jlimit(0.0, 0.99, amount)));
         auto timeAtCentre = xToTime((float) getWidth() / 2.0f);
         
         setRange({ timeAtCentre - newScale * 0.5, timeAtCentre + newScale * 0.5 });
@@ -208,10 +226,10 @@ void AudioPreviewPanel::mouseUp(MouseEvent const & mouseEvent)
 void AudioPreviewPanel::mouseWheelMove(MouseEvent const &, MouseWheelDetails const & wheel)
 {
     // Set zoom of audio preview if a file is loaded
-    if (mAudioPreview->getTotalLength() > 0.0)
+    if (getPreviewLength() > 0.0)
     {
         auto newStart = visibleRange.getStart() - wheel.deltaX * (visibleRange.getLength()) / 10.0;
-        newStart = jlimit(0.0, jmax(0.0, mAudioPreview->getTotalLength() - (visibleRange.getLength())), newStart);
+        newStart = jlimit(0.0, jmax(0.0, getPreviewLength() - (visibleRange.getLength())), newStart);
         
         if (canMoveTransport())
         {
@@ -314,7 +332,14 @@ void AudioPreviewPanel::startOrStop()
 
 bool AudioPreviewPanel::loadURLIntoTransport(URL const & audioURL)
 {
-    return audioPlayer.loadURLIntoTransport(audioURL);
+    SampleItem* sampleItem = nullptr;
+    
+    if (audioURL.isLocalFile())
+    {
+        sampleItem = currentProcessor.getSampleLibrary().getSampleItemWithFilePath(audioURL.getLocalFile().getFullPathName());
+    }
+    
+    return audioPlayer.loadURLIntoTransport(audioURL, sampleItem);
 }
 
 void AudioPreviewPanel::emptyAudioResource()
@@ -323,11 +348,17 @@ void AudioPreviewPanel::emptyAudioResource()
     lastFileDropped = URL();
     zoomSlider.setValue(0, dontSendNotification);
     mAudioPreview->clear();
+    waveformIsCached = false;
     Range<double> newRange;
     setRange(newRange);
     mAudioPreviewScrollbar->setRangeLimits(newRange);
 }
 
+double AudioPreviewPanel::getPreviewLength()
+{
+    return waveformIsCached ? mWaveform.getLengthInSeconds() : mAudioPreview->getTotalLength();
+}
+
 void AudioPreviewPanel::resizePanelComponents()
 {
     if (mAudioPreviewScrollbar != nullptr)
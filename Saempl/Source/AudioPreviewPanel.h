@@ -16,6 +16,7 @@
 #include "BlomeHelpers.h"
 #include "BlomeLookAndFeel.h"
 #include "AudioPlayer.h"
+#include "SampleWaveform.h"
 
 /**
  Holds the AudioThumbnail and displays the audio's waveform.
@@ -107,6 +108,8 @@ private:
     std::unique_ptr<ScrollBar> mAudioPreviewScrollbar;
     std::unique_ptr<AudioThumbnailCache> mThumbnailCache;
     std::unique_ptr<AudioThumbnail> mAudioPreview;
+    SampleWaveform mWaveform;
+    bool waveformIsCached;
     Range<double> visibleRange;
     bool isFollowingTransport;
     URL lastFileDropped;
@@ -121,6 +124,10 @@ private:
     void mouseDrag(MouseEvent const & e) override;
     void mouseUp(MouseEvent const &) override;
     void mouseWheelMove(MouseEvent const &, MouseWheelDetails const & wheel) override;
+    /**
+     @returns the length in seconds of the previewed audio, from the cached waveform if there is one.
+     */
+    double getPreviewLength();
     /**
      Converts the the playback time to the x value of the cursor.
      
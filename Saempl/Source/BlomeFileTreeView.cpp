@@ -87,7 +87,7 @@ void BlomeFileTreeView::playSelectedSample()
     // Load file into source
     if (sampleFile.exists() && !sampleFile.isDirectory() && isSupportedAudioFileFormat(sampleFile.getFileExtension()))
     {
-        audioPlayer.loadURLIntoTransport(URL(sampleFile));
+        audioPlayer.loadURLIntoTransport(URL(sampleFile), sampleLibrary.getSampleItemWithFilePath(sampleFile.getFullPathName()));
         audioPlayer.setTransportSourcePosition(0.0);
         audioPlayer.start();
     }
@@ -21,6 +21,7 @@ static String const DIRECTORY_SEPARATOR = "/";
 static String const SAMPLE_LIBRARY_FILE_EXTENSION = ".bslf";
 static String const SAEMPL_DATA_FILE_EXTENSION = ".saempl";
 static String const EMPTY_TILE_PATH = "EMPTYTILE";
+static String const HOST_OUTPUT_DEVICE_NAME = "Host Output";
 static StringArray const SUPPORTED_AUDIO_FORMATS = StringArray({ ".mp3", ".wav", ".aiff", ".m4a" });
 static String const SUPPORTED_AUDIO_FORMATS_WILDCARD = "*.wav;*.mp3;*.aiff;*.m4a";
 static String const SUPPORTED_AUDIO_FORMATS_EXTENSIONS = ".wav;.mp3;.aiff;.m4a";
@@ -205,6 +206,66 @@ enum SampleItemCollectionScope
     FAVOURITE_SAMPLES,
 };
 
+enum PreviewVoiceType
+{
+    PREVIEW_VOICE_NAVIGATION = 0,
+    PREVIEW_VOICE_SAMPLE_ITEM,
+    NUM_PREVIEW_VOICES,
+};
+
+/**
+ A counter-based random number generator (SplitMix64) that is split into independent streams by an index.
+ 
+ Creating a stream costs only a few integer operations, so every job can draw from its own reproducible stream.
+ */
+class RandomStream
+{
+public:
+    using result_type = uint64;
+    
+    RandomStream(uint64 inSeed = 0, uint64 inStreamIndex = 0)
+    :
+    counter(mix(inSeed + inStreamIndex * increment))
+    {
+        
+    }
+    
+    static constexpr result_type min()
+    {
+        return 0;
+    }
+    
+    static constexpr result_type max()
+    {
+        return std::numeric_limits<uint64>::max();
+    }
+    
+    result_type operator()()
+    {
+        counter += increment;
+        return mix(counter);
+    }
+    
+    /**
+     @returns a random integer between 0 and the given maximum, excluding the maximum.
+     */
+    int nextInt(int inMaximum)
+    {
+        return (int) ((*this)() % (uint64) inMaximum);
+    }
+    
+private:
+    static uint64 const increment = 0x9E3779B97F4A7C15ULL;
+    uint64 counter;
+    
+    static uint64 mix(uint64 z)
+    {
+        z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+        z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+        return z ^ (z >> 31);
+    }
+};
+
 /**
  Checks if a file extension is a supported audio format.
  
@@ -225,6 +286,29 @@ inline bool isSupportedAudioFileFormat(String inExtension)
     return false;
 }
 
+/**
+ Calculates the shortest transposition from one key to another.
+ 
+ @param inFromKey the index of the key to transpose from.
+ @param inToKey the index of the key to transpose to.
+ 
+ @returns the number of semitones from -5 to 6, or 0 if one of the keys is unknown.
+ */
+inline int getKeyDistanceInSemitones(int inFromKey, int inToKey)
+{
+    int numKeys = (int) KEY_PATTERNS.size();
+    
+    if (inFromKey < 0 || inFromKey >= numKeys || inToKey < 0 || inToKey >= numKeys)
+    {
+        return 0;
+    }
+    
+    // The first note of a key pattern is the tonic of its major key
+    int numSemitones = (KEY_PATTERNS[inToKey][0] - KEY_PATTERNS[inFromKey][0] + 12) % 12;
+    
+    return numSemitones > 6 ? numSemitones - 12 : numSemitones;
+}
+
 /**
  Draws a drop shadow for a given area and position.
  
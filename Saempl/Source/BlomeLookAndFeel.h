@@ -440,8 +440,15 @@ public LookAndFeel_V4
         g.setColour(style->COLOUR_ACCENT_DARK);
         g.setFont(style->FONT_SMALL_BOLD);
         
+        // Show the number of filtered samples next to directories
+        String rowText = filename;
         
-        g.drawFittedText(filename,
+        if (isDirectory)
+        {
+            rowText += " (" + String(sampleLibrary.getFileFilter().getNumFilteredSamplesInDirectory(file)) + ")";
+        }
+        
+        g.drawFittedText(rowText,
                          x,
                          0,
                          width - x,
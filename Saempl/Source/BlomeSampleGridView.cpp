@@ -21,18 +21,21 @@ sampleItemPanel(inSampleItemPanel)
     sampleLibrary.addChangeListener(this);
     mSampleItemCollectionType = FILTERED_SAMPLES;
     sampleItemCollectionChanged = false;
-    addMouseListener(this, true);
+    hoveredPlayButtonIndex = -1;
     
     // Add grid clusterer
-    mGridClusterer = std::make_unique<SampleGridClusterer>(sampleLibrary.getSampleItems(mSampleItemCollectionType));
+    mGridClusterer = std::make_unique<SampleGridClusterer>();
     mGridClusterer->addChangeListener(this);
+    
+    // Repaint whenever new tile waveforms are ready
+    mSampleTileView.addChangeListener(this);
 }
 
 BlomeSampleGridView::~BlomeSampleGridView()
 {
     sampleLibrary.removeChangeListener(this);
     mGridClusterer->removeChangeListener(this);
-    removeMouseListener(this);
+    mSampleTileView.removeChangeListener(this);
 }
 
 void BlomeSampleGridView::clusterGrid()
@@ -42,6 +45,16 @@ void BlomeSampleGridView::clusterGrid()
         return;
     }
     
+    // Stop a running clustering before its empty squares are deleted
+    mGridClusterer->cancelClustering();
+    
+    // The last layout belongs to the samples of another library
+    if (sampleLibrary.getCurrentLibraryPath() != clusteredLibraryPath)
+    {
+        mGridClusterer->clearGridLayout();
+        clusteredLibraryPath = sampleLibrary.getCurrentLibraryPath();
+    }
+    
     // Retrieve sample items
     OwnedArray<SampleItem>& sampleItems = sampleLibrary.getSampleItems(mSampleItemCollectionType);
     mSelectedSampleTileIndices.clear();
@@ -83,14 +96,16 @@ void BlomeSampleGridView::clusterGrid()
     
     // Add empty squares to sample items
     emptySquares.clear();
+    Array<SampleItem*> gridItems;
+    gridItems.addArray(sampleItems.getRawDataPointer(), sampleItems.size());
     
     for (int e = 0; e < optimalNumEmptySquares; e++)
     {
-        sampleItems.add(emptySquares.add(new SampleItem()));
+        gridItems.add(emptySquares.add(new SampleItem()));
     }
     
     // Cluster sample item tiles with Fast Linear Assignment Sorting (FLAS)
-    if (sampleItems.size() > 9)
+    if (gridItems.size() > 9)
     {
         if (currentProcessor.getFeatureWeightsChanged())
         {
@@ -98,11 +113,20 @@ void BlomeSampleGridView::clusterGrid()
             currentProcessor.setFeatureWeightsChanged(false);
         }
         
-        mGridClusterer->applyClustering(optimalHeight, optimalWidth, false);
+        bool clusterInBackground = currentProcessor.getClusterGridInBackground();
+        mGridClusterer->setWarmStartIsEnabled(currentProcessor.getGridWarmStartIsEnabled());
+        mGridClusterer->setSortingQuality(currentProcessor.getGridSortingQuality());
+        mGridClusterer->applyClustering(gridItems, optimalHeight, optimalWidth, false, clusterInBackground);
+        
+        // Show the unsorted grid right away and refine it with every published snapshot
+        if (clusterInBackground)
+        {
+            setupGrid(gridItems);
+        }
     }
     else
     {
-        setupGrid();
+        setupGrid(gridItems);
     }
     
     sampleItemCollectionChanged = false;
@@ -110,7 +134,7 @@ void BlomeSampleGridView::clusterGrid()
 
 void BlomeSampleGridView::performGridLayout()
 {
-    if (mSampleTiles.isEmpty())
+    if (mGridItems.isEmpty())
     {
         return;
     }
@@ -118,16 +142,15 @@ void BlomeSampleGridView::performGridLayout()
     int tileWidth = minTileWidth + currentZoomFactor * (maxTileWidth - minTileWidth);
     float minMargin = style->PANEL_MARGIN * 0.5f;
     float maxMargin = minMargin * getTileMinMaxRelation();
-    float margin = minMargin + currentZoomFactor * (maxMargin - minMargin);
-    mSampleGrid->setGap(Grid::Px(margin));
+    tileGap = minMargin + currentZoomFactor * (maxMargin - minMargin);
+    
+    // Divide the grid into equally sized tracks with gaps in between
+    tileSize = (optimalWidth * tileWidth - (optimalWidth - 1) * tileGap) / optimalWidth;
     setBounds(0,
               0,
               optimalWidth * tileWidth,
               optimalHeight * tileWidth);
-    mSampleGrid->performLayout(Rectangle<int>(0,
-                                                  0,
-                                                  optimalWidth * tileWidth,
-                                                  optimalHeight * tileWidth));
+    repaint();
 }
 
 void BlomeSampleGridView::setZoomFactor(float inZoomFactor)
@@ -135,18 +158,58 @@ void BlomeSampleGridView::setZoomFactor(float inZoomFactor)
     currentZoomFactor = inZoomFactor;
 }
 
-Point<int> BlomeSampleGridView::getTileCentre(BlomeSampleTileView *randomTile)
+Rectangle<int> BlomeSampleGridView::getTileBounds(int inTileIndex)
 {
-    Point<int> centre = randomTile->getPosition();
-    int halfTildWidth = randomTile->getWidth() / 2;
-    centre.addXY(halfTildWidth, halfTildWidth);
+    float tilePitch = tileSize + tileGap;
+    int column = inTileIndex % optimalWidth;
+    int row = inTileIndex / optimalWidth;
+    
+    return Rectangle<float>(column * tilePitch, row * tilePitch, tileSize, tileSize).toNearestInt();
+}
+
+int BlomeSampleGridView::getTileIndexAt(Point<int> inPosition)
+{
+    if (mGridItems.isEmpty() || inPosition.getX() < 0 || inPosition.getY() < 0)
+    {
+        return -1;
+    }
+    
+    float tilePitch = tileSize + tileGap;
+    int column = inPosition.getX() / tilePitch;
+    int row = inPosition.getY() / tilePitch;
+    
+    // Clicks into the gaps between tiles don't hit a tile
+    if (column >= optimalWidth
+        || row >= optimalHeight
+        || inPosition.getX() - column * tilePitch > tileSize
+        || inPosition.getY() - row * tilePitch > tileSize)
+    {
+        return -1;
+    }
+    
+    int tileIndex = row * optimalWidth + column;
     
-    return centre;
+    return tileIndex < mGridItems.size() ? tileIndex : -1;
+}
+
+bool BlomeSampleGridView::tileIsEmpty(int inTileIndex)
+{
+    return mGridItems.getUnchecked(inTileIndex)->getCurrentFilePath() == EMPTY_TILE_PATH;
+}
+
+String BlomeSampleGridView::getTileFilePath(int inTileIndex)
+{
+    return mGridItems.getUnchecked(inTileIndex)->getCurrentFilePath();
+}
+
+Point<int> BlomeSampleGridView::getTileCentre(int inTileIndex)
+{
+    return getTileBounds(inTileIndex).getCentre();
 }
 
 Point<int> BlomeSampleGridView::selectRandomTile()
 {
-    int numTiles = mSampleTiles.size();
+    int numTiles = mGridItems.size();
     
     if (numTiles == 0)
     {
@@ -154,18 +217,17 @@ Point<int> BlomeSampleGridView::selectRandomTile()
     }
     
     int randomTileIndex = 0;
-    BlomeSampleTileView * randomTile;
     
     do
     {
         randomTileIndex = Random::getSystemRandom().nextInt(numTiles);
         deselectAll();
-        randomTile = mSampleTiles.getUnchecked(randomTileIndex);
     }
-    while (randomTile->getSampleItemFilePath() == EMPTY_TILE_PATH);
+    while (tileIsEmpty(randomTileIndex));
         
     selectTile(randomTileIndex);
-    return getTileCentre(randomTile);
+    prefetchNeighbourAttacks(randomTileIndex);
+    return getTileCentre(randomTileIndex);
 }
 
 void BlomeSampleGridView::loadSelectedTileIntoAudioPlayer()
@@ -175,14 +237,14 @@ void BlomeSampleGridView::loadSelectedTileIntoAudioPlayer()
         return;
     }
     
-    mSampleTiles.getUnchecked(mSelectedSampleTileIndices.getUnchecked(0))->loadIntoAudioPlayer();
+    loadIntoAudioPlayer(mSelectedSampleTileIndices.getUnchecked(0));
 }
 
 void BlomeSampleGridView::selectAll()
 {
     mSelectedSampleTileIndices.clear();
     
-    for (int t = 0; t < mSampleTiles.size(); t++)
+    for (int t = 0; t < mGridItems.size(); t++)
     {
         selectTile(t);
     }
@@ -194,7 +256,7 @@ void BlomeSampleGridView::deselectAll()
 {
     for (int t : mSelectedSampleTileIndices)
     {
-        mSampleTiles.getUnchecked(t)->setSelected(false);
+        mTileIsSelected[t] = false;
     }
     
     mSelectedSampleTileIndices.clear();
@@ -204,67 +266,79 @@ void BlomeSampleGridView::deselectAll()
 Point<int> BlomeSampleGridView::selectLeft()
 {
     int lastSelectedIndex = mSelectedSampleTileIndices.getLast();
-    BlomeSampleTileView * tile;
     int newIndex = lastSelectedIndex;
+    int tileIndex;
     
     do
     {
         deselectAll();
-        tile = selectTile(newIndex % optimalWidth == 0 ? lastSelectedIndex : --newIndex);
+        tileIndex = newIndex % optimalWidth == 0 ? lastSelectedIndex : --newIndex;
+        selectTile(tileIndex);
     }
-    while (tile->getSampleItemFilePath() == EMPTY_TILE_PATH);
+    while (tileIsEmpty(tileIndex));
+    
+    prefetchNeighbourAttacks(tileIndex);
     
-    return getTileCentre(tile);
+    return getTileCentre(tileIndex);
 }
 
 Point<int> BlomeSampleGridView::selectUp()
 {
     int lastSelectedIndex = mSelectedSampleTileIndices.getLast();
-    BlomeSampleTileView * tile;
     int newIndex = lastSelectedIndex;
+    int tileIndex;
     
     do
     {
         deselectAll();
         newIndex -= optimalWidth;
-        tile = selectTile(newIndex < 0 ? lastSelectedIndex : newIndex);
+        tileIndex = newIndex < 0 ? lastSelectedIndex : newIndex;
+        selectTile(tileIndex);
     }
-    while (tile->getSampleItemFilePath() == EMPTY_TILE_PATH);
+    while (tileIsEmpty(tileIndex));
     
-    return getTileCentre(tile);
+    prefetchNeighbourAttacks(tileIndex);
+    
+    return getTileCentre(tileIndex);
 }
 
 Point<int> BlomeSampleGridView::selectRight()
 {
     int lastSelectedIndex = mSelectedSampleTileIndices.getLast();
-    BlomeSampleTileView * tile;
     int newIndex = lastSelectedIndex;
+    int tileIndex;
     
     do
     {
         deselectAll();
-        tile = selectTile(newIndex % optimalWidth == optimalWidth - 1 ? lastSelectedIndex : ++newIndex);
+        tileIndex = newIndex % optimalWidth == optimalWidth - 1 ? lastSelectedIndex : ++newIndex;
+        selectTile(tileIndex);
     }
-    while (tile->getSampleItemFilePath() == EMPTY_TILE_PATH);
+    while (tileIsEmpty(tileIndex));
+    
+    prefetchNeighbourAttacks(tileIndex);
     
-    return getTileCentre(tile);
+    return getTileCentre(tileIndex);
 }
 
 Point<int> BlomeSampleGridView::selectDown()
 {
     int lastSelectedIndex = mSelectedSampleTileIndices.getLast();
-    BlomeSampleTileView * tile;
     int newIndex = lastSelectedIndex;
+    int tileIndex;
     
     do
     {
         deselectAll();
         newIndex += optimalWidth;
-        tile = selectTile(newIndex >= mSampleTiles.size() ? lastSelectedIndex : newIndex);
+        tileIndex = newIndex >= mGridItems.size() ? lastSelectedIndex : newIndex;
+        selectTile(tileIndex);
     }
-    while (tile->getSampleItemFilePath() == EMPTY_TILE_PATH);
+    while (tileIsEmpty(tileIndex));
+    
+    prefetchNeighbourAttacks(tileIndex);
     
-    return getTileCentre(tile);
+    return getTileCentre(tileIndex);
 }
 
 void BlomeSampleGridView::setReadyForClustering()
@@ -272,63 +346,95 @@ void BlomeSampleGridView::setReadyForClustering()
     sampleItemCollectionChanged = true;
 }
 
-void BlomeSampleGridView::setupGrid()
+void BlomeSampleGridView::setupGrid(Array<SampleItem*> const & inGridItems)
 {
     // Setup tile grid
-    mSampleTiles.clear();
-    OwnedArray<SampleItem>& sampleItems = sampleLibrary.getSampleItems(mSampleItemCollectionType);
-    mSampleGrid = std::make_unique<Grid>();
+    mGridItems = inGridItems;
+    mSampleTileView.clearTextLayoutCache();
+    mSampleTileView.clearMissingWaveforms();
+    mSelectedSampleTileIndices.clear();
+    mTileIsSelected.assign(mGridItems.size(), false);
+    hoveredPlayButtonIndex = -1;
     setVisible(true);
-    
-    if (sampleItems.size() == 0)
+    performGridLayout();
+}
+
+void BlomeSampleGridView::showGridSnapshot(Array<SampleItem*> const & inGridSnapshot)
+{
+    if (mGridItems.size() != inGridSnapshot.size())
     {
+        setupGrid(inGridSnapshot);
         return;
     }
     
-    mSampleGrid->autoFlow = Grid::AutoFlow::row;
-    using Track = Grid::TrackInfo;
-    mSampleGrid->autoRows = Track(1_fr);
-    mSampleGrid->autoColumns = Track(1_fr);
+    // Keep the selection on the same samples while they move on the grid,
+    // hashed so every tile only costs one lookup
+    std::unordered_set<SampleItem*> selectedSampleItems;
     
-    // Set up grid rows
-    mSampleGrid->templateRows = Array<Track>();
-    for (int i = 0; i < optimalHeight; i++)
+    for (int t : mSelectedSampleTileIndices)
     {
-        mSampleGrid->templateRows.add(Track(1_fr));
+        selectedSampleItems.insert(mGridItems.getUnchecked(t));
     }
     
-    // Set up grid columns
-    mSampleGrid->templateColumns = Array<Track>();
-    for (int i = 0; i < optimalWidth; i++)
-    {
-        mSampleGrid->templateColumns.add(Track(1_fr));
-    }
+    deselectAll();
     
-    // Setup tiles
-    for (SampleItem* sample : sampleItems)
-    {
-        addAndMakeVisible(mSampleTiles.add(new BlomeSampleTileView(sample, sampleLibrary, sampleItemPanel, audioPlayer)));
-    }
+    // The grid dimensions don't change between snapshots, so only the items are replaced
+    mGridItems = inGridSnapshot;
     
-    // Remove empty sample items from collection
-    // but keep them for the tile views
-    for (SampleItem* sample : emptySquares)
+    for (int t = 0; t < mGridItems.size() && !selectedSampleItems.empty(); t++)
     {
-        sampleItems.removeAndReturn(sampleItems.indexOf(sample));
+        if (selectedSampleItems.count(mGridItems.getUnchecked(t)) > 0)
+        {
+            selectTile(t);
+        }
     }
     
-    mSampleGrid->items.addArray(mSampleTiles);
-    performGridLayout();
+    repaint();
 }
 
 void BlomeSampleGridView::paint(Graphics& g)
 {
+    if (mGridItems.isEmpty())
+    {
+        return;
+    }
+    
+    // Only draw the tiles that are visible in the viewport
+    Rectangle<int> clipBounds = g.getClipBounds();
+    float tilePitch = tileSize + tileGap;
+    int firstColumn = jmax<int>(0, clipBounds.getX() / tilePitch);
+    int lastColumn = jmin<int>(optimalWidth - 1, clipBounds.getRight() / tilePitch);
+    int firstRow = jmax<int>(0, clipBounds.getY() / tilePitch);
+    int lastRow = jmin<int>(optimalHeight - 1, clipBounds.getBottom() / tilePitch);
     
+    for (int row = firstRow; row <= lastRow; row++)
+    {
+        for (int column = firstColumn; column <= lastColumn; column++)
+        {
+            int tileIndex = row * optimalWidth + column;
+            
+            if (tileIndex >= mGridItems.size())
+            {
+                break;
+            }
+            
+            mSampleTileView.paintTile(g,
+                                      mGridItems.getUnchecked(tileIndex),
+                                      getTileBounds(tileIndex),
+                                      mTileIsSelected[tileIndex],
+                                      tileIndex == hoveredPlayButtonIndex);
+        }
+    }
 }
 
 void BlomeSampleGridView::changeListenerCallback(ChangeBroadcaster* source)
 {
-    if (source == &sampleLibrary && isShowing())
+    if (source == &mSampleTileView)
+    {
+        mSampleTileView.updateWaveformAtlas();
+        repaint();
+    }
+    else if (source == &sampleLibrary && isShowing())
     {
         setVisible(false);
         setReadyForClustering();
@@ -336,13 +442,33 @@ void BlomeSampleGridView::changeListenerCallback(ChangeBroadcaster* source)
     }
     else if (source == &sampleLibrary && !isShowing())
     {
+        mGridClusterer->cancelClustering();
         setVisible(false);
         setReadyForClustering();
     }
     else if (source == &*mGridClusterer)
     {
+        Array<SampleItem*> gridSnapshot;
+        
+        if (!mGridClusterer->getGridSnapshot(gridSnapshot))
+        {
+            return;
+        }
+        
+        if (mGridClusterer->getClusteringIsFinished())
+        {
+            currentProcessor.setGridLayoutQuality(mGridClusterer->getDistancePreservationQuality());
+        }
+        
         // Refill tile collection
-        setupGrid();
+        if (mGridClusterer->getClusteringIsFinished() && !currentProcessor.getClusterGridInBackground())
+        {
+            setupGrid(gridSnapshot);
+        }
+        else
+        {
+            showGridSnapshot(gridSnapshot);
+        }
     }
 }
 
@@ -357,20 +483,18 @@ bool BlomeSampleGridView::isInterestedInFileDrag(StringArray const & files)
     return true;
 }
 
-BlomeSampleTileView * BlomeSampleGridView::selectTile(int inTileIndex)
+void BlomeSampleGridView::selectTile(int inTileIndex)
 {
     mSelectedSampleTileIndices.add(inTileIndex);
-    BlomeSampleTileView* tile = mSampleTiles.getUnchecked(inTileIndex);
-    tile->setSelected(true);
-    
-    return tile;
-    
+    mTileIsSelected[inTileIndex] = true;
+    repaint(getTileBounds(inTileIndex));
 }
 
 void BlomeSampleGridView::deselectTile(int inTileIndex)
 {
     mSelectedSampleTileIndices.removeAllInstancesOf(inTileIndex);
-    mSampleTiles.getUnchecked(inTileIndex)->setSelected(false);
+    mTileIsSelected[inTileIndex] = false;
+    repaint(getTileBounds(inTileIndex));
 }
 
 void BlomeSampleGridView::mouseUp(MouseEvent const & event)
@@ -379,20 +503,22 @@ void BlomeSampleGridView::mouseUp(MouseEvent const & event)
     bool commandIsDown = event.mods.isCommandDown();
     bool shiftIsDown = event.mods.isShiftDown();
     bool rightMouseIsDown = event.mods.isRightButtonDown();
+    int clickedTileIndex = getTileIndexAt(mousePosition);
     
     // Try right click on selected tiles
-    if (rightMouseIsDown)
+    if (rightMouseIsDown && clickedTileIndex >= 0 && mTileIsSelected[clickedTileIndex])
     {
-        for (int t = 0; t < mSelectedSampleTileIndices.size(); t++)
-        {
-            BlomeSampleTileView* tile = mSampleTiles.getUnchecked(mSelectedSampleTileIndices.getReference(t));
-            
-            if (tile->getBoundsInParent().contains(mousePosition))
-            {
-                showPopupMenu();
-                return;
-            }
-        }
+        showPopupMenu();
+        return;
+    }
+    
+    // Start playback with the tile's play button
+    if (!rightMouseIsDown
+        && clickedTileIndex >= 0
+        && !tileIsEmpty(clickedTileIndex)
+        && mSampleTileView.getPlayButtonBounds(getTileBounds(clickedTileIndex)).contains(mousePosition))
+    {
+        startPlayback(clickedTileIndex);
     }
     
     // Deselect all tiles
@@ -402,20 +528,16 @@ void BlomeSampleGridView::mouseUp(MouseEvent const & event)
     }
     
     // Select or deselect clicked tile
-    for (int t = 0; t < mSampleTiles.size(); t++)
+    if (clickedTileIndex >= 0 && !tileIsEmpty(clickedTileIndex))
     {
-        BlomeSampleTileView* tile = mSampleTiles.getUnchecked(t);
-        
-        if (tile->getBoundsInParent().contains(mousePosition) && tile->getSampleItemFilePath() != EMPTY_TILE_PATH)
+        if (mTileIsSelected[clickedTileIndex])
         {
-            if (tile->getIsSelected())
-            {
-                deselectTile(t);
-            }
-            else
-            {
-                selectTile(t);
-            }
+            deselectTile(clickedTileIndex);
+        }
+        else
+        {
+            selectTile(clickedTileIndex);
+            prefetchNeighbourAttacks(clickedTileIndex);
         }
     }
     
@@ -461,9 +583,8 @@ void BlomeSampleGridView::mouseUp(MouseEvent const & event)
             for (int y = yStart; y <= yEnd; y++)
             {
                 int newSelectedIndex = y * optimalWidth + x;
-                BlomeSampleTileView* tile = mSampleTiles.getUnchecked(newSelectedIndex);
                 
-                if (tile->getSampleItemFilePath() != EMPTY_TILE_PATH)
+                if (newSelectedIndex < mGridItems.size() && !tileIsEmpty(newSelectedIndex))
                 {
                     selectTile(newSelectedIndex);
                 }
@@ -480,34 +601,84 @@ void BlomeSampleGridView::mouseUp(MouseEvent const & event)
     repaint();
 }
 
+void BlomeSampleGridView::mouseDoubleClick(MouseEvent const & event)
+{
+    int clickedTileIndex = getTileIndexAt(event.getEventRelativeTo(this).getPosition());
+    
+    if (clickedTileIndex >= 0)
+    {
+        loadIntoAudioPlayer(clickedTileIndex);
+    }
+}
+
+void BlomeSampleGridView::mouseMove(MouseEvent const & event)
+{
+    Point<int> mousePosition = event.getEventRelativeTo(this).getPosition();
+    int tileIndex = getTileIndexAt(mousePosition);
+    int newHoveredPlayButtonIndex = -1;
+    
+    if (tileIndex >= 0
+        && !tileIsEmpty(tileIndex)
+        && mSampleTileView.getPlayButtonBounds(getTileBounds(tileIndex)).contains(mousePosition))
+    {
+        newHoveredPlayButtonIndex = tileIndex;
+    }
+    
+    setHoveredPlayButton(newHoveredPlayButtonIndex);
+}
+
+void BlomeSampleGridView::mouseExit(MouseEvent const & event)
+{
+    setHoveredPlayButton(-1);
+}
+
+void BlomeSampleGridView::setHoveredPlayButton(int inTileIndex)
+{
+    if (inTileIndex == hoveredPlayButtonIndex)
+    {
+        return;
+    }
+    
+    // Only repaint the tiles whose play button changed
+    if (hoveredPlayButtonIndex >= 0)
+    {
+        repaint(getTileBounds(hoveredPlayButtonIndex));
+    }
+    
+    hoveredPlayButtonIndex = inTileIndex;
+    
+    if (hoveredPlayButtonIndex >= 0)
+    {
+        repaint(getTileBounds(hoveredPlayButtonIndex));
+    }
+}
+
+String BlomeSampleGridView::getTooltip()
+{
+    return hoveredPlayButtonIndex >= 0 ? "Start (K) or stop (L) playback of the selected sample" : String();
+}
+
 void BlomeSampleGridView::mouseDrag(MouseEvent const & mouseEvent)
 {
     // If the drag was at least 50ms after the mouse was pressed
     if (mouseEvent.getLengthOfMousePress() > 100)
     {
         Point<int> mousePosition = mouseEvent.getEventRelativeTo(this).position.toInt();
+        int draggedTileIndex = getTileIndexAt(mousePosition);
         
         // Check if any of the selected tiles was dragged
-        for (int s : mSelectedSampleTileIndices)
+        if (draggedTileIndex >= 0 && mTileIsSelected[draggedTileIndex])
         {
-            BlomeSampleTileView* tile = mSampleTiles.getUnchecked(s);
-            Rectangle<int> tileBounds = tile->getBoundsInParent();
+            StringArray selectedFilePaths;
             
-            if (tileBounds.contains(mousePosition))
+            // Add all selected rows to external drag
+            for (int r : mSelectedSampleTileIndices)
             {
-                StringArray selectedFilePaths;
-                
-                // Add all selected rows to external drag
-                for (int r : mSelectedSampleTileIndices)
-                {
-                    selectedFilePaths.add(mSampleTiles.getUnchecked(r)->getSampleItemFilePath());
-                }
-                
-                DragAndDropContainer* dragContainer = DragAndDropContainer::findParentDragContainerFor(this);
-                dragContainer->performExternalDragDropOfFiles(selectedFilePaths, false, this);
-                
-                return;
+                selectedFilePaths.add(getTileFilePath(r));
             }
+            
+            DragAndDropContainer* dragContainer = DragAndDropContainer::findParentDragContainerFor(this);
+            dragContainer->performExternalDragDropOfFiles(selectedFilePaths, false, this);
         }
     }
 }
@@ -530,7 +701,7 @@ void BlomeSampleGridView::deleteFiles(bool deletePermanently = false)
     
     for (int t : mSelectedSampleTileIndices)
     {
-        filePaths.add(mSampleTiles.getUnchecked(t)->getSampleItemFilePath());
+        filePaths.add(getTileFilePath(t));
     }
     
     sampleLibrary.removeSampleItems(filePaths, deletePermanently);
@@ -542,7 +713,7 @@ void BlomeSampleGridView::addToFavourites()
     
     for (int t : mSelectedSampleTileIndices)
     {
-        filePaths.add(mSampleTiles.getUnchecked(t)->getSampleItemFilePath());
+        filePaths.add(getTileFilePath(t));
     }
     
     sampleLibrary.addAllToFavourites(filePaths);
@@ -554,7 +725,7 @@ void BlomeSampleGridView::reanalyseSamples()
     
     for (int t : mSelectedSampleTileIndices)
     {
-        filePaths.add(mSampleTiles.getUnchecked(t)->getSampleItemFilePath());
+        filePaths.add(getTileFilePath(t));
     }
     
     sampleLibrary.reanalyseSampleItems(filePaths);
@@ -572,36 +743,94 @@ void BlomeSampleGridView::playSelectedSample()
         return;
     }
     
-    mSampleTiles.getUnchecked(mSelectedSampleTileIndices.getReference(0))->startPlayback();
+    startPlayback(mSelectedSampleTileIndices.getReference(0));
+}
+
+void BlomeSampleGridView::startPlayback(int inTileIndex)
+{
+    if (tileIsEmpty(inTileIndex))
+    {
+        return;
+    }
+    
+    File sampleFile = File(getTileFilePath(inTileIndex));
+    
+    // Load file into source
+    if (sampleFile.exists() && !sampleFile.isDirectory() && isSupportedAudioFileFormat(sampleFile.getFileExtension()))
+    {
+        audioPlayer.loadURLIntoTransport(URL(sampleFile), mGridItems.getUnchecked(inTileIndex));
+        audioPlayer.setTransportSourcePosition(0.0);
+        audioPlayer.start();
+    }
+    
+    if (!sampleFile.exists())
+    {
+        audioPlayer.emptyTransport();
+        sampleLibrary.refreshLibrary();
+        AlertWindow::showAsync(MessageBoxOptions()
+                               .withIconType(MessageBoxIconType::NoIcon)
+                               .withTitle("File not available!")
+                               .withMessage("This file has probably been externally deleted and was removed from the list of available samples.")
+                               .withButton("OK"),
+                               nullptr);
+    }
+}
+
+void BlomeSampleGridView::loadIntoAudioPlayer(int inTileIndex)
+{
+    if (!tileIsEmpty(inTileIndex))
+    {
+        File inFile = getTileFilePath(inTileIndex);
+        
+        sampleItemPanel.tryShowAudioResource(inFile);
+    }
+}
+
+void BlomeSampleGridView::prefetchNeighbourAttacks(int inTileIndex)
+{
+    // The selected tile first, then the tiles an arrow key would move to
+    int column = inTileIndex % optimalWidth;
+    Array<int> tileIndices = { inTileIndex,
+        column < optimalWidth - 1 ? inTileIndex + 1 : -1,
+        column > 0 ? inTileIndex - 1 : -1,
+        inTileIndex + optimalWidth,
+        inTileIndex - optimalWidth };
+    StringArray filePaths;
+    
+    for (int tileIndex : tileIndices)
+    {
+        if (tileIndex >= 0 && tileIndex < mGridItems.size() && !tileIsEmpty(tileIndex))
+        {
+            filePaths.add(getTileFilePath(tileIndex));
+        }
+    }
+    
+    audioPlayer.prefetchSampleAttacks(filePaths);
 }
 
 void BlomeSampleGridView::showSampleInFinder()
 {
-    File(mSampleTiles
-         .getUnchecked(mSelectedSampleTileIndices.getLast())
-         ->getSampleItemFilePath())
-    .revealToUser();
+    File(getTileFilePath(mSelectedSampleTileIndices.getLast())).revealToUser();
 }
 
 void BlomeSampleGridView::renameSampleFile()
 {
-    BlomeSampleTileView * tile = mSampleTiles.getUnchecked(mSelectedSampleTileIndices.getLast());
-    String filePath = tile->getSampleItemFilePath();
+    int tileIndex = mSelectedSampleTileIndices.getLast();
+    String filePath = getTileFilePath(tileIndex);
     std::unique_ptr<SampleFileRenamingPanel> renamingPanel = std::make_unique<SampleFileRenamingPanel>(currentProcessor, filePath);
-    CallOutBox::launchAsynchronously(std::move(renamingPanel), tile->getScreenBounds(), nullptr);
+    CallOutBox::launchAsynchronously(std::move(renamingPanel), localAreaToGlobal(getTileBounds(tileIndex)), nullptr);
 }
 
 Point<int> BlomeSampleGridView::showSample(String inFilePath)
 {
     deselectAll();
     
-    for (int t = 0; t < mSampleTiles.size(); t++)
+    for (int t = 0; t < mGridItems.size(); t++)
     {
-        BlomeSampleTileView * tile = mSampleTiles.getUnchecked(t);
-        
-        if (tile->getSampleItemFilePath() == inFilePath)
+        if (getTileFilePath(t) == inFilePath)
         {
-            return getTileCentre(selectTile(t));
+            selectTile(t);
+            return getTileCentre(t);
         }
     }
     
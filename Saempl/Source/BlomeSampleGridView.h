@@ -13,8 +13,10 @@
 #include "BlomeStyling.h"
 #include "SampleLibrary.h"
 #include "BlomeSampleTileView.h"
+#include "SampleItemPanel.h"
 #include "SampleGridClusterer.h"
 #include "SampleFileRenamingPanel.h"
+#include <unordered_set>
 
 /**
  The view class for the sample grid.
@@ -25,7 +27,8 @@ class BlomeSampleGridView
 :
 public Component,
 public ChangeListener,
-public FileDragAndDropTarget
+public FileDragAndDropTarget,
+public TooltipClient
 {
 public:
     BlomeSampleGridView(SaemplAudioProcessor& inProcessor,
@@ -124,25 +127,41 @@ private:
     SampleLibrary& sampleLibrary;
     AudioPlayer& audioPlayer;
     BlomeStyling::StylingPtr style;
-    std::unique_ptr<Grid> mSampleGrid;
     SampleItemPanel& sampleItemPanel;
-    OwnedArray<BlomeSampleTileView> mSampleTiles;
+    BlomeSampleTileView mSampleTileView;
+    Array<SampleItem*> mGridItems;
+    std::vector<bool> mTileIsSelected;
     SampleItemCollectionScope mSampleItemCollectionType;
     Array<int> mSelectedSampleTileIndices;
     OwnedArray<SampleItem> emptySquares;
     StringArray mAddedSampleFilePaths;
     std::unique_ptr<SampleGridClusterer> mGridClusterer;
     bool sampleItemCollectionChanged;
+    String clusteredLibraryPath;
     int optimalWidth;
     int optimalHeight;
     float currentZoomFactor;
     int minTileWidth = 90;
     int maxTileWidth = 200;
+    float tileSize = 0.0;
+    float tileGap = 0.0;
+    int hoveredPlayButtonIndex;
     
     /**
-     Creates tile components for each sample item and adds them to a square grid.
+     Shows the sample items as tiles on the grid.
+     
+     @param inGridItems the sample items and empty squares ordered by grid position.
+     */
+    void setupGrid(Array<SampleItem*> const & inGridItems);
+    /**
+     Updates the shown tiles with an intermediate or final layout published by the grid clusterer.
+     
+     @param inGridSnapshot the sample items and empty squares ordered by grid position.
+     */
+    void showGridSnapshot(Array<SampleItem*> const & inGridSnapshot);
+    /**
+     Draws only the tiles that intersect the clip region, so painting cost scales with the visible tiles.
      */
-    void setupGrid();
     void paint(Graphics& g) override;
     void changeListenerCallback(ChangeBroadcaster* source) override;
     void filesDropped(StringArray const & files, int x, int y) override;
@@ -153,13 +172,11 @@ private:
      */
     void showPopupMenu();
     /**
-     Selects a tile in the grid and returns it.
+     Selects a tile in the grid.
      
      @param inTileIndex the index of the tile in the tile collection.
-     
-     @returns a pointer to the selected tile view object.
      */
-    BlomeSampleTileView* selectTile(int inTileIndex);
+    void selectTile(int inTileIndex);
     /**
      Deselects a tile in the grid.
      
@@ -167,6 +184,62 @@ private:
      */
     void deselectTile(int inTileIndex);
     void mouseUp(MouseEvent const & event) override;
+    void mouseDoubleClick(MouseEvent const & event) override;
+    void mouseMove(MouseEvent const & event) override;
+    void mouseExit(MouseEvent const & event) override;
+    String getTooltip() override;
+    /**
+     Sets the tile whose play button is under the mouse and repaints the affected tiles.
+     
+     @param inTileIndex the index of the tile, -1 if no play button is hovered.
+     */
+    void setHoveredPlayButton(int inTileIndex);
+    /**
+     Calculates the bounds of a tile from its position on the grid.
+     
+     @param inTileIndex the index of the tile in the tile collection.
+     
+     @returns the bounds of the tile relative to the grid.
+     */
+    Rectangle<int> getTileBounds(int inTileIndex);
+    /**
+     Finds the tile at a position on the grid.
+     
+     @param inPosition the position relative to the grid.
+     
+     @returns the index of the tile at the position, -1 if there is none.
+     */
+    int getTileIndexAt(Point<int> inPosition);
+    /**
+     @param inTileIndex the index of the tile in the tile collection.
+     
+     @returns whether the tile is an empty square without a sample.
+     */
+    bool tileIsEmpty(int inTileIndex);
+    /**
+     @param inTileIndex the index of the tile in the tile collection.
+     
+     @returns the file path of the sample shown on the tile.
+     */
+    String getTileFilePath(int inTileIndex);
+    /**
+     Starts playback of the sample shown on a tile.
+     
+     @param inTileIndex the index of the tile in the tile collection.
+     */
+    void startPlayback(int inTileIndex);
+    /**
+     Loads the sample shown on a tile into the sample item panel.
+     
+     @param inTileIndex the index of the tile in the tile collection.
+     */
+    void loadIntoAudioPlayer(int inTileIndex);
+    /**
+     Prefetches the attacks of a tile's sample and of the samples the arrow keys would select next.
+     
+     @param inTileIndex the index of the selected tile in the tile collection.
+     */
+    void prefetchNeighbourAttacks(int inTileIndex);
     /**
      Deletes the files and sample items of the selected tiles.
      
@@ -184,11 +257,11 @@ private:
     /**
      Returns the centre point of a given tile.
      
-     @param inTile a pointer to the tile.
+     @param inTileIndex the index of the tile in the tile collection.
      
      @returns the point of the tile's centre.
      */
-    Point<int> getTileCentre(BlomeSampleTileView* inTile);
+    Point<int> getTileCentre(int inTileIndex);
     /**
      Opens the finder at the location of the chosen sample.
      */
@@ -9,240 +9,397 @@
 
 #include "BlomeSampleTileView.h"
 
-BlomeSampleTileView::BlomeSampleTileView(SampleItem* inSampleItem,
-                                                 SampleLibrary& inSampleLibrary,
-                                                 SampleItemPanel& inSampleItemPanel,
-                                                 AudioPlayer& inAudioPlayer)
-:
-sampleItem(inSampleItem),
-sampleLibrary(inSampleLibrary),
-sampleItemPanel(inSampleItemPanel),
-audioPlayer(inAudioPlayer)
+BlomeSampleTileView::BlomeSampleTileView()
 {
-    sampleItemFilePath = sampleItem->getCurrentFilePath();
-    isSelected = false;
+    cachedTileWidth = 0;
+    cachedTileHeight = 0;
+    mPlayButtonImage = ImageCache::getFromMemory(BinaryData::play_pause_FILL0_wght400_GRAD0_opsz24_png,
+                                                 BinaryData::play_pause_FILL0_wght400_GRAD0_opsz24_pngSize);
+    mWaveformAtlas = Image(Image::SingleChannel,
+                           waveformSlotWidth * numWaveformAtlasColumns,
+                           waveformSlotHeight * numWaveformAtlasRows,
+                           true);
     
-    if (sampleItemFilePath == EMPTY_TILE_PATH)
-    {
-        return;
-    }
-    
-    // Add play button component
-    setPlayButton();
+    // Start thread for rendering the tile waveforms
+    mWaveformThread = std::make_unique<TimeSliceThread>("TileWaveformThread");
+    mWaveformThread->addTimeSliceClient(this);
+    mWaveformThread->startThread(Thread::Priority::low);
 }
 
 BlomeSampleTileView::~BlomeSampleTileView()
 {
-    
+    mWaveformThread->removeTimeSliceClient(this);
+    mWaveformThread->stopThread(10000);
 }
 
-void BlomeSampleTileView::setPlayButton()
+void BlomeSampleTileView::clearTextLayoutCache()
 {
-    mStartStopButton = std::make_unique<BlomeImageButton>("Play/Stop", false);
-    mStartStopButton->setImages(false,
-                                true,
-                                true,
-                                ImageCache::getFromMemory(BinaryData::play_pause_FILL0_wght400_GRAD0_opsz24_png,
-                                                          BinaryData::play_pause_FILL0_wght400_GRAD0_opsz24_pngSize),
-                                style->BUTTON_IS_DEFAULT_ALPHA,
-                                style->COLOUR_HEADER_BUTTONS,
-                                Image(),
-                                style->BUTTON_IS_OVER_ALPHA,
-                                style->COLOUR_HEADER_BUTTONS,
-                                Image(),
-                                style->BUTTON_IS_DOWN_ALPHA,
-                                style->COLOUR_HEADER_BUTTONS);
-    mStartStopButton->setTooltip("Start (K) or stop (L) playback of the selected sample");
-    mStartStopButton->setWantsKeyboardFocus(false);
-    mStartStopButton->onClick = [this]
-    {
-        startPlayback();
-    };
-    addAndMakeVisible(*mStartStopButton);
+    mTextLayoutCache.clear();
+    mTextLayoutOrder.clear();
 }
 
-void BlomeSampleTileView::startPlayback()
+bool BlomeSampleTileView::textLayoutMatches(TileTextLayout const & inTextLayout, SampleItem* inSampleItem)
 {
-    if (sampleItemFilePath == EMPTY_TILE_PATH)
-    {
-        return;
-    }
-    
-    File sampleFile = File(sampleItemFilePath);
-    
-    // Load file into source
-    if (sampleFile.exists() && !sampleFile.isDirectory() && isSupportedAudioFileFormat(sampleFile.getFileExtension()))
-    {
-        audioPlayer.loadURLIntoTransport(URL(sampleFile));
-        audioPlayer.setTransportSourcePosition(0.0);
-        audioPlayer.start();
-    }
-    
-    if (!sampleFile.exists())
-    {
-        audioPlayer.emptyTransport();
-        sampleLibrary.refreshLibrary();
-        AlertWindow::showAsync(MessageBoxOptions()
-                               .withIconType(MessageBoxIconType::NoIcon)
-                               .withTitle("File not available!")
-                               .withMessage("This file has probably been externally deleted and was removed from the list of available samples.")
-                               .withButton("OK"),
-                               nullptr);
-    }
-}
-
-String BlomeSampleTileView::getSampleItemFilePath()
-{
-    if (sampleItemFilePath == EMPTY_TILE_PATH)
-    {
-        return sampleItemFilePath;
-    }
-    else
-    {
-        return sampleItem->getCurrentFilePath();
-    }
-}
-
-void BlomeSampleTileView::setSelected(bool inIsSelected)
-{
-    isSelected = inIsSelected;
-}
-
-bool BlomeSampleTileView::getIsSelected()
-{
-    return isSelected;
-}
-
-void BlomeSampleTileView::loadIntoAudioPlayer()
-{
-    if (sampleItemFilePath != EMPTY_TILE_PATH)
-    {
-        File inFile = sampleItem->getCurrentFilePath();
-        
-        sampleItemPanel.tryShowAudioResource(inFile);
-    }
+    return inTextLayout.filePath == inSampleItem->getCurrentFilePath()
+    && inTextLayout.title == inSampleItem->getTitle()
+    && inTextLayout.analysisRevision == inSampleItem->getAnalysisRevision();
 }
 
-void BlomeSampleTileView::paint(Graphics& g)
+BlomeSampleTileView::TileTextLayout& BlomeSampleTileView::getTextLayout(SampleItem* inSampleItem, int inTileWidth, int inTileHeight)
 {
-    // Don't draw an empty tile
-    if (sampleItemFilePath == EMPTY_TILE_PATH)
+    // All tiles share one size, so a zoom change invalidates every layout
+    if (inTileWidth != cachedTileWidth || inTileHeight != cachedTileHeight)
     {
-        return;
+        clearTextLayoutCache();
+        cachedTileWidth = inTileWidth;
+        cachedTileHeight = inTileHeight;
     }
     
-    Rectangle<float> bounds = getLocalBounds().toFloat().reduced(0.5);
+    auto cachedLayout = mTextLayoutCache.find(inSampleItem);
     
-    // Draw background
-    if (isSelected)
+    if (cachedLayout != mTextLayoutCache.end())
     {
-        g.setColour(style->COLOUR_ACCENT_LIGHT);
-        g.fillRoundedRectangle(bounds, style->CORNER_SIZE_MEDIUM);
+        // Mark the layout as recently drawn
+        mTextLayoutOrder.splice(mTextLayoutOrder.begin(), mTextLayoutOrder, cachedLayout->second.orderPosition);
+        
+        if (textLayoutMatches(cachedLayout->second, inSampleItem))
+        {
+            return cachedLayout->second;
+        }
+        
+        // The sample item changed or its address was reused by another one
+        cachedLayout->second.titleGlyphs.clear();
+        cachedLayout->second.propertyGlyphs.clear();
     }
     else
     {
-        g.setColour(style->COLOUR_ACCENT_DARK);
-        g.drawRoundedRectangle(bounds, style->CORNER_SIZE_MEDIUM, 1.0);
+        if ((int) mTextLayoutCache.size() >= maxNumTextLayouts)
+        {
+            mTextLayoutCache.erase(mTextLayoutOrder.back());
+            mTextLayoutOrder.pop_back();
+        }
+        
+        mTextLayoutOrder.push_front(inSampleItem);
+        mTextLayoutCache[inSampleItem].orderPosition = mTextLayoutOrder.begin();
     }
     
-    // Draw sample text
-    String title = sampleItem->getTitle();
-    g.setFont(style->FONT_SMALL_BOLD);
-    g.setColour(style->COLOUR_ACCENT_DARK);
+    TileTextLayout& textLayout = mTextLayoutCache[inSampleItem];
+    textLayout.filePath = inSampleItem->getCurrentFilePath();
+    textLayout.title = inSampleItem->getTitle();
+    textLayout.analysisRevision = inSampleItem->getAnalysisRevision();
+    Rectangle<float> bounds = Rectangle<int>(0, 0, inTileWidth, inTileHeight).toFloat().reduced(0.5);
     
+    // Lay out sample title
+    String title = inSampleItem->getTitle();
     int maxTitleLength = 25;
+    
     if (title.length() > maxTitleLength)
     {
         title = title.substring(0, maxTitleLength - 3) + "...";
     }
     
-    g.drawFittedText(title,
-                     bounds.reduced(style->PANEL_MARGIN).toNearestInt(),
-                     Justification::topLeft,
-                     5);
+    Rectangle<float> titleBounds = bounds.reduced(style->PANEL_MARGIN).toNearestInt().toFloat();
+    textLayout.titleGlyphs.addFittedText(style->FONT_SMALL_BOLD,
+                                         title,
+                                         titleBounds.getX(),
+                                         titleBounds.getY(),
+                                         titleBounds.getWidth(),
+                                         titleBounds.getHeight(),
+                                         Justification::topLeft,
+                                         5);
     
     // Make text dependent on tile size
     String other = "";
-    int currentWidth = getWidth();
     
-    if (currentWidth > 90)
+    if (inTileWidth > 90)
     {
         other = other
         + "\n\n"
         + " - Key: "
-        + KEY_INDEX_TO_KEY_NAME[sampleItem->getKey()];
+        + KEY_INDEX_TO_KEY_NAME[inSampleItem->getKey()];
         other = other
         + "\n"
         + " - Tempo: "
-        + std::to_string(sampleItem->getTempo())
+        + std::to_string(inSampleItem->getTempo())
         + "bpm";
         other = other
         + "\n"
         + " - Dyn. Range: "
-        + String::toDecimalStringWithSignificantFigures(sampleItem->getDynamicRange(), 2)
+        + String::toDecimalStringWithSignificantFigures(inSampleItem->getDynamicRange(), 2)
         + "LUFS";
         other = other
         + "\n"
         + " - Avg. Freq: "
-        + String::toDecimalStringWithSignificantFigures(sampleItem->getSpectralCentroid(), 2)
+        + String::toDecimalStringWithSignificantFigures(inSampleItem->getSpectralCentroid(), 2)
         + "Hz";
         other = other
         + "\n"
         + " - Rolloff: "
-        + String::toDecimalStringWithSignificantFigures(sampleItem->getSpectralRolloff(), 2)
+        + String::toDecimalStringWithSignificantFigures(inSampleItem->getSpectralRolloff(), 2)
         + "%";
         other = other
         + "\n"
         + " - Freq. Spread: "
-        + String::toDecimalStringWithSignificantFigures(sampleItem->getSpectralSpread(), 2)
+        + String::toDecimalStringWithSignificantFigures(inSampleItem->getSpectralSpread(), 2)
         + "%";
     }
-    if (currentWidth > 150)
+    if (inTileWidth > 150)
     {
         other = other
         + "\n"
         + " - Freq. Flux: "
-        + String::toDecimalStringWithSignificantFigures(sampleItem->getSpectralFlux(), 2)
+        + String::toDecimalStringWithSignificantFigures(inSampleItem->getSpectralFlux(), 2)
         + "%";
         other = other
         + "\n"
         + " - Harm. Flux: "
-        + String::toDecimalStringWithSignificantFigures(sampleItem->getChromaFlux(), 2)
+        + String::toDecimalStringWithSignificantFigures(inSampleItem->getChromaFlux(), 2)
         + "%";
         other = other
         + "\n"
         + " - Length: "
-        + String::toDecimalStringWithSignificantFigures(sampleItem->getLength(), 2)
+        + String::toDecimalStringWithSignificantFigures(inSampleItem->getLength(), 2)
         + "s";
         other = other
         + "\n"
         + " - Loudness: "
-        + String::toDecimalStringWithSignificantFigures(sampleItem->getLoudnessLUFS(), 2)
+        + String::toDecimalStringWithSignificantFigures(inSampleItem->getLoudnessLUFS(), 2)
         + "LUFS";
         other = other
         + "\n"
         + " - ZCR: "
-        + String::toDecimalStringWithSignificantFigures(sampleItem->getZeroCrossingRate(), 2)
+        + String::toDecimalStringWithSignificantFigures(inSampleItem->getZeroCrossingRate(), 2)
         + "Hz";
     }
     
-    g.drawFittedText(other,
-                     bounds.reduced(style->PANEL_MARGIN).removeFromBottom(getHeight() - 25).removeFromTop(getHeight() - 25 - style->BUTTON_SIZE_MEDIUM - style->PANEL_MARGIN).toNearestInt(),
-                     Justification::topLeft,
-                     5);
+    Rectangle<float> propertyBounds = bounds.reduced(style->PANEL_MARGIN).removeFromBottom(inTileHeight - 25).removeFromTop(inTileHeight - 25 - style->BUTTON_SIZE_MEDIUM - style->PANEL_MARGIN).toNearestInt().toFloat();
+    textLayout.propertyGlyphs.addFittedText(style->FONT_SMALL_BOLD,
+                                            other,
+                                            propertyBounds.getX(),
+                                            propertyBounds.getY(),
+                                            propertyBounds.getWidth(),
+                                            propertyBounds.getHeight(),
+                                            Justification::topLeft,
+                                            5);
+    
+    return textLayout;
 }
 
-void BlomeSampleTileView::mouseDoubleClick(MouseEvent const & event)
+Rectangle<int> BlomeSampleTileView::getWaveformSlotBounds(int inSlotIndex)
 {
-    loadIntoAudioPlayer();
+    return Rectangle<int>((inSlotIndex % numWaveformAtlasColumns) * waveformSlotWidth,
+                          (inSlotIndex / numWaveformAtlasColumns) * waveformSlotHeight,
+                          waveformSlotWidth,
+                          waveformSlotHeight);
 }
 
-void BlomeSampleTileView::resized()
+void BlomeSampleTileView::drawWaveform(Graphics& g, String const & inFilePath, Rectangle<int> inWaveformBounds)
 {
-    if (mStartStopButton != nullptr)
+    auto slot = mWaveformSlots.find(inFilePath);
+    
+    if (slot != mWaveformSlots.end())
     {
-        Rectangle<float> buttonBounds = getLocalBounds().toFloat().reduced(style->PANEL_MARGIN * 0.5);
-        buttonBounds = buttonBounds.removeFromBottom(style->BUTTON_SIZE_MEDIUM).removeFromRight(style->BUTTON_SIZE_MEDIUM);
-        mStartStopButton->setBounds(buttonBounds.toNearestInt());
+        // Mark the waveform as recently drawn
+        mWaveformSlotOrder.splice(mWaveformSlotOrder.begin(), mWaveformSlotOrder, slot->second.orderPosition);
+        
+        Rectangle<int> slotBounds = getWaveformSlotBounds(slot->second.slotIndex);
+        g.drawImage(mWaveformAtlas,
+                    inWaveformBounds.getX(),
+                    inWaveformBounds.getY(),
+                    inWaveformBounds.getWidth(),
+                    inWaveformBounds.getHeight(),
+                    slotBounds.getX(),
+                    slotBounds.getY(),
+                    slotBounds.getWidth(),
+                    slotBounds.getHeight(),
+                    true);
+        return;
+    }
+    
+    if (mMissingWaveformPaths.count(inFilePath) != 0 || mRequestedWaveformPaths.count(inFilePath) != 0)
+    {
+        return;
+    }
+    
+    // Request the waveform, the most recently drawn tiles are rendered first
+    mRequestedWaveformPaths.insert(inFilePath);
+    StringArray droppedFilePaths;
+    
+    {
+        const ScopedLock lock(mWaveformLock);
+        mWaveformRequests.push_front(inFilePath);
+        
+        // Drop the requests of tiles that were scrolled past long ago
+        while (mWaveformRequests.size() > numWaveformAtlasColumns * numWaveformAtlasRows)
+        {
+            droppedFilePaths.add(mWaveformRequests.back());
+            mWaveformRequests.pop_back();
+        }
+    }
+    
+    for (String const & droppedFilePath : droppedFilePaths)
+    {
+        mRequestedWaveformPaths.erase(droppedFilePath);
     }
+    
+    mWaveformThread->moveToFrontOfQueue(this);
+}
+
+int BlomeSampleTileView::useTimeSlice()
+{
+    String filePath;
+    
+    {
+        const ScopedLock lock(mWaveformLock);
+        
+        if (mWaveformRequests.empty())
+        {
+            return 500;
+        }
+        
+        filePath = mWaveformRequests.front();
+        mWaveformRequests.pop_front();
+    }
+    
+    // Samples without a cached waveform get an invalid image and are not requested again
+    SampleWaveform waveform;
+    Image waveformImage;
+    
+    if (waveform.loadFromCache(File(filePath)))
+    {
+        waveformImage = Image(Image::SingleChannel, waveformSlotWidth, waveformSlotHeight, true, SoftwareImageType());
+        Graphics g(waveformImage);
+        g.setColour(Colours::white);
+        waveform.drawChannels(g, waveformImage.getBounds(), 0.0, waveform.getLengthInSeconds());
+    }
+    
+    {
+        const ScopedLock lock(mWaveformLock);
+        mRenderedWaveforms.emplace_back(filePath, waveformImage);
+    }
+    
+    sendChangeMessage();
+    
+    return 0;
+}
+
+void BlomeSampleTileView::updateWaveformAtlas()
+{
+    std::vector<std::pair<String, Image>> renderedWaveforms;
+    
+    {
+        const ScopedLock lock(mWaveformLock);
+        renderedWaveforms.swap(mRenderedWaveforms);
+    }
+    
+    for (auto const & renderedWaveform : renderedWaveforms)
+    {
+        String const & filePath = renderedWaveform.first;
+        mRequestedWaveformPaths.erase(filePath);
+        
+        if (!renderedWaveform.second.isValid())
+        {
+            mMissingWaveformPaths.insert(filePath);
+            continue;
+        }
+        
+        // Take a free slot or the one of the least recently drawn waveform
+        int slotIndex = (int) mWaveformSlots.size();
+        
+        if (slotIndex == numWaveformAtlasColumns * numWaveformAtlasRows)
+        {
+            auto evictedSlot = mWaveformSlots.find(mWaveformSlotOrder.back());
+            slotIndex = evictedSlot->second.slotIndex;
+            mWaveformSlots.erase(evictedSlot);
+            mWaveformSlotOrder.pop_back();
+        }
+        
+        // Copy the rendered waveform into its slot
+        Rectangle<int> slotBounds = getWaveformSlotBounds(slotIndex);
+        Image::BitmapData atlasData(mWaveformAtlas,
+                                    slotBounds.getX(),
+                                    slotBounds.getY(),
+                                    slotBounds.getWidth(),
+                                    slotBounds.getHeight(),
+                                    Image::BitmapData::writeOnly);
+        Image::BitmapData waveformData(renderedWaveform.second, Image::BitmapData::readOnly);
+        
+        for (int y = 0; y < slotBounds.getHeight(); y++)
+        {
+            memcpy(atlasData.getLinePointer(y), waveformData.getLinePointer(y), (size_t) (slotBounds.getWidth() * atlasData.pixelStride));
+        }
+        
+        mWaveformSlotOrder.push_front(filePath);
+        mWaveformSlots[filePath] = { slotIndex, mWaveformSlotOrder.begin() };
+    }
+}
+
+void BlomeSampleTileView::clearMissingWaveforms()
+{
+    mMissingWaveformPaths.clear();
+}
+
+Rectangle<int> BlomeSampleTileView::getPlayButtonBounds(Rectangle<int> inTileBounds)
+{
+    Rectangle<float> buttonBounds = inTileBounds.toFloat().reduced(style->PANEL_MARGIN * 0.5);
+    buttonBounds = buttonBounds.removeFromBottom(style->BUTTON_SIZE_MEDIUM).removeFromRight(style->BUTTON_SIZE_MEDIUM);
+    
+    return buttonBounds.toNearestInt();
+}
+
+void BlomeSampleTileView::paintTile(Graphics& g,
+                                    SampleItem* inSampleItem,
+                                    Rectangle<int> inTileBounds,
+                                    bool isSelected,
+                                    bool playButtonIsOver)
+{
+    // Don't draw an empty tile
+    if (inSampleItem->getCurrentFilePath() == EMPTY_TILE_PATH)
+    {
+        return;
+    }
+    
+    Rectangle<float> bounds = inTileBounds.toFloat().reduced(0.5);
+    int tileHeight = inTileBounds.getHeight();
+    
+    // Draw background
+    if (isSelected)
+    {
+        g.setColour(style->COLOUR_ACCENT_LIGHT);
+        g.fillRoundedRectangle(bounds, style->CORNER_SIZE_MEDIUM);
+    }
+    else
+    {
+        g.setColour(style->COLOUR_ACCENT_DARK);
+        g.drawRoundedRectangle(bounds, style->CORNER_SIZE_MEDIUM, 1.0);
+    }
+    
+    // Draw the cached sample text
+    TileTextLayout& textLayout = getTextLayout(inSampleItem, inTileBounds.getWidth(), tileHeight);
+    AffineTransform tileTransform = AffineTransform::translation(inTileBounds.getX(), inTileBounds.getY());
+    g.setColour(style->COLOUR_ACCENT_DARK);
+    textLayout.titleGlyphs.draw(g, tileTransform);
+    textLayout.propertyGlyphs.draw(g, tileTransform);
+    
+    // Draw the mini waveform next to the play button
+    Rectangle<int> playButtonBounds = getPlayButtonBounds(inTileBounds);
+    Rectangle<int> waveformBounds = inTileBounds
+        .reduced(style->PANEL_MARGIN * 0.5)
+        .withTop(playButtonBounds.getY())
+        .withRight(playButtonBounds.getX() - style->PANEL_MARGIN * 0.5)
+        .withBottom(playButtonBounds.getBottom());
+    
+    if (!waveformBounds.isEmpty())
+    {
+        g.setColour(style->COLOUR_ACCENT_DARK.withMultipliedAlpha(0.6f));
+        drawWaveform(g, inSampleItem->getCurrentFilePath(), waveformBounds);
+    }
+    
+    // Draw play button
+    float buttonAlpha = playButtonIsOver ? style->BUTTON_IS_OVER_ALPHA : style->BUTTON_IS_DEFAULT_ALPHA;
+    g.setColour(style->COLOUR_HEADER_BUTTONS.withMultipliedAlpha(buttonAlpha));
+    g.drawImage(mPlayButtonImage,
+                getPlayButtonBounds(inTileBounds).toFloat(),
+                RectanglePlacement::stretchToFit,
+                true);
 }
@@ -11,58 +11,139 @@
 
 #include "JuceHeader.h"
 #include "SampleItem.h"
-#include "SampleItemPanel.h"
+#include "BlomeStyling.h"
+#include "SampleWaveform.h"
+#include <list>
+#include <set>
 
 /**
- The view class for tiles on the grid that each represent a sample item.
+ The view class that draws the tiles of the sample grid, each representing a sample item.
+ 
+ The tiles are no components themselves, the grid only asks this class to draw the tiles that are visible.
+ Mini waveforms of the tiles are rendered from the cached sample waveforms on a background thread
+ and kept in a shared atlas image, a change message is sent whenever new waveforms are ready to be drawn.
  */
 class BlomeSampleTileView
 :
-public Component
+public ChangeBroadcaster,
+private TimeSliceClient
 {
 public:
-    BlomeSampleTileView(SampleItem* inSampleItem,
-                            SampleLibrary& inSampleLibrary,
-                            SampleItemPanel& inSampleItemPanel,
-                            AudioPlayer& inAudioPlayer);
+    BlomeSampleTileView();
     ~BlomeSampleTileView();
     /**
-     @returns the title of the sample item linked to the view.
+     Draws a tile for the given sample item.
+     
+     @param g the graphics object.
+     @param inSampleItem the sample item to show on the tile.
+     @param inTileBounds the bounds of the tile.
+     @param isSelected whether the tile is selected or not.
+     @param playButtonIsOver whether the mouse is over the tile's play button.
      */
-    String getSampleItemFilePath();
+    void paintTile(Graphics& g,
+                   SampleItem* inSampleItem,
+                   Rectangle<int> inTileBounds,
+                   bool isSelected,
+                   bool playButtonIsOver);
     /**
-     Sets the selection toggle of the tile.
+     Calculates where the play button is drawn on a tile.
+     
+     @param inTileBounds the bounds of the tile.
      
-     @param inIsSelected whether the tile is now selected or not.
+     @returns the bounds of the play button inside the given tile bounds.
      */
-    void setSelected(bool inIsSelected);
+    Rectangle<int> getPlayButtonBounds(Rectangle<int> inTileBounds);
     /**
-     @returns whether the tile is selected or not.
+     Discards all cached tile text layouts, e.g. after the sample items were changed or replaced.
      */
-    bool getIsSelected();
+    void clearTextLayoutCache();
     /**
-     Tries to load the item's file into the audio player.
+     Copies the waveforms that finished rendering into the atlas, evicting the least recently drawn ones if it is full.
      */
-    void loadIntoAudioPlayer();
+    void updateWaveformAtlas();
     /**
-     Loads the sample into the grid's audio player and starts playback.
+     Forgets which samples had no cached waveform, so they are tried again after they were analysed.
      */
-    void startPlayback();
+    void clearMissingWaveforms();
     
 private:
-    SampleItem* sampleItem;
-    SampleLibrary& sampleLibrary;
-    SampleItemPanel& sampleItemPanel;
-    AudioPlayer& audioPlayer;
-    std::unique_ptr<BlomeImageButton> mStartStopButton;
+    /**
+     The laid out title and property text of a tile, positioned relative to the tile's origin.
+     */
+    struct TileTextLayout
+    {
+        GlyphArrangement titleGlyphs;
+        GlyphArrangement propertyGlyphs;
+        // The sample item state the layout was made from, a reanalysed or replaced sample item invalidates it
+        String filePath;
+        String title;
+        int analysisRevision;
+        std::list<SampleItem*>::iterator orderPosition;
+    };
+    
+    /**
+     The place of a sample's waveform in the atlas and in the least recently drawn order.
+     */
+    struct WaveformSlot
+    {
+        int slotIndex;
+        std::list<String>::iterator orderPosition;
+    };
+    
     BlomeStyling::StylingPtr style;
-    String sampleItemFilePath;
-    bool isSelected;
+    Image mPlayButtonImage;
+    std::map<SampleItem*, TileTextLayout> mTextLayoutCache;
+    std::list<SampleItem*> mTextLayoutOrder;
+    int cachedTileWidth;
+    int cachedTileHeight;
+    std::unique_ptr<TimeSliceThread> mWaveformThread;
+    Image mWaveformAtlas;
+    std::map<String, WaveformSlot> mWaveformSlots;
+    std::list<String> mWaveformSlotOrder;
+    std::set<String> mRequestedWaveformPaths;
+    std::set<String> mMissingWaveformPaths;
+    CriticalSection mWaveformLock;
+    std::list<String> mWaveformRequests;
+    std::vector<std::pair<String, Image>> mRenderedWaveforms;
+    static int const waveformSlotWidth = 160;
+    static int const waveformSlotHeight = 32;
+    static int const numWaveformAtlasColumns = 8;
+    // The atlas holds 1024 waveforms, which caps its memory at about five megabytes
+    static int const numWaveformAtlasRows = 128;
+    // Enough for a few screens of the smallest tiles, so scrolling doesn't lay out the same tiles again
+    static int const maxNumTextLayouts = 2048;
     
-    void paint(Graphics& g) override;
-    void mouseDoubleClick (MouseEvent const & event) override;
-    void resized() override;
-    void setPlayButton();
+    /**
+     Returns the cached text layout for a sample item's tile and lays it out if there is none for the current tile size
+     or the sample item changed, evicting the least recently drawn layout if the cache is full.
+     
+     @param inSampleItem the sample item shown on the tile.
+     @param inTileWidth the width of the tile.
+     @param inTileHeight the height of the tile.
+     
+     @returns the text layout of the tile.
+     */
+    TileTextLayout& getTextLayout(SampleItem* inSampleItem, int inTileWidth, int inTileHeight);
+    /**
+     @returns whether a text layout was made from the current properties of a sample item.
+     */
+    static bool textLayoutMatches(TileTextLayout const & inTextLayout, SampleItem* inSampleItem);
+    /**
+     Draws the mini waveform of a tile's sample, or requests it from the background thread if it isn't in the atlas yet.
+     
+     @param g the graphics object.
+     @param inFilePath the path of the sample file.
+     @param inWaveformBounds the area to draw the waveform in.
+     */
+    void drawWaveform(Graphics& g, String const & inFilePath, Rectangle<int> inWaveformBounds);
+    /**
+     @returns the area of a slot in the waveform atlas.
+     */
+    Rectangle<int> getWaveformSlotBounds(int inSlotIndex);
+    /**
+     Renders the next requested waveform.
+     */
+    int useTimeSlice() override;
     
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(BlomeSampleTileView);
 };
@@ -72,7 +72,7 @@ struct BlomeStyling
     int const SAMPLE_NAVIGATION_PANEL_HEIGHT = CENTRE_PANEL_HEIGHT - SAMPLE_ITEM_PANEL_HEIGHT;
     
     int const GRID_OPTIONS_PANEL_WIDTH = 300;
-    int const GRID_OPTIONS_PANEL_HEIGHT = 465;
+    int const GRID_OPTIONS_PANEL_HEIGHT = 581;
     
     int const SAMPLE_CONTROL_WIDTH = 45;
     int const SAMPLE_CONTROL_HEIGHT = SAMPLE_ITEM_PANEL_HEIGHT;
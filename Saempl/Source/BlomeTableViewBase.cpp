@@ -9,6 +9,29 @@
 
 #include "BlomeTableViewBase.h"
 
+using CellFormatter = String (*)(SampleItem*);
+
+/**
+ Formats the property of a sample item for each table column, indexed by the column's property index.
+ */
+static CellFormatter const CELL_FORMATTERS[] =
+{
+    [] (SampleItem* inSampleItem) -> String { return inSampleItem->getTitle(); },
+    [] (SampleItem* inSampleItem) -> String { return String::toDecimalStringWithSignificantFigures(inSampleItem->getLength(), 2) + "s"; },
+    [] (SampleItem* inSampleItem) -> String { return String::toDecimalStringWithSignificantFigures(inSampleItem->getLoudnessDecibel(), 2) + "dB"; },
+    [] (SampleItem* inSampleItem) -> String { return String::toDecimalStringWithSignificantFigures(inSampleItem->getLoudnessLUFS(), 2) + "LUFS"; },
+    [] (SampleItem* inSampleItem) -> String { return inSampleItem->getTempo() == 0 ? "No tempo detected" : std::to_string(inSampleItem->getTempo()) + "bpm"; },
+    [] (SampleItem* inSampleItem) -> String { return KEY_INDEX_TO_KEY_NAME[inSampleItem->getKey()]; },
+    [] (SampleItem* inSampleItem) -> String { return String::toDecimalStringWithSignificantFigures(inSampleItem->getDynamicRange(), 2) + "LUFS"; },
+    [] (SampleItem* inSampleItem) -> String { return String::toDecimalStringWithSignificantFigures(inSampleItem->getSpectralCentroid(), 2) + "Hz"; },
+    [] (SampleItem* inSampleItem) -> String { return String::toDecimalStringWithSignificantFigures(inSampleItem->getSpectralRolloff(), 2) + "%"; },
+    [] (SampleItem* inSampleItem) -> String { return String::toDecimalStringWithSignificantFigures(inSampleItem->getSpectralSpread(), 2) + "%"; },
+    [] (SampleItem* inSampleItem) -> String { return String::toDecimalStringWithSignificantFigures(inSampleItem->getSpectralFlux(), 2) + "%"; },
+    [] (SampleItem* inSampleItem) -> String { return String::toDecimalStringWithSignificantFigures(inSampleItem->getChromaFlux(), 2) + "%"; },
+    [] (SampleItem* inSampleItem) -> String { return String::toDecimalStringWithSignificantFigures(inSampleItem->getZeroCrossingRate(), 2) + "Hz"; },
+};
+static int const NUM_CELL_FORMATTERS = sizeof(CELL_FORMATTERS) / sizeof(CellFormatter);
+
 BlomeTableViewBase::BlomeTableViewBase(SaemplAudioProcessor& inProcessor,
                                        SampleItemPanel& inSampleItemPanel,
                                        AudioPlayer& inAudioPlayer)
@@ -18,6 +41,8 @@ sampleLibrary(currentProcessor.getSampleLibrary()),
 sampleItemPanel(inSampleItemPanel),
 audioPlayer(inAudioPlayer)
 {
+    jassert(NUM_CELL_FORMATTERS == PROPERTY_NAMES.size());
+    sampleLibrary.addChangeListener(this);
     mComparator = std::make_unique<SampleItemComparator>();
     
     setModel(this);
@@ -31,6 +56,7 @@ audioPlayer(inAudioPlayer)
 
 BlomeTableViewBase::~BlomeTableViewBase()
 {
+    sampleLibrary.removeChangeListener(this);
     removeMouseListener(this);
 }
 
@@ -88,7 +114,7 @@ void BlomeTableViewBase::paintCell(Graphics& g,
         // Draw cell text
         g.setColour(style->COLOUR_ACCENT_DARK);
         g.setFont(style->FONT_SMALL_BOLD);
-        g.drawText(getCellText(rowSampleItem, getHeader().getColumnName(columnId)),
+        g.drawText(getCellText(rowSampleItem, columnId),
                    2,
                    0,
                    width - 4,
@@ -98,64 +124,58 @@ void BlomeTableViewBase::paintCell(Graphics& g,
     }
 }
 
-String BlomeTableViewBase::getCellText(SampleItem* inSampleItem, String columnName)
+String const & BlomeTableViewBase::getCellText(SampleItem* inSampleItem, int columnId)
 {
-    // Get text for sample item property
-    if (columnName == PROPERTY_NAMES[0])
-    {
-        return inSampleItem->getTitle();
-    }
-    else if (columnName == PROPERTY_NAMES[1])
-    {
-        return String::toDecimalStringWithSignificantFigures(inSampleItem->getLength(), 2) + "s";
-    }
-    else if (columnName == PROPERTY_NAMES[2])
-    {
-        return String::toDecimalStringWithSignificantFigures(inSampleItem->getLoudnessDecibel(), 2) + "dB";
-    }
-    else if (columnName == PROPERTY_NAMES[3])
-    {
-        return String::toDecimalStringWithSignificantFigures(inSampleItem->getLoudnessLUFS(), 2) + "LUFS";
-    }
-    else if (columnName == PROPERTY_NAMES[4])
-    {
-        return inSampleItem->getTempo() == 0 ? "No tempo detected" : std::to_string(inSampleItem->getTempo()) + "bpm";
-    }
-    else if (columnName == PROPERTY_NAMES[5])
-    {
-        return KEY_INDEX_TO_KEY_NAME[inSampleItem->getKey()];
-    }
-    else if (columnName == PROPERTY_NAMES[6])
-    {
-        return String::toDecimalStringWithSignificantFigures(inSampleItem->getDynamicRange(), 2) + "LUFS";
-    }
-    else if (columnName == PROPERTY_NAMES[7])
-    {
-        return String::toDecimalStringWithSignificantFigures(inSampleItem->getSpectralCentroid(), 2) + "Hz";
-    }
-    else if (columnName == PROPERTY_NAMES[8])
-    {
-        return String::toDecimalStringWithSignificantFigures(inSampleItem->getSpectralRolloff(), 2) + "%";
-    }
-    else if (columnName == PROPERTY_NAMES[9])
-    {
-        return String::toDecimalStringWithSignificantFigures(inSampleItem->getSpectralSpread(), 2) + "%";
-    }
-    else if (columnName == PROPERTY_NAMES[10])
+    int columnIndex = jlimit<int>(0, NUM_CELL_FORMATTERS - 1, columnId - 1);
+    auto cachedTexts = mCellTextCache.find(inSampleItem);
+    
+    if (cachedTexts != mCellTextCache.end())
     {
-        return String::toDecimalStringWithSignificantFigures(inSampleItem->getSpectralFlux(), 2) + "%";
+        // Mark the texts as recently drawn
+        mCellTextOrder.splice(mCellTextOrder.begin(), mCellTextOrder, cachedTexts->second.orderPosition);
+        
+        if (cachedTexts->second.filePath == inSampleItem->getCurrentFilePath()
+            && cachedTexts->second.title == inSampleItem->getTitle()
+            && cachedTexts->second.analysisRevision == inSampleItem->getAnalysisRevision())
+        {
+            return cachedTexts->second.texts.getReference(columnIndex);
+        }
     }
-    else if (columnName == PROPERTY_NAMES[11])
+    else
     {
-        return String::toDecimalStringWithSignificantFigures(inSampleItem->getChromaFlux(), 2) + "%";
+        if ((int) mCellTextCache.size() >= maxNumCachedRows)
+        {
+            mCellTextCache.erase(mCellTextOrder.back());
+            mCellTextOrder.pop_back();
+        }
+        
+        mCellTextOrder.push_front(inSampleItem);
+        cachedTexts = mCellTextCache.emplace(inSampleItem, CachedCellTexts()).first;
+        cachedTexts->second.orderPosition = mCellTextOrder.begin();
     }
-    else if (columnName == PROPERTY_NAMES[12])
+    
+    // Format all properties of a sample item the first time one of its cells is drawn
+    CachedCellTexts& cellTexts = cachedTexts->second;
+    cellTexts.filePath = inSampleItem->getCurrentFilePath();
+    cellTexts.title = inSampleItem->getTitle();
+    cellTexts.analysisRevision = inSampleItem->getAnalysisRevision();
+    cellTexts.texts.clearQuick();
+    cellTexts.texts.ensureStorageAllocated(NUM_CELL_FORMATTERS);
+    
+    for (CellFormatter formatter : CELL_FORMATTERS)
     {
-        return String::toDecimalStringWithSignificantFigures(inSampleItem->getZeroCrossingRate(), 2) + "Hz";
+        cellTexts.texts.add(formatter(inSampleItem));
     }
-    else
+    
+    return cellTexts.texts.getReference(columnIndex);
+}
+
+void BlomeTableViewBase::changeListenerCallback(ChangeBroadcaster* source)
+{
+    if (source == &sampleLibrary)
     {
-        return "unknown";
+        mCellTextCache.clear();
+        mCellTextOrder.clear();
     }
 }
 
@@ -229,6 +249,28 @@ void BlomeTableViewBase::returnKeyPressed(int lastRowSelected)
     loadSelectedRowIntoAudioPlayer(lastRowSelected);
 }
 
+void BlomeTableViewBase::selectedRowsChanged(int lastRowSelected)
+{
+    if (lastRowSelected == -1)
+    {
+        return;
+    }
+    
+    // The selected row first, then the rows the arrow keys would move to
+    OwnedArray<SampleItem>& sampleItems = sampleLibrary.getSampleItems(mSampleItemCollectionType);
+    StringArray filePaths;
+    
+    for (int rowNumber : { lastRowSelected, lastRowSelected + 1, lastRowSelected - 1, lastRowSelected + 2 })
+    {
+        if (rowNumber >= 0 && rowNumber < sampleItems.size())
+        {
+            filePaths.add(sampleItems.getUnchecked(rowNumber)->getCurrentFilePath());
+        }
+    }
+    
+    audioPlayer.prefetchSampleAttacks(filePaths);
+}
+
 void BlomeTableViewBase::sortOrderChanged(int newSortColumnId, bool isForwards)
 {
     currentProcessor.setSortingDirection(isForwards);
@@ -240,7 +282,7 @@ void BlomeTableViewBase::sortOrderChanged(int newSortColumnId, bool isForwards)
         currentProcessor.setSortingColumnTitle(columnName);
         mComparator->setCompareProperty(columnName);
         mComparator->setSortingDirection(isForwards);
-        sampleLibrary.getSampleItems(mSampleItemCollectionType).sort(*mComparator);
+        mComparator->sortSampleItems(sampleLibrary.getSampleItems(mSampleItemCollectionType));
         updateContent();
     }
 }
@@ -269,12 +311,13 @@ void BlomeTableViewBase::playSelectedSample()
         return;
     }
     
-    File sampleFile = sampleLibrary.getSampleItems(mSampleItemCollectionType).getUnchecked(selectedRowIndex)->getCurrentFilePath();
+    SampleItem* sampleItem = sampleLibrary.getSampleItems(mSampleItemCollectionType).getUnchecked(selectedRowIndex);
+    File sampleFile = sampleItem->getCurrentFilePath();
     
     // Load file into source
     if (sampleFile.exists() && !sampleFile.isDirectory() && isSupportedAudioFileFormat(sampleFile.getFileExtension()))
     {
-        audioPlayer.loadURLIntoTransport(URL(sampleFile));
+        audioPlayer.loadURLIntoTransport(URL(sampleFile), sampleItem);
         audioPlayer.setTransportSourcePosition(0.0);
         audioPlayer.start();
     }
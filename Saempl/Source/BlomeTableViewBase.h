@@ -14,6 +14,7 @@
 #include "SampleItemComparator.h"
 #include "SampleItem.h"
 #include "SampleItemPanel.h"
+#include <list>
 
 /**
  The base class for displaying SampleItem collections in a table.
@@ -25,7 +26,8 @@ class BlomeTableViewBase
 :
 public TableListBoxModel,
 public TableListBox,
-public FileDragAndDropTarget
+public FileDragAndDropTarget,
+public ChangeListener
 {
 public:
     /**
@@ -45,6 +47,19 @@ public:
     void playSelectedSample();
     
 protected:
+    /**
+     The formatted texts of all columns of a SampleItem, with the state they were formatted from.
+     */
+    struct CachedCellTexts
+    {
+        StringArray texts;
+        // A renamed, reanalysed or replaced sample item invalidates the texts
+        String filePath;
+        String title;
+        int analysisRevision;
+        std::list<SampleItem*>::iterator orderPosition;
+    };
+    
     SaemplAudioProcessor& currentProcessor;
     SampleLibrary& sampleLibrary;
     SampleItemPanel& sampleItemPanel;
@@ -53,6 +68,10 @@ protected:
     std::unique_ptr<SampleItemComparator> mComparator;
     SampleItemCollectionScope mSampleItemCollectionType;
     BlomeStyling::StylingPtr style;
+    std::map<SampleItem*, CachedCellTexts> mCellTextCache;
+    std::list<SampleItem*> mCellTextOrder;
+    // Far more than a table shows at once, so scrolling back only formats rows again after a long way
+    static int const maxNumCachedRows = 1024;
     
     void paint(Graphics& g) override;
     void paintRowBackground(Graphics& g,
@@ -67,14 +86,21 @@ protected:
                    int height,
                    bool rowIsSelected) override;
     /**
-     Gets the text for the property of the SampleItem and the given column name.
+     Gets the formatted text for the property of the SampleItem shown in the given column.
+     
+     The texts of all columns are formatted once per SampleItem and cached for the most recently drawn SampleItems,
+     until the library changes or the SampleItem is reanalysed.
      
      @param inSampleItem the SampleItem from which to get the property value.
-     @param columnName the name of the property to retrieve.
+     @param columnId the id of the column, which is the property index plus one.
      
      @returns the string that represents the property value of the given column.
      */
-    String getCellText(SampleItem* inSampleItem, String columnName);
+    String const & getCellText(SampleItem* inSampleItem, int columnId);
+    /**
+     Clears the cached cell texts when the sample items of the library changed.
+     */
+    void changeListenerCallback(ChangeBroadcaster* source) override;
     int getColumnAutoSizeWidth(int columnId) override;
     /**
      Loads the file of the selected row into the audio player.
@@ -84,6 +110,10 @@ protected:
     void mouseDrag(MouseEvent const & mouseEvent) override;
     bool isInterestedInFileDrag(StringArray const & files) override;
     void returnKeyPressed(int lastRowSelected) override;
+    /**
+     Prefetches the attacks of the selected sample and of its neighbouring rows.
+     */
+    void selectedRowsChanged(int lastRowSelected) override;
     void sortOrderChanged(int newSortColumnId, bool isForwards) override;
     /**
      Reanalyses all selected samples.
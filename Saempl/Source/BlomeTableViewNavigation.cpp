@@ -15,7 +15,6 @@ BlomeTableViewNavigation::BlomeTableViewNavigation(SaemplAudioProcessor& inProce
 :
 BlomeTableViewBase(inProcessor, inSampleItemPanel, inAudioPlayer)
 {
-    sampleLibrary.addChangeListener(this);
     mSampleItemCollectionType = FILTERED_SAMPLES;
     
     // Add all sample item properties as table columns
@@ -39,7 +38,7 @@ BlomeTableViewBase(inProcessor, inSampleItemPanel, inAudioPlayer)
 
 BlomeTableViewNavigation::~BlomeTableViewNavigation()
 {
-    sampleLibrary.removeChangeListener(this);
+    
 }
 
 void BlomeTableViewNavigation::cellClicked(int rowNumber, int columnId, MouseEvent const & mouseEvent)
@@ -95,6 +94,8 @@ void BlomeTableViewNavigation::addToFavourites()
 
 void BlomeTableViewNavigation::changeListenerCallback(ChangeBroadcaster *source)
 {
+    BlomeTableViewBase::changeListenerCallback(source);
+    
     if (source == &sampleLibrary && isShowing())
     {
         resortTable();
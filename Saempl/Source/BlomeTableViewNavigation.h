@@ -19,8 +19,7 @@
  */
 class BlomeTableViewNavigation
 :
-public BlomeTableViewBase,
-public ChangeListener
+public BlomeTableViewBase
 {
 public:
     /**
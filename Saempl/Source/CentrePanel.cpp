@@ -40,9 +40,10 @@ void CentrePanel::paint(Graphics& g)
 void CentrePanel::setPanelComponents()
 {
     // Add audio player
-    mAudioPlayer = std::make_unique<AudioPlayer>();
+    mAudioPlayer = std::make_unique<AudioPlayer>(currentProcessor.getPreviewVoice(PREVIEW_VOICE_NAVIGATION));
     mAudioPlayer->selectOutputDevice(currentProcessor.getOutputDevice());
     mAudioPlayer->setVolumeIsNormalised(currentProcessor.getVolumeIsNormalised());
+    mAudioPlayer->setAttackCacheBudget((size_t) currentProcessor.getPreviewCacheSize() * 1024 * 1024);
     
     // Add panel for sample item view
     mSampleItemPanel = std::make_unique<SampleItemPanel>(currentProcessor);
@@ -189,6 +190,23 @@ void CentrePanel::selectOutputDevice(String inDeviceName)
     mSampleItemPanel->selectOutputDevice(inDeviceName);
 }
 
+void CentrePanel::setPreviewCacheSize(int inPreviewCacheSize)
+{
+    currentProcessor.setPreviewCacheSize(inPreviewCacheSize);
+    mAudioPlayer->setAttackCacheBudget((size_t) inPreviewCacheSize * 1024 * 1024);
+    mSampleItemPanel->setPreviewCacheSize(inPreviewCacheSize);
+}
+
+int CentrePanel::getNumPreviewCacheHits()
+{
+    return mAudioPlayer->getNumAttackCacheHits() + mSampleItemPanel->getNumPreviewCacheHits();
+}
+
+int CentrePanel::getNumPreviewCacheMisses()
+{
+    return mAudioPlayer->getNumAttackCacheMisses() + mSampleItemPanel->getNumPreviewCacheMisses();
+}
+
 void CentrePanel::stopSelectedSample()
 {
     mAudioPlayer->stop();
@@ -56,6 +56,20 @@ public:
      Selects an output device for the audio player objects.
      */
     void selectOutputDevice(String inDeviceName);
+    /**
+     Sets the memory each audio player may use for the attacks of recently previewed samples.
+     
+     @param inPreviewCacheSize the size in megabytes.
+     */
+    void setPreviewCacheSize(int inPreviewCacheSize);
+    /**
+     @returns how many previews of both audio players were started from a cached sample attack.
+     */
+    int getNumPreviewCacheHits();
+    /**
+     @returns how many previews of both audio players had to decode their sample attack from disk.
+     */
+    int getNumPreviewCacheMisses();
     
 private:
     std::unique_ptr<AudioPlayer> mAudioPlayer;
@@ -557,6 +557,70 @@ void HeaderPanel::setChooseOutputDeviceButton(int buttonWidth)
     {
         PopupMenu popupMenu;
         
+        // Play the previews through the plugin's output, optionally starting on the host's beats
+        popupMenu.addItem(HOST_OUTPUT_DEVICE_NAME,
+                          true,
+                          currentProcessor.getOutputDevice() == HOST_OUTPUT_DEVICE_NAME,
+                          [this] { selectOutputDevice(HOST_OUTPUT_DEVICE_NAME); });
+        popupMenu.addItem("Start Previews On Host Beat",
+                          true,
+                          currentProcessor.getPreviewStartIsQuantised(),
+                          [this] { currentProcessor.setPreviewStartIsQuantised(!currentProcessor.getPreviewStartIsQuantised()); });
+        popupMenu.addItem("Match Preview Tempo",
+                          true,
+                          currentProcessor.getPreviewTempoIsMatched(),
+                          [this] { currentProcessor.setPreviewTempoMatching(!currentProcessor.getPreviewTempoIsMatched(), currentProcessor.getPreviewTempo()); });
+        
+        // The chosen tempo is only used if the host doesn't provide one
+        PopupMenu previewTempoMenu;
+        
+        for (int tempo = LOWER_BPM_LIMIT - 5; tempo <= UPPER_BPM_LIMIT; tempo += 5)
+        {
+            previewTempoMenu.addItem(String(tempo) + " BPM",
+                                     true,
+                                     roundToInt(currentProcessor.getPreviewTempo()) == tempo,
+                                     [this, tempo] { currentProcessor.setPreviewTempoMatching(currentProcessor.getPreviewTempoIsMatched(), tempo); });
+        }
+        
+        popupMenu.addSubMenu("Preview Tempo Without Host", previewTempoMenu);
+        
+        // Transpose the previews to a key, e.g. the key of the current project
+        PopupMenu previewKeyMenu;
+        previewKeyMenu.addItem("Original Key",
+                               true,
+                               currentProcessor.getPreviewKey() == NO_KEY_INDEX,
+                               [this] { currentProcessor.setPreviewKey(NO_KEY_INDEX); });
+        
+        for (int key = 0; key < KEY_PATTERNS.size(); key++)
+        {
+            previewKeyMenu.addItem(KEY_INDEX_TO_KEY_NAME[key],
+                                   true,
+                                   currentProcessor.getPreviewKey() == key,
+                                   [this, key] { currentProcessor.setPreviewKey(key); });
+        }
+        
+        popupMenu.addSubMenu("Preview Key", previewKeyMenu);
+        
+        // Memory for the attacks of recently previewed samples, with how often previews could start from it
+        PopupMenu previewCacheMenu;
+        
+        for (int previewCacheSize : { 16, 64, 256 })
+        {
+            previewCacheMenu.addItem(String(previewCacheSize) + " MB",
+                                     true,
+                                     currentProcessor.getPreviewCacheSize() == previewCacheSize,
+                                     [this, previewCacheSize] { centrePanel.setPreviewCacheSize(previewCacheSize); });
+        }
+        
+        previewCacheMenu.addSeparator();
+        previewCacheMenu.addItem(String(centrePanel.getNumPreviewCacheHits()) + " Previews From Cache, "
+                                 + String(centrePanel.getNumPreviewCacheMisses()) + " From Disk",
+                                 false,
+                                 false,
+                                 [] {});
+        popupMenu.addSubMenu("Preview Cache", previewCacheMenu);
+        popupMenu.addSeparator();
+        
         // Add all output devices to popup menu
         for (AudioIODeviceType* deviceType : mAudioDeviceManager->getAvailableDeviceTypes())
         {
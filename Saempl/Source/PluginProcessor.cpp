@@ -23,6 +23,12 @@ SaemplAudioProcessor::SaemplAudioProcessor()
 #endif
 {
     mSampleLibrary = std::make_unique<SampleLibrary>();
+    
+    for (std::unique_ptr<SamplePreviewVoice>& previewVoice : mPreviewVoices)
+    {
+        previewVoice = std::make_unique<SamplePreviewVoice>();
+    }
+    
     mLastOpenedLibraryPath = "";
     mActiveNavigationPanelType = PANELS_LIBRARY_PANEL;
     mSortingColumnTitle = "Title";
@@ -31,15 +37,26 @@ SaemplAudioProcessor::SaemplAudioProcessor()
     mFollowAudioPlayhead = false;
     mFilterIsActivated = true;
     mFeatureWeightsChanged = true;
+    mOutputDevice = HOST_OUTPUT_DEVICE_NAME;
     mVolumeIsNormalised = false;
+    mPreviewStartIsQuantised = false;
+    mPreviewTempoIsMatched = false;
+    mPreviewTempo = 120.0;
+    mPreviewKey = NO_KEY_INDEX;
+    mPreviewCacheSize = 64;
+    mClusterGridInBackground = true;
+    mGridWarmStartIsEnabled = true;
+    mGridSortingQuality = 1.0;
+    mGridLayoutQuality = 0.0;
     mSampleGridZoomFactor = 0.0;
     mOutputGain = 1.0;
     mFeatureWeights = GRID_PRESET_HARMONIC;
+    mLibraryRestoreIsPending = false;
 }
 
 SaemplAudioProcessor::~SaemplAudioProcessor()
 {
-    
+    cancelPendingUpdate();
 }
 
 //==============================================================================
@@ -108,8 +125,10 @@ void SaemplAudioProcessor::changeProgramName(int index, juce::String const & new
 //==============================================================================
 void SaemplAudioProcessor::prepareToPlay(double sampleRate, int samplesPerBlock)
 {
-    // Use this method as the place to do any pre-playback
-    // initialisation that you need..
+    for (std::unique_ptr<SamplePreviewVoice>& previewVoice : mPreviewVoices)
+    {
+        previewVoice->prepareToPlay(sampleRate, samplesPerBlock);
+    }
 }
 
 void SaemplAudioProcessor::releaseResources()
@@ -146,32 +165,30 @@ bool SaemplAudioProcessor::isBusesLayoutSupported(BusesLayout const & layouts) c
 
 void SaemplAudioProcessor::processBlock(juce::AudioBuffer<float>& buffer, juce::MidiBuffer& midiMessages)
 {
-//    juce::ScopedNoDenormals noDenormals;
-//    auto totalNumInputChannels  = getTotalNumInputChannels();
-//    auto totalNumOutputChannels = getTotalNumOutputChannels();
-//
-//    // In case we have more outputs than inputs, this code clears any output
-//    // channels that didn't contain input data, (because these aren't
-//    // guaranteed to be empty - they may contain garbage).
-//    // This is here to avoid people getting screaming feedback
-//    // when they first compile a plugin, but obviously you don't need to keep
-//    // this code if your algorithm always overwrites all the output channels.
-//    for (auto i = totalNumInputChannels; i < totalNumOutputChannels; ++i)
-//    {
-//        buffer.clear (i, 0, buffer.getNumSamples());
-//    }
-//
-//    // This is the place where you'd normally do the guts of your plugin's
-//    // audio processing...
-//    // Make sure to reset the state if your inner loop is processing
-//    // the samples and the outer loop is handling the channels.
-//    // Alternatively, you can process the samples with the channels
-//    // interleaved by keeping the same state.
-//    for (int channel = 0; channel < totalNumInputChannels; ++channel)
-//    {
-//        // auto* channelData = buffer.getWritePointer (channel);
-//        // ..do something to the data...
-//    }
+    juce::ScopedNoDenormals noDenormals;
+    auto totalNumInputChannels  = getTotalNumInputChannels();
+    auto totalNumOutputChannels = getTotalNumOutputChannels();
+    
+    // In case we have more outputs than inputs, this code clears any output
+    // channels that didn't contain input data, (because these aren't
+    // guaranteed to be empty - they may contain garbage).
+    for (auto i = totalNumInputChannels; i < totalNumOutputChannels; ++i)
+    {
+        buffer.clear (i, 0, buffer.getNumSamples());
+    }
+    
+    // The input passes through, the previews are mixed on top of it
+    Optional<AudioPlayHead::PositionInfo> hostPosition;
+    
+    if (AudioPlayHead* playHead = getPlayHead())
+    {
+        hostPosition = playHead->getPosition();
+    }
+    
+    for (std::unique_ptr<SamplePreviewVoice>& previewVoice : mPreviewVoices)
+    {
+        previewVoice->renderNextBlock(buffer, hostPosition);
+    }
 }
 
 //==============================================================================
@@ -188,307 +205,459 @@ juce::AudioProcessorEditor* SaemplAudioProcessor::createEditor()
 //==============================================================================
 void SaemplAudioProcessor::getStateInformation(juce::MemoryBlock& destData)
 {
-    // You should use this method to store your parameters in the memory block.
-    // You could do that either as raw data, or use the XML or ValueTree classes
-    // as intermediaries to make it easy to save and load complex data.
-    XmlElement stateInfo("Blome_StateInfo");
-    XmlElement* stateInfoBody = new XmlElement("Blome_StateInfoBody");
+    // The state is written as a compact binary blob, as hosts store it with every save and undo snapshot
+    MemoryOutputStream stream(destData, false);
+    stream.writeInt(stateInfoMagicNumber);
+    stream.writeCompressedInt(stateInfoVersion);
     
     // Storing states
-    stateInfoBody->setAttribute("ActiveNavigationPanel", NAVIGATION_PANEL_TYPE_TO_STRING[mActiveNavigationPanelType]);
-    stateInfoBody->setAttribute("SortingColumnTitle", mSortingColumnTitle);
-    stateInfoBody->setAttribute("SortingDirection", mSortingDirection);
-    stateInfoBody->setAttribute("SampleItemPanelIsVisible", mSampleItemPanelIsVisible);
-    stateInfoBody->setAttribute("FollowAudioPlayhead", mFollowAudioPlayhead);
-    stateInfoBody->setAttribute("SampleGridZoomFactor", mSampleGridZoomFactor);
-    stateInfoBody->setAttribute("LastOpenedLibraryPath", mLastOpenedLibraryPath);
-    stateInfoBody->setAttribute("OutputDevice", mOutputDevice);
-    stateInfoBody->setAttribute("VolumeIsNormalised", mVolumeIsNormalised);
-    stateInfoBody->setAttribute("OutputGain", mOutputGain);
+    stream.writeCompressedInt(mActiveNavigationPanelType);
+    stream.writeString(mSortingColumnTitle);
+    stream.writeBool(mSortingDirection);
+    stream.writeBool(mSampleItemPanelIsVisible);
+    stream.writeBool(mFollowAudioPlayhead);
+    stream.writeFloat(mSampleGridZoomFactor);
+    stream.writeString(mLastOpenedLibraryPath);
+    stream.writeString(mOutputDevice);
+    stream.writeBool(mVolumeIsNormalised);
+    stream.writeBool(mPreviewStartIsQuantised);
+    stream.writeBool(mPreviewTempoIsMatched);
+    stream.writeFloat(mPreviewTempo);
+    stream.writeCompressedInt(mPreviewKey);
+    stream.writeFloat(mOutputGain);
+    stream.writeBool(mClusterGridInBackground);
+    stream.writeBool(mGridWarmStartIsEnabled);
+    stream.writeFloat(mGridSortingQuality);
     
     // Storing feature weights
-    for (int fw = 0; fw < mFeatureWeights.size(); fw++)
+    stream.writeCompressedInt((int) mFeatureWeights.size());
+    
+    for (float featureWeight : mFeatureWeights)
     {
-        String weightName = "FW" + std::to_string(fw);
-        stateInfoBody->setAttribute(weightName, mFeatureWeights[fw]);
+        stream.writeFloat(featureWeight);
     }
     
-    // Storing filter rules
-    XmlElement* stateInfoFilter = new XmlElement("Blome_StateInfoFilter");
-    stateInfoFilter->setAttribute("FilterIsActivated", mFilterIsActivated);
+    // Use the restored library state if it wasn't applied yet, the library doesn't hold it then
+    std::vector<RestoredFilterRule> filterRules;
+    StringArray favouritesPaths;
     
-    int i = 0;
-    for (SampleFileFilterRuleBase* rule : mSampleLibrary->getFileFilter().getFilterRules())
     {
-        String stateRuleName = "Blome_StateInfoFilterRule" + std::to_string(i++);
-        XmlElement* stateInfoFilterRule = new XmlElement(stateRuleName);
-        
-        // Storing rule parameters
-        stateInfoFilterRule->setAttribute("PropertyName", rule->getRulePropertyName());
-        stateInfoFilterRule->setAttribute("RuleIsActive", rule->getIsActive());
-        stateInfoFilterRule->setAttribute("CompareOperator", COMPARE_OPERATOR_TO_STRING[rule->getCompareOperator()]);
+        ScopedLock lock(mRestoreLock);
         
-        switch(PROPERTY_NAMES.indexOf(rule->getRulePropertyName()))
+        if (mLibraryRestoreIsPending)
         {
-            case 0:
-            {
-                stateInfoFilterRule->setAttribute("CompareValue", dynamic_cast<SampleFileFilterRuleTitle*>(rule)->getCompareValue());
-                break;
-            }
-            case 1:
-            {
-                stateInfoFilterRule->setAttribute("CompareValue", dynamic_cast<SampleFileFilterRuleLength*>(rule)->getCompareValue());
-                break;
-            }
-            case 2:
-            {
-                stateInfoFilterRule->setAttribute("CompareValue", dynamic_cast<SampleFileFilterRuleLoudnessDecibel*>(rule)->getCompareValue());
-                break;
-            }
-            case 3:
-            {
-                stateInfoFilterRule->setAttribute("CompareValue", dynamic_cast<SampleFileFilterRuleLoudnessLUFS*>(rule)->getCompareValue());
-                break;
-            }
-            case 4:
-            {
-                stateInfoFilterRule->setAttribute("CompareValue", dynamic_cast<SampleFileFilterRuleTempo*>(rule)->getCompareValue());
-                break;
-            }
-            case 5:
-            {
-                stateInfoFilterRule->setAttribute("CompareValue", dynamic_cast<SampleFileFilterRuleKey*>(rule)->getCompareValue());
-                break;
-            }
-            case 6:
-            {
-                stateInfoFilterRule->setAttribute("CompareValue", dynamic_cast<SampleFileFilterRuleDynamicRange*>(rule)->getCompareValue());
-                break;
-            }
-            case 7:
-            {
-                stateInfoFilterRule->setAttribute("CompareValue", dynamic_cast<SampleFileFilterRuleCentroid*>(rule)->getCompareValue());
-                break;
-            }
-            case 8:
-            {
-                stateInfoFilterRule->setAttribute("CompareValue", dynamic_cast<SampleFileFilterRuleRolloff*>(rule)->getCompareValue());
-                break;
-            }
-            case 9:
-            {
-                stateInfoFilterRule->setAttribute("CompareValue", dynamic_cast<SampleFileFilterRuleSpectralSpread*>(rule)->getCompareValue());
-                break;
-            }
-            case 10:
-            {
-                stateInfoFilterRule->setAttribute("CompareValue", dynamic_cast<SampleFileFilterRuleSpectralFlux*>(rule)->getCompareValue());
-                break;
-            }
-            case 11:
-            {
-                stateInfoFilterRule->setAttribute("CompareValue", dynamic_cast<SampleFileFilterRuleChromaFlux*>(rule)->getCompareValue());
-                break;
-            }
-            case 12:
-            {
-                stateInfoFilterRule->setAttribute("CompareValue", dynamic_cast<SampleFileFilterRuleZeroCrossingRate*>(rule)->getCompareValue());
-                break;
-            }
-            default:
+            filterRules = mRestoredFilterRules;
+            favouritesPaths = mRestoredFavouritesPaths;
+        }
+        else
+        {
+            for (SampleFileFilterRuleBase* rule : mSampleLibrary->getFileFilter().getFilterRules())
             {
-                jassertfalse;
-                break;
+                filterRules.push_back({ rule->getRulePropertyName(),
+                    rule->getIsActive(),
+                    rule->getCompareOperator(),
+                    getFilterRuleCompareValue(rule) });
             }
+            
+            favouritesPaths = mSampleLibrary->getFavouritesPaths();
         }
-        
-        stateInfoFilter->prependChildElement(stateInfoFilterRule);
     }
     
-    // Storing favourite samples
-    XmlElement* stateInfoSampleFavourites = new XmlElement("Blome_StateInfoSampleFavourites");
+    // Storing filter rules
+    stream.writeBool(mFilterIsActivated);
+    stream.writeCompressedInt((int) filterRules.size());
     
-    for (SampleItem* sample : mSampleLibrary->getSampleItems(FAVOURITE_SAMPLES))
+    for (RestoredFilterRule const & rule : filterRules)
     {
-        XmlElement* stateInfoFavouritesItem = new XmlElement("FavouritesItem");
-        stateInfoFavouritesItem->setAttribute("FilePath", sample->getCurrentFilePath());
-        stateInfoSampleFavourites->prependChildElement(stateInfoFavouritesItem);
+        stream.writeString(rule.propertyName);
+        stream.writeBool(rule.isActive);
+        stream.writeCompressedInt(rule.compareOperator);
+        rule.compareValue.writeToStream(stream);
+    }
+    
+    // Storing favourite samples as paths relative to the library, sorted so each one only stores what differs from the previous one
+    File libraryDirectory = File(mLastOpenedLibraryPath);
+    StringArray favouritesPathIds;
+    
+    for (String const & path : favouritesPaths)
+    {
+        File favouritesFile = File(path);
+        favouritesPathIds.add(favouritesFile.isAChildOf(libraryDirectory) ? favouritesFile.getRelativePathFrom(libraryDirectory) : path);
+    }
+    
+    favouritesPathIds.sort(false);
+    stream.writeCompressedInt(favouritesPathIds.size());
+    String previousPathId;
+    
+    for (String const & pathId : favouritesPathIds)
+    {
+        int numSharedCharacters = 0;
+        
+        while (numSharedCharacters < previousPathId.length()
+               && numSharedCharacters < pathId.length()
+               && pathId[numSharedCharacters] == previousPathId[numSharedCharacters])
+        {
+            numSharedCharacters++;
+        }
+        
+        stream.writeCompressedInt(numSharedCharacters);
+        stream.writeString(pathId.substring(numSharedCharacters));
+        previousPathId = pathId;
     }
     
-    stateInfo.prependChildElement(stateInfoBody);
-    stateInfo.prependChildElement(stateInfoFilter);
-    stateInfo.prependChildElement(stateInfoSampleFavourites);
-    copyXmlToBinary(stateInfo, destData);
+    // Settings added in later versions follow the favourites
+    stream.writeCompressedInt(mPreviewCacheSize);
 }
 
 void SaemplAudioProcessor::setStateInformation(void const * data, int sizeInBytes)
 {
     // You should use this method to restore your parameters from this memory block,
     // whose contents will have been created by the getStateInformation() call.
-    juce::XmlElement xmlState = *getXmlFromBinary(data, sizeInBytes);
-    juce::XmlElement* xmlStatePtr = &xmlState;
+    MemoryInputStream stream(data, (size_t) sizeInBytes, false);
+    
+    if (sizeInBytes >= 4 && stream.readInt() == stateInfoMagicNumber)
+    {
+        restoreStateFromStream(stream);
+    }
+    else if (std::unique_ptr<XmlElement> xmlState = getXmlFromBinary(data, sizeInBytes))
+    {
+        restoreStateFromXml(*xmlState);
+    }
+    else
+    {
+        jassertfalse;
+        return;
+    }
     
-    if (xmlStatePtr)
+    if (mLastOpenedLibraryPath == "")
     {
-        // Restore general state properties
-        XmlElement* stateInfoBody = xmlStatePtr->getChildByName("Blome_StateInfoBody");
+        mLastOpenedLibraryPath = mDefaultLibraryDirectoryPath;
+    }
+    
+    // Loading the library is left to the message thread
+    triggerAsyncUpdate();
+}
+
+void SaemplAudioProcessor::restoreStateFromStream(MemoryInputStream& inStream)
+{
+    // States of later versions may be laid out differently
+    int stateVersion = inStream.readCompressedInt();
+    
+    if (stateVersion > stateInfoVersion)
+    {
+        jassertfalse;
+        return;
+    }
+    
+    // Restore general state properties
+    mActiveNavigationPanelType = (NavigationPanelType) inStream.readCompressedInt();
+    mSortingColumnTitle = inStream.readString();
+    mSortingDirection = inStream.readBool();
+    mSampleItemPanelIsVisible = inStream.readBool();
+    mFollowAudioPlayhead = inStream.readBool();
+    mSampleGridZoomFactor = inStream.readFloat();
+    mLastOpenedLibraryPath = inStream.readString();
+    mOutputDevice = inStream.readString();
+    mVolumeIsNormalised = inStream.readBool();
+    setPreviewStartIsQuantised(inStream.readBool());
+    bool previewTempoIsMatched = inStream.readBool();
+    setPreviewTempoMatching(previewTempoIsMatched, inStream.readFloat());
+    setPreviewKey(inStream.readCompressedInt());
+    mOutputGain = inStream.readFloat();
+    mClusterGridInBackground = inStream.readBool();
+    mGridWarmStartIsEnabled = inStream.readBool();
+    mGridSortingQuality = inStream.readFloat();
+    
+    int numFeatureWeights = inStream.readCompressedInt();
+    
+    for (int fw = 0; fw < numFeatureWeights; fw++)
+    {
+        float featureWeight = inStream.readFloat();
         
-        if (stateInfoBody)
+        if (fw < mFeatureWeights.size())
         {
-            mActiveNavigationPanelType = STRING_TO_NAVIGATION_PANEL_TYPE[stateInfoBody->getStringAttribute("ActiveNavigationPanel")];
-            mSortingColumnTitle = stateInfoBody->getStringAttribute("SortingColumnTitle");
-            mSortingDirection = stateInfoBody->getBoolAttribute("SortingDirection");
-            mSampleItemPanelIsVisible = stateInfoBody->getBoolAttribute("SampleItemPanelIsVisible");
-            mFollowAudioPlayhead = stateInfoBody->getBoolAttribute("FollowAudioPlayhead");
-            mSampleGridZoomFactor = stateInfoBody->getDoubleAttribute("SampleGridZoomFactor");
-            mLastOpenedLibraryPath = stateInfoBody->getStringAttribute("LastOpenedLibraryPath");
-            mOutputDevice = stateInfoBody->getStringAttribute("OutputDevice");
-            mVolumeIsNormalised = stateInfoBody->getBoolAttribute("VolumeIsNormalised");
-            mOutputGain = stateInfoBody->getDoubleAttribute("OutputGain");
-            
-            for (int fw = 0; fw < mFeatureWeights.size(); fw++)
-            {
-                String weightName = "FW" + std::to_string(fw);
-                mFeatureWeights[fw] = stateInfoBody->getDoubleAttribute(weightName);
-            }
-            
-            mFeatureWeightsChanged = true;
+            mFeatureWeights[fw] = featureWeight;
         }
+    }
+    
+    mFeatureWeightsChanged = true;
+    
+    // Restore filter state properties
+    mFilterIsActivated = inStream.readBool();
+    std::vector<RestoredFilterRule> filterRules;
+    int numFilterRules = inStream.readCompressedInt();
+    
+    for (int r = 0; r < numFilterRules && !inStream.isExhausted(); r++)
+    {
+        RestoredFilterRule rule;
+        rule.propertyName = inStream.readString();
+        rule.isActive = inStream.readBool();
+        rule.compareOperator = (CompareOperators) inStream.readCompressedInt();
+        rule.compareValue = var::readFromStream(inStream);
+        filterRules.push_back(rule);
+    }
+    
+    // Restoring favourite samples, each path continues the shared start of the previous one
+    File libraryDirectory = File(mLastOpenedLibraryPath);
+    StringArray favouritesPaths;
+    int numFavourites = inStream.readCompressedInt();
+    String previousPathId;
+    
+    for (int f = 0; f < numFavourites && !inStream.isExhausted(); f++)
+    {
+        int numSharedCharacters = inStream.readCompressedInt();
+        String pathId = previousPathId.substring(0, numSharedCharacters) + inStream.readString();
+        // Paths outside the library were stored in full, which getChildFile resolves to themselves
+        favouritesPaths.add(libraryDirectory.getChildFile(pathId).getFullPathName());
+        previousPathId = pathId;
+    }
+    
+    if (stateVersion >= 2)
+    {
+        mPreviewCacheSize = inStream.readCompressedInt();
+    }
+    
+    ScopedLock lock(mRestoreLock);
+    mRestoredFilterRules = filterRules;
+    mRestoredFavouritesPaths = favouritesPaths;
+    mLibraryRestoreIsPending = true;
+}
+
+void SaemplAudioProcessor::restoreStateFromXml(XmlElement const & inStateInfo)
+{
+    // Restore general state properties
+    XmlElement* stateInfoBody = inStateInfo.getChildByName("Blome_StateInfoBody");
+    
+    if (stateInfoBody)
+    {
+        mActiveNavigationPanelType = STRING_TO_NAVIGATION_PANEL_TYPE[stateInfoBody->getStringAttribute("ActiveNavigationPanel")];
+        mSortingColumnTitle = stateInfoBody->getStringAttribute("SortingColumnTitle");
+        mSortingDirection = stateInfoBody->getBoolAttribute("SortingDirection");
+        mSampleItemPanelIsVisible = stateInfoBody->getBoolAttribute("SampleItemPanelIsVisible");
+        mFollowAudioPlayhead = stateInfoBody->getBoolAttribute("FollowAudioPlayhead");
+        mSampleGridZoomFactor = stateInfoBody->getDoubleAttribute("SampleGridZoomFactor");
+        mLastOpenedLibraryPath = stateInfoBody->getStringAttribute("LastOpenedLibraryPath");
+        mOutputDevice = stateInfoBody->getStringAttribute("OutputDevice");
+        mVolumeIsNormalised = stateInfoBody->getBoolAttribute("VolumeIsNormalised");
+        setPreviewStartIsQuantised(stateInfoBody->getBoolAttribute("PreviewStartIsQuantised"));
+        setPreviewTempoMatching(stateInfoBody->getBoolAttribute("PreviewTempoIsMatched"),
+                                stateInfoBody->getDoubleAttribute("PreviewTempo", 120.0));
+        setPreviewKey(stateInfoBody->getIntAttribute("PreviewKey", NO_KEY_INDEX));
+        mOutputGain = stateInfoBody->getDoubleAttribute("OutputGain");
+        mClusterGridInBackground = stateInfoBody->getBoolAttribute("ClusterGridInBackground", true);
+        mGridWarmStartIsEnabled = stateInfoBody->getBoolAttribute("GridWarmStartIsEnabled", true);
+        mGridSortingQuality = stateInfoBody->getDoubleAttribute("GridSortingQuality", 1.0);
         
-        if (mLastOpenedLibraryPath == "")
+        for (int fw = 0; fw < mFeatureWeights.size(); fw++)
         {
-            mLastOpenedLibraryPath = mDefaultLibraryDirectoryPath;
+            String weightName = "FW" + std::to_string(fw);
+            mFeatureWeights[fw] = stateInfoBody->getDoubleAttribute(weightName);
         }
         
-        mSampleLibrary->setDirectory(mLastOpenedLibraryPath);
-        
-        // Restore filter state properties
-        XmlElement* stateInfoFilter = xmlStatePtr->getChildByName("Blome_StateInfoFilter");
+        mFeatureWeightsChanged = true;
+    }
+    
+    // Restore filter state properties
+    XmlElement* stateInfoFilter = inStateInfo.getChildByName("Blome_StateInfoFilter");
+    std::vector<RestoredFilterRule> filterRules;
+    
+    if (stateInfoFilter)
+    {
+        mFilterIsActivated = stateInfoFilter->getBoolAttribute("FilterIsActivated");
         
-        if (stateInfoFilter)
+        for (auto* filterRule: stateInfoFilter->getChildIterator())
         {
-            mFilterIsActivated = stateInfoFilter->getBoolAttribute("FilterIsActivated");
-            
-            for (auto* filterRule: stateInfoFilter->getChildIterator())
-            {
-                SampleFileFilterRuleBase* newRule;
-                String propertyName = filterRule->getStringAttribute("PropertyName");
-                
-                switch (PROPERTY_NAMES.indexOf(propertyName))
-                {
-                    case 0:
-                    {
-                        newRule = mSampleLibrary->getFileFilter().addFilterRule(new SampleFileFilterRuleTitle(propertyName));
-                        dynamic_cast<SampleFileFilterRuleTitle*>(newRule)->setCompareValue(filterRule->getStringAttribute("CompareValue"));
-                        break;
-                    }
-                    case 1:
-                    {
-                        newRule = mSampleLibrary->getFileFilter().addFilterRule(new SampleFileFilterRuleLength(propertyName));
-                        dynamic_cast<SampleFileFilterRuleLength*>(newRule)->setCompareValue(filterRule->getDoubleAttribute("CompareValue"));
-                        break;
-                    }
-                    case 2:
-                    {
-                        newRule = mSampleLibrary->getFileFilter().addFilterRule(new SampleFileFilterRuleLoudnessDecibel(propertyName));
-                        dynamic_cast<SampleFileFilterRuleLoudnessDecibel*>(newRule)->setCompareValue(filterRule->getDoubleAttribute("CompareValue"));
-                        break;
-                    }
-                    case 3:
-                    {
-                        newRule = mSampleLibrary->getFileFilter().addFilterRule(new SampleFileFilterRuleLoudnessLUFS(propertyName));
-                        dynamic_cast<SampleFileFilterRuleLoudnessLUFS*>(newRule)->setCompareValue(filterRule->getDoubleAttribute("CompareValue"));
-                        break;
-                    }
-                    case 4:
-                    {
-                        newRule = mSampleLibrary->getFileFilter().addFilterRule(new SampleFileFilterRuleTempo(propertyName));
-                        dynamic_cast<SampleFileFilterRuleTempo*>(newRule)->setCompareValue(filterRule->getIntAttribute("CompareValue"));
-                        break;
-                    }
-                    case 5:
-                    {
-                        newRule = mSampleLibrary->getFileFilter().addFilterRule(new SampleFileFilterRuleKey(propertyName));
-                        dynamic_cast<SampleFileFilterRuleKey*>(newRule)->setCompareValue(filterRule->getStringAttribute("CompareValue"));
-                        break;
-                    }
-                    case 6:
-                    {
-                        newRule = mSampleLibrary->getFileFilter().addFilterRule(new SampleFileFilterRuleDynamicRange(propertyName));
-                        dynamic_cast<SampleFileFilterRuleDynamicRange*>(newRule)->setCompareValue(filterRule->getDoubleAttribute("CompareValue"));
-                        break;
-                    }
-                    case 7:
-                    {
-                        newRule = mSampleLibrary->getFileFilter().addFilterRule(new SampleFileFilterRuleCentroid(propertyName));
-                        dynamic_cast<SampleFileFilterRuleCentroid*>(newRule)->setCompareValue(filterRule->getDoubleAttribute("CompareValue"));
-                        break;
-                    }
-                    case 8:
-                    {
-                        newRule = mSampleLibrary->getFileFilter().addFilterRule(new SampleFileFilterRuleRolloff(propertyName));
-                        dynamic_cast<SampleFileFilterRuleRolloff*>(newRule)->setCompareValue(filterRule->getDoubleAttribute("CompareValue"));
-                        break;
-                    }
-                    case 9:
-                    {
-                        newRule = mSampleLibrary->getFileFilter().addFilterRule(new SampleFileFilterRuleSpectralSpread(propertyName));
-                        dynamic_cast<SampleFileFilterRuleSpectralSpread*>(newRule)->setCompareValue(filterRule->getDoubleAttribute("CompareValue"));
-                        break;
-                    }
-                    case 10:
-                    {
-                        newRule = mSampleLibrary->getFileFilter().addFilterRule(new SampleFileFilterRuleSpectralFlux(propertyName));
-                        dynamic_cast<SampleFileFilterRuleSpectralFlux*>(newRule)->setCompareValue(filterRule->getDoubleAttribute("CompareValue"));
-                        break;
-                    }
-                    case 11:
-                    {
-                        newRule = mSampleLibrary->getFileFilter().addFilterRule(new SampleFileFilterRuleChromaFlux(propertyName));
-                        dynamic_cast<SampleFileFilterRuleChromaFlux*>(newRule)->setCompareValue(filterRule->getDoubleAttribute("CompareValue"));
-                        break;
-                    }
-                    case 12:
-                    {
-                        newRule = mSampleLibrary->getFileFilter().addFilterRule(new SampleFileFilterRuleZeroCrossingRate(propertyName));
-                        dynamic_cast<SampleFileFilterRuleZeroCrossingRate*>(newRule)->setCompareValue(filterRule->getDoubleAttribute("CompareValue"));
-                        break;
-                    }
-                    default:
-                    {
-                        jassertfalse;
-                        break;
-                    }
-                }
-                
-                newRule->setIsActive(filterRule->getBoolAttribute("RuleIsActive"));
-                newRule->setCompareOperator(STRING_TO_COMPARE_OPERATORS[filterRule->getStringAttribute("CompareOperator")]);
-            }
+            filterRules.push_back({ filterRule->getStringAttribute("PropertyName"),
+                filterRule->getBoolAttribute("RuleIsActive"),
+                STRING_TO_COMPARE_OPERATORS[filterRule->getStringAttribute("CompareOperator")],
+                filterRule->getStringAttribute("CompareValue") });
         }
-        
-        if (mSampleLibrary->getFileFilter().canHaveEffect())
+    }
+    
+    // Restoring favourite samples
+    XmlElement* stateInfoSampleFavourites = inStateInfo.getChildByName("Blome_StateInfoSampleFavourites");
+    StringArray favouritesPaths;
+    
+    if (stateInfoSampleFavourites)
+    {
+        for (auto* sample : stateInfoSampleFavourites->getChildIterator())
         {
-            mSampleLibrary->refreshLibrary();
+            favouritesPaths.add(sample->getStringAttribute("FilePath"));
         }
+    }
+    
+    ScopedLock lock(mRestoreLock);
+    mRestoredFilterRules = filterRules;
+    mRestoredFavouritesPaths = favouritesPaths;
+    mLibraryRestoreIsPending = true;
+}
+
+void SaemplAudioProcessor::handleAsyncUpdate()
+{
+    std::vector<RestoredFilterRule> filterRules;
+    StringArray favouritesPaths;
+    
+    {
+        ScopedLock lock(mRestoreLock);
         
-        // Restoring favourite samples
-        XmlElement* stateInfoSampleFavourites = xmlStatePtr->getChildByName("Blome_StateInfoSampleFavourites");
+        if (!mLibraryRestoreIsPending)
+        {
+            return;
+        }
         
-        if (stateInfoSampleFavourites)
+        filterRules = mRestoredFilterRules;
+        favouritesPaths = mRestoredFavouritesPaths;
+        mRestoredFilterRules.clear();
+        mRestoredFavouritesPaths.clear();
+        mLibraryRestoreIsPending = false;
+    }
+    
+    mSampleLibrary->setDirectory(mLastOpenedLibraryPath);
+    
+    for (RestoredFilterRule const & rule : filterRules)
+    {
+        addRestoredFilterRule(rule);
+    }
+    
+    if (mSampleLibrary->getFileFilter().canHaveEffect())
+    {
+        mSampleLibrary->refreshLibrary();
+    }
+    
+    // The favourites are added once the library manager has finished loading the library
+    mSampleLibrary->setRestoredFavouritesPaths(favouritesPaths);
+}
+
+void SaemplAudioProcessor::addRestoredFilterRule(RestoredFilterRule const & inRule)
+{
+    SampleFileFilter& fileFilter = mSampleLibrary->getFileFilter();
+    SampleFileFilterRuleBase* newRule;
+    
+    // Values restored from XML are strings, which the var converts to the rule's type
+    switch (PROPERTY_NAMES.indexOf(inRule.propertyName))
+    {
+        case 0:
         {
-            StringArray restoredFavouritesPaths;
-            
-            for (auto* sample : stateInfoSampleFavourites->getChildIterator())
-            {
-                restoredFavouritesPaths.add(sample->getStringAttribute("FilePath"));
-            }
-            
-            mSampleLibrary->setRestoredFavouritesPaths(restoredFavouritesPaths);
+            newRule = fileFilter.addFilterRule(new SampleFileFilterRuleTitle(inRule.propertyName));
+            dynamic_cast<SampleFileFilterRuleTitle*>(newRule)->setCompareValue(inRule.compareValue.toString());
+            break;
+        }
+        case 1:
+        {
+            newRule = fileFilter.addFilterRule(new SampleFileFilterRuleLength(inRule.propertyName));
+            dynamic_cast<SampleFileFilterRuleLength*>(newRule)->setCompareValue((double) inRule.compareValue);
+            break;
+        }
+        case 2:
+        {
+            newRule = fileFilter.addFilterRule(new SampleFileFilterRuleLoudnessDecibel(inRule.propertyName));
+            dynamic_cast<SampleFileFilterRuleLoudnessDecibel*>(newRule)->setCompareValue((double) inRule.compareValue);
+            break;
+        }
+        case 3:
+        {
+            newRule = fileFilter.addFilterRule(new SampleFileFilterRuleLoudnessLUFS(inRule.propertyName));
+            dynamic_cast<SampleFileFilterRuleLoudnessLUFS*>(newRule)->setCompareValue((double) inRule.compareValue);
+            break;
+        }
+        case 4:
+        {
+            newRule = fileFilter.addFilterRule(new SampleFileFilterRuleTempo(inRule.propertyName));
+            dynamic_cast<SampleFileFilterRuleTempo*>(newRule)->setCompareValue((int) inRule.compareValue);
+            break;
+        }
+        case 5:
+        {
+            newRule = fileFilter.addFilterRule(new SampleFileFilterRuleKey(inRule.propertyName));
+            dynamic_cast<SampleFileFilterRuleKey*>(newRule)->setCompareValue(inRule.compareValue.toString());
+            break;
+        }
+        case 6:
+        {
+            newRule = fileFilter.addFilterRule(new SampleFileFilterRuleDynamicRange(inRule.propertyName));
+            dynamic_cast<SampleFileFilterRuleDynamicRange*>(newRule)->setCompareValue((double) inRule.compareValue);
+            break;
+        }
+        case 7:
+        {
+            newRule = fileFilter.addFilterRule(new SampleFileFilterRuleCentroid(inRule.propertyName));
+            dynamic_cast<SampleFileFilterRuleCentroid*>(newRule)->setCompareValue((double) inRule.compareValue);
+            break;
+        }
+        case 8:
+        {
+            newRule = fileFilter.addFilterRule(new SampleFileFilterRuleRolloff(inRule.propertyName));
+            dynamic_cast<SampleFileFilterRuleRolloff*>(newRule)->setCompareValue((double) inRule.compareValue);
+            break;
+        }
+        case 9:
+        {
+            newRule = fileFilter.addFilterRule(new SampleFileFilterRuleSpectralSpread(inRule.propertyName));
+            dynamic_cast<SampleFileFilterRuleSpectralSpread*>(newRule)->setCompareValue((double) inRule.compareValue);
+            break;
+        }
+        case 10:
+        {
+            newRule = fileFilter.addFilterRule(new SampleFileFilterRuleSpectralFlux(inRule.propertyName));
+            dynamic_cast<SampleFileFilterRuleSpectralFlux*>(newRule)->setCompareValue((double) inRule.compareValue);
+            break;
+        }
+        case 11:
+        {
+            newRule = fileFilter.addFilterRule(new SampleFileFilterRuleChromaFlux(inRule.propertyName));
+            dynamic_cast<SampleFileFilterRuleChromaFlux*>(newRule)->setCompareValue((double) inRule.compareValue);
+            break;
+        }
+        case 12:
+        {
+            newRule = fileFilter.addFilterRule(new SampleFileFilterRuleZeroCrossingRate(inRule.propertyName));
+            dynamic_cast<SampleFileFilterRuleZeroCrossingRate*>(newRule)->setCompareValue((double) inRule.compareValue);
+            break;
+        }
+        default:
+        {
+            jassertfalse;
+            return;
         }
     }
-    else
+    
+    newRule->setIsActive(inRule.isActive);
+    newRule->setCompareOperator(inRule.compareOperator);
+}
+
+var SaemplAudioProcessor::getFilterRuleCompareValue(SampleFileFilterRuleBase* inRule)
+{
+    switch (PROPERTY_NAMES.indexOf(inRule->getRulePropertyName()))
     {
-        jassertfalse;
+        case 0:
+            return dynamic_cast<SampleFileFilterRuleTitle*>(inRule)->getCompareValue();
+        case 1:
+            return dynamic_cast<SampleFileFilterRuleLength*>(inRule)->getCompareValue();
+        case 2:
+            return dynamic_cast<SampleFileFilterRuleLoudnessDecibel*>(inRule)->getCompareValue();
+        case 3:
+            return dynamic_cast<SampleFileFilterRuleLoudnessLUFS*>(inRule)->getCompareValue();
+        case 4:
+            return dynamic_cast<SampleFileFilterRuleTempo*>(inRule)->getCompareValue();
+        case 5:
+            return dynamic_cast<SampleFileFilterRuleKey*>(inRule)->getCompareValue();
+        case 6:
+            return dynamic_cast<SampleFileFilterRuleDynamicRange*>(inRule)->getCompareValue();
+        case 7:
+            return dynamic_cast<SampleFileFilterRuleCentroid*>(inRule)->getCompareValue();
+        case 8:
+            return dynamic_cast<SampleFileFilterRuleRolloff*>(inRule)->getCompareValue();
+        case 9:
+            return dynamic_cast<SampleFileFilterRuleSpectralSpread*>(inRule)->getCompareValue();
+        case 10:
+            return dynamic_cast<SampleFileFilterRuleSpectralFlux*>(inRule)->getCompareValue();
+        case 11:
+            return dynamic_cast<SampleFileFilterRuleChromaFlux*>(inRule)->getCompareValue();
+        case 12:
+            return dynamic_cast<SampleFileFilterRuleZeroCrossingRate*>(inRule)->getCompareValue();
+        default:
+            jassertfalse;
+            return var();
     }
 }
 
@@ -530,6 +699,72 @@ void SaemplAudioProcessor::setLastOpenedLibraryPath(String inLastOpenedLibraryPa
     mLastOpenedLibraryPath = inLastOpenedLibraryPath;
 }
 
+SamplePreviewVoice& SaemplAudioProcessor::getPreviewVoice(PreviewVoiceType inVoiceType)
+{
+    return *mPreviewVoices[inVoiceType];
+}
+
+bool SaemplAudioProcessor::getPreviewStartIsQuantised()
+{
+    return mPreviewStartIsQuantised;
+}
+
+void SaemplAudioProcessor::setPreviewStartIsQuantised(bool inPreviewStartIsQuantised)
+{
+    mPreviewStartIsQuantised = inPreviewStartIsQuantised;
+    
+    for (std::unique_ptr<SamplePreviewVoice>& previewVoice : mPreviewVoices)
+    {
+        previewVoice->setStartIsQuantised(mPreviewStartIsQuantised);
+    }
+}
+
+bool SaemplAudioProcessor::getPreviewTempoIsMatched()
+{
+    return mPreviewTempoIsMatched;
+}
+
+float SaemplAudioProcessor::getPreviewTempo()
+{
+    return mPreviewTempo;
+}
+
+void SaemplAudioProcessor::setPreviewTempoMatching(bool inPreviewTempoIsMatched, float inPreviewTempo)
+{
+    mPreviewTempoIsMatched = inPreviewTempoIsMatched;
+    mPreviewTempo = inPreviewTempo;
+    
+    for (std::unique_ptr<SamplePreviewVoice>& previewVoice : mPreviewVoices)
+    {
+        previewVoice->setTempoMatching(mPreviewTempoIsMatched, mPreviewTempo);
+    }
+}
+
+int SaemplAudioProcessor::getPreviewKey()
+{
+    return mPreviewKey;
+}
+
+void SaemplAudioProcessor::setPreviewKey(int inPreviewKey)
+{
+    mPreviewKey = inPreviewKey;
+    
+    for (std::unique_ptr<SamplePreviewVoice>& previewVoice : mPreviewVoices)
+    {
+        previewVoice->setTargetKey(mPreviewKey);
+    }
+}
+
+int SaemplAudioProcessor::getPreviewCacheSize()
+{
+    return mPreviewCacheSize;
+}
+
+void SaemplAudioProcessor::setPreviewCacheSize(int inPreviewCacheSize)
+{
+    mPreviewCacheSize = inPreviewCacheSize;
+}
+
 String SaemplAudioProcessor::getOutputDevice()
 {
     return mOutputDevice;
@@ -631,3 +866,43 @@ void SaemplAudioProcessor::setVolumeIsNormalised(bool inVolumeIsNormalised)
 {
     mVolumeIsNormalised = inVolumeIsNormalised;
 }
+
+bool SaemplAudioProcessor::getClusterGridInBackground()
+{
+    return mClusterGridInBackground;
+}
+
+void SaemplAudioProcessor::setClusterGridInBackground(bool inClusterGridInBackground)
+{
+    mClusterGridInBackground = inClusterGridInBackground;
+}
+
+bool SaemplAudioProcessor::getGridWarmStartIsEnabled()
+{
+    return mGridWarmStartIsEnabled;
+}
+
+void SaemplAudioProcessor::setGridWarmStartIsEnabled(bool inGridWarmStartIsEnabled)
+{
+    mGridWarmStartIsEnabled = inGridWarmStartIsEnabled;
+}
+
+float SaemplAudioProcessor::getGridSortingQuality()
+{
+    return mGridSortingQuality;
+}
+
+void SaemplAudioProcessor::setGridSortingQuality(float inGridSortingQuality)
+{
+    mGridSortingQuality = inGridSortingQuality;
+}
+
+float SaemplAudioProcessor::getGridLayoutQuality()
+{
+    return mGridLayoutQuality;
+}
+
+void SaemplAudioProcessor::setGridLayoutQuality(float inGridLayoutQuality)
+{
+    mGridLayoutQuality = inGridLayoutQuality;
+}
@@ -10,13 +10,15 @@
 
 #include <JuceHeader.h>
 #include "SampleLibrary.h"
+#include "SamplePreviewVoice.h"
 
 //==============================================================================
 /**
  */
 class SaemplAudioProcessor
 :
-public juce::AudioProcessor
+public juce::AudioProcessor,
+private AsyncUpdater
 #if JucePlugin_Enable_ARA
 , public juce::AudioProcessorARAExtension
 #endif
@@ -94,6 +96,57 @@ public:
      Sets the name of the current output device.
      */
     void setOutputDevice(String inOutputdevice);
+    /**
+     @returns the preview voice that plays an audio player's samples through the host's output.
+     
+     @param inVoiceType which audio player the voice belongs to.
+     */
+    SamplePreviewVoice& getPreviewVoice(PreviewVoiceType inVoiceType);
+    /**
+     @returns whether previews played through the host start on the next beat of its transport.
+     */
+    bool getPreviewStartIsQuantised();
+    /**
+     Sets whether previews played through the host start on the next beat of its transport.
+     
+     @param inPreviewStartIsQuantised whether the preview start is quantised.
+     */
+    void setPreviewStartIsQuantised(bool inPreviewStartIsQuantised);
+    /**
+     @returns whether previews played through the host are stretched to its tempo.
+     */
+    bool getPreviewTempoIsMatched();
+    /**
+     @returns the tempo previews are stretched to if the host doesn't provide one.
+     */
+    float getPreviewTempo();
+    /**
+     Sets whether previews played through the host are stretched to its tempo using the analysed sample tempo.
+     
+     @param inPreviewTempoIsMatched whether the preview tempo is matched.
+     @param inPreviewTempo the tempo in bpm to match if the host doesn't provide one.
+     */
+    void setPreviewTempoMatching(bool inPreviewTempoIsMatched, float inPreviewTempo);
+    /**
+     @returns the key index previews played through the host are transposed to.
+     */
+    int getPreviewKey();
+    /**
+     @returns the memory in megabytes each audio player may use for the attacks of recently previewed samples.
+     */
+    int getPreviewCacheSize();
+    /**
+     Sets the memory each audio player may use for the attacks of recently previewed samples.
+     
+     @param inPreviewCacheSize the size in megabytes.
+     */
+    void setPreviewCacheSize(int inPreviewCacheSize);
+    /**
+     Sets the key previews played through the host are transposed to using the analysed sample key.
+     
+     @param inPreviewKey the key index, NO_KEY_INDEX keeps the samples' pitch.
+     */
+    void setPreviewKey(int inPreviewKey);
     /**
      @returns the current sorting direction of the sample item table.
      */
@@ -184,12 +237,64 @@ public:
      @param inVolumeIsNormalised whether the audio playback volume is normalised.
      */
     void setVolumeIsNormalised(bool inVolumeIsNormalised);
+    /**
+     @returns whether the sample grid is clustered in the background instead of behind a progress window.
+     */
+    bool getClusterGridInBackground();
+    /**
+     Sets whether the sample grid is clustered in the background instead of behind a progress window.
+     
+     @param inClusterGridInBackground whether the grid is clustered in the background.
+     */
+    void setClusterGridInBackground(bool inClusterGridInBackground);
+    /**
+     @returns whether re-clustering the sample grid starts from the last layout.
+     */
+    bool getGridWarmStartIsEnabled();
+    /**
+     Sets whether re-clustering the sample grid starts from the last layout.
+     
+     @param inGridWarmStartIsEnabled whether the last layout is used as a seed.
+     */
+    void setGridWarmStartIsEnabled(bool inGridWarmStartIsEnabled);
+    /**
+     @returns the trade-off between sample grid clustering quality and time.
+     */
+    float getGridSortingQuality();
+    /**
+     Sets the trade-off between sample grid clustering quality and time.
+     
+     @param inGridSortingQuality the quality between 0.2 and 1.0.
+     */
+    void setGridSortingQuality(float inGridSortingQuality);
+    /**
+     @returns the Distance Preservation Quality of the last clustered sample grid.
+     */
+    float getGridLayoutQuality();
+    /**
+     Sets the Distance Preservation Quality of the last clustered sample grid.
+     
+     @param inGridLayoutQuality the layout quality between 0.0 and 1.0.
+     */
+    void setGridLayoutQuality(float inGridLayoutQuality);
     
 private:
     //==============================================================================
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(SaemplAudioProcessor)
     
+    /**
+     A filter rule from a restored state, added to the library's filter once the library is opened.
+     */
+    struct RestoredFilterRule
+    {
+        String propertyName;
+        bool isActive;
+        CompareOperators compareOperator;
+        var compareValue;
+    };
+    
     std::unique_ptr<SampleLibrary> mSampleLibrary;
+    std::array<std::unique_ptr<SamplePreviewVoice>, NUM_PREVIEW_VOICES> mPreviewVoices;
     NavigationPanelType mActiveNavigationPanelType;
     String mDefaultLibraryDirectoryPath =
     (File::getSpecialLocation(File::userMusicDirectory)).getFullPathName()
@@ -208,7 +313,50 @@ private:
     bool mFilterIsActivated;
     bool mFeatureWeightsChanged;
     bool mVolumeIsNormalised;
+    bool mPreviewStartIsQuantised;
+    bool mPreviewTempoIsMatched;
+    bool mClusterGridInBackground;
+    bool mGridWarmStartIsEnabled;
+    float mGridSortingQuality;
+    float mGridLayoutQuality;
     float mSampleGridZoomFactor;
     float mOutputGain;
+    float mPreviewTempo;
+    int mPreviewKey;
+    int mPreviewCacheSize;
     std::vector<float> mFeatureWeights;
+    // Guards the library state that was restored but not applied yet, the host may restore from any thread
+    CriticalSection mRestoreLock;
+    bool mLibraryRestoreIsPending;
+    std::vector<RestoredFilterRule> mRestoredFilterRules;
+    StringArray mRestoredFavouritesPaths;
+    // Marks binary states, older states were stored as XML
+    static int const stateInfoMagicNumber = 0x424c5354;
+    static int const stateInfoVersion = 2;
+    
+    /**
+     Restores the state from the binary format written by getStateInformation.
+     
+     @param inStream the stream positioned after the magic number.
+     */
+    void restoreStateFromStream(MemoryInputStream& inStream);
+    /**
+     Restores the state from the XML format of earlier versions.
+     
+     @param inStateInfo the state's root element.
+     */
+    void restoreStateFromXml(XmlElement const & inStateInfo);
+    /**
+     Opens the restored library and applies its filter rules and favourites on the message thread,
+     so restoring a state doesn't block the plugin's instantiation.
+     */
+    void handleAsyncUpdate() override;
+    /**
+     Adds a restored rule to the library's filter.
+     */
+    void addRestoredFilterRule(RestoredFilterRule const & inRule);
+    /**
+     @returns the compare value of a filter rule.
+     */
+    static var getFilterRuleCompareValue(SampleFileFilterRuleBase* inRule);
 };
@@ -44,8 +44,12 @@ void SampleAnalyser::analyseSample(SampleItem* inSampleItem, bool forceAnalysis)
     analyseSampleLoudness();
     inSampleItem->setLoudnessDecibel(decibel);
     inSampleItem->setLoudnessLUFS(integratedLUFS);
+    inSampleItem->setPeakLevel(peakLevel);
     inSampleItem->setDynamicRange(lufsRangeEnd - lufsRangeStart);
     
+    // Cache the waveform overview that was collected in the loudness pass
+    mWaveform.saveToCache(File(inSampleItem->getCurrentFilePath()));
+    
     // Set zero crossing rate
     inSampleItem->setZeroCrossingRate(zeroCrossingRate);
     
@@ -74,6 +78,8 @@ void SampleAnalyser::analyseSample(SampleItem* inSampleItem, bool forceAnalysis)
     {
         inSampleItem->setKey(SAMPLE_TOO_LONG_INDEX);
     }
+    
+    inSampleItem->increaseAnalysisRevision();
 }
 
 void SampleAnalyser::loadAudioFileSource(File const & inFile)
@@ -93,10 +99,12 @@ void SampleAnalyser::analyseSampleLoudness()
     mAnalysisBuffer = AudioBuffer<float>(numChannels, loudnessBufferSize);
     decibel = 0.0;
     integratedLUFS = 0.0;
+    peakLevel = 0.0;
     numZeroCrossings = 0;
     mEbuLoudnessMeter.prepareToPlay(sampleRate,
                                     numChannels,
                                     loudnessBufferSize);
+    mWaveform.reset(numChannels, sampleRate);
     
     for (int b = 0; b < numBlocks; b++)
     {
@@ -110,8 +118,16 @@ void SampleAnalyser::analyseSampleLoudness()
         
         // Calculate LUFS and Decibels for block
         mEbuLoudnessMeter.processBlock(mAnalysisBuffer, numZeroCrossings, decibel);
+        
+        // Keep the peak for normalising the preview volume
+        peakLevel = jmax<float>(peakLevel, mAnalysisBuffer.getMagnitude(0, loudnessBufferSize));
+        
+        // Collect the waveform overview, leaving out the padding after the last sample
+        mWaveform.addBlock(mAnalysisBuffer, jmin<int>(loudnessBufferSize, totalNumSamples - b * loudnessBufferSize));
     }
     
+    mWaveform.finish();
+    
     // Calculate Decibel
     decibel /= numBlocks;
     
@@ -13,6 +13,7 @@
 #include "Ebu128LoudnessMeter.h"
 #include "SampleItem.h"
 #include "BlomeHelpers.h"
+#include "SampleWaveform.h"
 
 /**
  Analyses properties of given sample files.
@@ -36,6 +37,7 @@ private:
     std::unique_ptr<AudioFormatManager> mFormatManager;
     AudioBuffer<float> mAnalysisBuffer;
     Ebu128LoudnessMeter mEbuLoudnessMeter;
+    SampleWaveform mWaveform;
     dsp::FFT mForwardFFT;
     dsp::WindowingFunction<float> mWindowFunction;
     std::vector<float> mWindowedFFTData;
@@ -75,6 +77,7 @@ private:
     float currentMaxCoefficient;
     float decibel;
     float integratedLUFS;
+    float peakLevel;
     float lufsRangeStart;
     float lufsRangeEnd;
     float zeroCrossingRate;
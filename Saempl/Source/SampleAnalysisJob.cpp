@@ -15,7 +15,8 @@ SampleAnalysisJob::SampleAnalysisJob(OwnedArray<SampleItem>& inSampleItems,
                                          File const & inFile,
                                          SampleItem* inSampleItem,
                                          bool forceAnalysis,
-                                         int& inNumProcessedItems)
+                                         int& inNumProcessedItems,
+                                         ChangeBroadcaster& inAnalysisBroadcaster)
 :
 ThreadPoolJob("SampleAnalysisJob"),
 allSampleItems(inSampleItems),
@@ -24,7 +25,8 @@ addedFilePaths(inAddedFilePaths),
 file(inFile),
 sampleItem(inSampleItem),
 mForceAnalysis(forceAnalysis),
-numProcessedItems(inNumProcessedItems)
+numProcessedItems(inNumProcessedItems),
+analysisBroadcaster(inAnalysisBroadcaster)
 {
     // Initialise sample analyser
     mSampleAnalyser = std::make_unique<SampleAnalyser>();
@@ -57,7 +59,9 @@ ThreadPoolJob::JobStatus SampleAnalysisJob::runJob()
     }
     else
     {
+        // Added and reanalysed items only get their values now, long after the library was refreshed
         mSampleAnalyser->analyseSample(sampleItem, mForceAnalysis);
+        analysisBroadcaster.sendChangeMessage();
         return jobHasFinished;
     }
 }
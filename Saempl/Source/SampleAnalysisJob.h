@@ -27,6 +27,7 @@ public:
      @param inSampleItem a pointer to the sample item to analyse.
      @param forceAnalysis see sample analyser analysis method.
      @param numProcessedItems a reference to the item counter.
+     @param inAnalysisBroadcaster notified when the values of an existing sample item were analysed.
      */
     SampleAnalysisJob(OwnedArray<SampleItem>& inSampleItems,
                      OwnedArray<SampleItem>& inAddedSampleItems,
@@ -34,7 +35,8 @@ public:
                      File const & inFile,
                      SampleItem* inSampleItem,
                      bool forceAnalysis,
-                     int& numProcessedItems);
+                     int& numProcessedItems,
+                     ChangeBroadcaster& inAnalysisBroadcaster);
     ~SampleAnalysisJob();
     
 private:
@@ -46,6 +48,7 @@ private:
     SampleItem* sampleItem;
     bool mForceAnalysis;
     int& numProcessedItems;
+    ChangeBroadcaster& analysisBroadcaster;
     
     /**
      Runs the analysis of a sample item and creates a new one if the pointer is null.
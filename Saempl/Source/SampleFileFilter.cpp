@@ -9,12 +9,12 @@
 
 #include "SampleFileFilter.h"
 
-SampleFileFilter::SampleFileFilter(String const & inDesciption, OwnedArray<SampleItem>& inFilteredSampleItems)
+SampleFileFilter::SampleFileFilter(String const & inDesciption)
 :
-FileFilter(inDesciption),
-filteredSampleItems(inFilteredSampleItems)
+FileFilter(inDesciption)
 {
     isActive = true;
+    mFilteredPaths = std::make_shared<FilteredPaths const>();
 }
 
 SampleFileFilter::~SampleFileFilter()
@@ -24,25 +24,57 @@ SampleFileFilter::~SampleFileFilter()
 
 bool SampleFileFilter::isFileSuitable(File const & file) const
 {
-    for (SampleItem * sampleItem: filteredSampleItems)
+    // Called on the directory scanner thread, the paths are only ever replaced, never changed
+    std::shared_ptr<FilteredPaths const> filteredPaths = std::atomic_load(&mFilteredPaths);
+    
+    return filteredPaths->filePaths.count(file.getFullPathName()) > 0;
+}
+
+void SampleFileFilter::setFilteredFilePaths(StringArray const & inFilteredFilePaths)
+{
+    std::shared_ptr<FilteredPaths> filteredPaths = std::make_shared<FilteredPaths>();
+    filteredPaths->filePaths.insert(inFilteredFilePaths.begin(), inFilteredFilePaths.end());
+    std::unordered_map<String, int> directSampleCounts;
+    
+    // Count the samples directly inside each directory
+    for (String const & filePath : inFilteredFilePaths)
     {
-        if (sampleItem == nullptr)
-        {
-            return false;
-        }
+        directSampleCounts[File(filePath).getParentDirectory().getFullPathName()]++;
+    }
+    
+    // Add each directory's count to all its parent directories
+    for (auto const & directSampleCount : directSampleCounts)
+    {
+        File directory = File(directSampleCount.first);
         
-        if (sampleItem->getCurrentFilePath() == file.getFullPathName())
+        while (true)
         {
-            return true;
+            filteredPaths->directorySampleCounts[directory.getFullPathName()] += directSampleCount.second;
+            File parentDirectory = directory.getParentDirectory();
+            
+            if (parentDirectory == directory)
+            {
+                break;
+            }
+            
+            directory = parentDirectory;
         }
     }
     
-    return false;
+    std::atomic_store(&mFilteredPaths, std::shared_ptr<FilteredPaths const>(filteredPaths));
+}
+
+int SampleFileFilter::getNumFilteredSamplesInDirectory(File const & inDirectory) const
+{
+    std::shared_ptr<FilteredPaths const> filteredPaths = std::atomic_load(&mFilteredPaths);
+    auto directorySampleCount = filteredPaths->directorySampleCounts.find(inDirectory.getFullPathName());
+    
+    return directorySampleCount == filteredPaths->directorySampleCounts.end() ? 0 : directorySampleCount->second;
 }
 
 bool SampleFileFilter::isDirectorySuitable(File const & file) const
 {
-    return !file.findChildFiles(File::findFiles, true, SUPPORTED_AUDIO_FORMATS_WILDCARD).isEmpty();
+    return getNumFilteredSamplesInDirectory(file) > 0;
 }
 
 bool SampleFileFilter::matchesRules(SampleItem& inSampleItem)
@@ -64,6 +96,416 @@ bool SampleFileFilter::matchesRules(SampleItem& inSampleItem)
     return true;
 }
 
+std::vector<int> SampleFileFilter::matchRules(OwnedArray<SampleItem>& inSampleItems,
+                                              std::vector<SortedPropertyIndex>& inPropertyIndexes,
+                                              TitleTrigramIndex& inTitleIndex)
+{
+    int numItems = inSampleItems.size();
+    std::vector<int> matchingIndices;
+    std::vector<CompiledFilterRule> compiledRules;
+    
+    if (isActive)
+    {
+        compiledRules = compileRules();
+    }
+    
+    // Resolve every numeric rule to a range of positions in its property's sorted index
+    std::vector<SortedPropertyIndex const *> ruleIndexes;
+    std::vector<Range<int>> ruleRanges;
+    int mostSelectiveRule = -1;
+    
+    for (CompiledFilterRule const & rule : compiledRules)
+    {
+        if (rule.propertyIndex <= 0)
+        {
+            continue;
+        }
+        
+        SortedPropertyIndex& propertyIndex = inPropertyIndexes[rule.propertyIndex];
+        
+        if (!propertyIndex.isUpToDate || (int) propertyIndex.ranks.size() != numItems)
+        {
+            buildPropertyIndex(rule.propertyIndex, inSampleItems, propertyIndex);
+        }
+        
+        ruleIndexes.push_back(&propertyIndex);
+        ruleRanges.push_back(findMatchingRange(rule, propertyIndex));
+        
+        if (mostSelectiveRule == -1 || ruleRanges.back().getLength() < ruleRanges[mostSelectiveRule].getLength())
+        {
+            mostSelectiveRule = (int) ruleRanges.size() - 1;
+        }
+    }
+    
+    if (mostSelectiveRule == -1)
+    {
+        matchingIndices.resize(numItems);
+        std::iota(matchingIndices.begin(), matchingIndices.end(), 0);
+    }
+    else
+    {
+        // Only the candidates of the most selective rule are checked against the ranks of the other rules
+        Range<int> candidateRange = ruleRanges[mostSelectiveRule];
+        SortedPropertyIndex const * candidateIndex = ruleIndexes[mostSelectiveRule];
+        matchingIndices.reserve(candidateRange.getLength());
+        
+        for (int position = candidateRange.getStart(); position < candidateRange.getEnd(); position++)
+        {
+            int itemIndex = candidateIndex->itemIndices[position];
+            bool matchesAllRules = true;
+            
+            for (size_t r = 0; r < ruleRanges.size() && matchesAllRules; r++)
+            {
+                matchesAllRules = ruleRanges[r].contains(ruleIndexes[r]->ranks[itemIndex]);
+            }
+            
+            if (matchesAllRules)
+            {
+                matchingIndices.push_back(itemIndex);
+            }
+        }
+        
+        // Keep the library order of the sample items
+        std::sort(matchingIndices.begin(), matchingIndices.end());
+    }
+    
+    // Title rules only need to check the remaining items
+    for (CompiledFilterRule const & rule : compiledRules)
+    {
+        if (rule.propertyIndex == 0)
+        {
+            // Narrow substring searches down with the trigram index first
+            if (rule.compareOperator == CONTAINS && rule.compareText.length() >= 3)
+            {
+                if (!inTitleIndex.isUpToDate || inTitleIndex.numIndexedItems != numItems)
+                {
+                    buildTitleIndex(inSampleItems, inTitleIndex);
+                }
+                
+                intersectWithTitleCandidates(rule, inTitleIndex, matchingIndices);
+            }
+            
+            matchingIndices.erase(std::remove_if(matchingIndices.begin(), matchingIndices.end(), [&](int itemIndex)
+            {
+                return !matchesTitleRule(rule, inSampleItems.getUnchecked(itemIndex)->getTitle());
+            }), matchingIndices.end());
+        }
+    }
+    
+    return matchingIndices;
+}
+
+std::vector<CompiledFilterRule> SampleFileFilter::compileRules()
+{
+    std::vector<CompiledFilterRule> compiledRules;
+    
+    for (SampleFileFilterRuleBase* rule : mFilterRules)
+    {
+        if (rule->canHaveEffect())
+        {
+            compiledRules.push_back(rule->compile());
+        }
+    }
+    
+    // Group rules by property so each column is only filled once
+    std::stable_sort(compiledRules.begin(), compiledRules.end(), [](auto const & a, auto const & b)
+    {
+        return a.propertyIndex < b.propertyIndex;
+    });
+    
+    return compiledRules;
+}
+
+void SampleFileFilter::fillPropertyColumn(int inPropertyIndex, OwnedArray<SampleItem>& inSampleItems, std::vector<double>& outColumn)
+{
+    int numItems = inSampleItems.size();
+    outColumn.resize(numItems);
+    
+    for (int i = 0; i < numItems; i++)
+    {
+        SampleItem* sampleItem = inSampleItems.getUnchecked(i);
+        
+        switch (inPropertyIndex)
+        {
+            case 1:
+                outColumn[i] = sampleItem->getLength();
+                break;
+            case 2:
+                // Loudness rules compare whole decibels
+                outColumn[i] = (int) sampleItem->getLoudnessDecibel();
+                break;
+            case 3:
+                outColumn[i] = (int) sampleItem->getLoudnessLUFS();
+                break;
+            case 4:
+                outColumn[i] = sampleItem->getTempo();
+                break;
+            case 5:
+                outColumn[i] = sampleItem->getKey();
+                break;
+            case 6:
+                outColumn[i] = sampleItem->getDynamicRange();
+                break;
+            case 7:
+                outColumn[i] = sampleItem->getSpectralCentroid();
+                break;
+            case 8:
+                outColumn[i] = sampleItem->getSpectralRolloff();
+                break;
+            case 9:
+                outColumn[i] = sampleItem->getSpectralSpread();
+                break;
+            case 10:
+                outColumn[i] = sampleItem->getSpectralFlux();
+                break;
+            case 11:
+                outColumn[i] = sampleItem->getChromaFlux();
+                break;
+            case 12:
+                outColumn[i] = sampleItem->getZeroCrossingRate();
+                break;
+            default:
+                jassertfalse;
+                outColumn[i] = 0.0;
+        }
+    }
+}
+
+void SampleFileFilter::buildPropertyIndex(int inPropertyIndex, OwnedArray<SampleItem>& inSampleItems, SortedPropertyIndex& outPropertyIndex)
+{
+    std::vector<double> propertyColumn;
+    fillPropertyColumn(inPropertyIndex, inSampleItems, propertyColumn);
+    int numItems = (int) propertyColumn.size();
+    
+    // Sort the item indices by their property value, items without a valid value never match a rule
+    outPropertyIndex.itemIndices.clear();
+    
+    for (int i = 0; i < numItems; i++)
+    {
+        if (!std::isnan(propertyColumn[i]))
+        {
+            outPropertyIndex.itemIndices.push_back(i);
+        }
+    }
+    
+    std::stable_sort(outPropertyIndex.itemIndices.begin(), outPropertyIndex.itemIndices.end(), [&propertyColumn](int a, int b)
+    {
+        return propertyColumn[a] < propertyColumn[b];
+    });
+    
+    int numIndexedItems = (int) outPropertyIndex.itemIndices.size();
+    outPropertyIndex.values.resize(numIndexedItems);
+    outPropertyIndex.ranks.assign(numItems, -1);
+    
+    for (int position = 0; position < numIndexedItems; position++)
+    {
+        int itemIndex = outPropertyIndex.itemIndices[position];
+        outPropertyIndex.values[position] = propertyColumn[itemIndex];
+        outPropertyIndex.ranks[itemIndex] = position;
+    }
+    
+    outPropertyIndex.isUpToDate = true;
+}
+
+Range<int> SampleFileFilter::findMatchingRange(CompiledFilterRule const & inRule, SortedPropertyIndex const & inPropertyIndex)
+{
+    std::vector<double> const & values = inPropertyIndex.values;
+    double compareValue = inRule.compareValue;
+    
+    // Nothing compares equal to an unknown value
+    if (std::isnan(compareValue))
+    {
+        return Range<int>();
+    }
+    
+    int lowerBound = (int) (std::lower_bound(values.begin(), values.end(), compareValue) - values.begin());
+    int upperBound = (int) (std::upper_bound(values.begin(), values.end(), compareValue) - values.begin());
+    
+    switch (inRule.compareOperator)
+    {
+        case LESS_THAN:
+            return Range<int>(0, lowerBound);
+        case EQUAL_TO:
+            return Range<int>(lowerBound, upperBound);
+        case GREATER_THAN:
+            return Range<int>(upperBound, (int) values.size());
+        default:
+            return Range<int>();
+    }
+}
+
+void SampleFileFilter::buildTitleIndex(OwnedArray<SampleItem>& inSampleItems, TitleTrigramIndex& outTitleIndex)
+{
+    outTitleIndex.postings.clear();
+    outTitleIndex.numIndexedItems = 0;
+    
+    for (int i = 0; i < inSampleItems.size(); i++)
+    {
+        addToTitleIndex(i, inSampleItems.getUnchecked(i)->getTitle(), outTitleIndex);
+    }
+    
+    outTitleIndex.numIndexedItems = inSampleItems.size();
+    outTitleIndex.isUpToDate = true;
+}
+
+void SampleFileFilter::addToTitleIndex(int inItemIndex, String const & inTitle, TitleTrigramIndex& outTitleIndex)
+{
+    for (uint64 trigram : getTitleTrigrams(inTitle))
+    {
+        std::vector<int>& posting = outTitleIndex.postings[trigram];
+        
+        if (posting.empty() || posting.back() < inItemIndex)
+        {
+            posting.push_back(inItemIndex);
+        }
+        else
+        {
+            // A renamed item is inserted back at its place
+            auto position = std::lower_bound(posting.begin(), posting.end(), inItemIndex);
+            
+            if (position == posting.end() || *position != inItemIndex)
+            {
+                posting.insert(position, inItemIndex);
+            }
+        }
+    }
+}
+
+void SampleFileFilter::removeFromTitleIndex(int inItemIndex, String const & inTitle, TitleTrigramIndex& outTitleIndex)
+{
+    for (uint64 trigram : getTitleTrigrams(inTitle))
+    {
+        auto posting = outTitleIndex.postings.find(trigram);
+        
+        if (posting == outTitleIndex.postings.end())
+        {
+            continue;
+        }
+        
+        auto position = std::lower_bound(posting->second.begin(), posting->second.end(), inItemIndex);
+        
+        if (position != posting->second.end() && *position == inItemIndex)
+        {
+            posting->second.erase(position);
+        }
+    }
+}
+
+void SampleFileFilter::intersectWithTitleCandidates(CompiledFilterRule const & inRule,
+                                                    TitleTrigramIndex const & inTitleIndex,
+                                                    std::vector<int>& outMatchingIndices)
+{
+    std::vector<std::vector<int> const *> postings;
+    
+    for (uint64 trigram : getTitleTrigrams(inRule.compareText))
+    {
+        auto posting = inTitleIndex.postings.find(trigram);
+        
+        // No title contains all trigrams of the needle
+        if (posting == inTitleIndex.postings.end())
+        {
+            outMatchingIndices.clear();
+            return;
+        }
+        
+        postings.push_back(&posting->second);
+    }
+    
+    // Intersect the shortest postings first to keep the intermediate results small
+    std::sort(postings.begin(), postings.end(), [](auto const & a, auto const & b)
+    {
+        return a->size() < b->size();
+    });
+    
+    std::vector<int> intersection;
+    
+    for (std::vector<int> const * posting : postings)
+    {
+        intersection.clear();
+        std::set_intersection(outMatchingIndices.begin(), outMatchingIndices.end(),
+                              posting->begin(), posting->end(),
+                              std::back_inserter(intersection));
+        outMatchingIndices.swap(intersection);
+        
+        if (outMatchingIndices.empty())
+        {
+            return;
+        }
+    }
+}
+
+std::vector<uint64> SampleFileFilter::getTitleTrigrams(String const & inTitle)
+{
+    std::vector<uint64> trigrams;
+    uint64 trigram = 0;
+    int numCharacters = 0;
+    
+    // Pack three lowercased 21 bit code points into one key
+    for (String::CharPointerType character = inTitle.getCharPointer(); !character.isEmpty(); ++character)
+    {
+        uint64 lowercaseCharacter = (uint64) CharacterFunctions::toLowerCase(*character) & 0x1fffff;
+        trigram = ((trigram << 21) | lowercaseCharacter) & 0x7fffffffffffffff;
+        
+        if (++numCharacters >= 3)
+        {
+            trigrams.push_back(trigram);
+        }
+    }
+    
+    std::sort(trigrams.begin(), trigrams.end());
+    trigrams.erase(std::unique(trigrams.begin(), trigrams.end()), trigrams.end());
+    
+    return trigrams;
+}
+
+bool SampleFileFilter::matchesTitleRule(CompiledFilterRule const & inRule, String const & inTitle)
+{
+    switch (inRule.compareOperator)
+    {
+        case EQUAL_TO:
+            return inTitle == inRule.compareText;
+        case CONTAINS:
+            return containsLowercaseNeedle(inTitle, inRule.compareText);
+        default:
+            return false;
+    }
+}
+
+bool SampleFileFilter::containsLowercaseNeedle(String const & inTitle, String const & inLowercaseNeedle)
+{
+    if (inLowercaseNeedle.isEmpty())
+    {
+        return true;
+    }
+    
+    juce_wchar firstNeedleCharacter = inLowercaseNeedle[0];
+    
+    for (String::CharPointerType titleStart = inTitle.getCharPointer(); !titleStart.isEmpty(); ++titleStart)
+    {
+        // Only compare the rest of the needle where the first character matches
+        if (CharacterFunctions::toLowerCase(*titleStart) != firstNeedleCharacter)
+        {
+            continue;
+        }
+        
+        String::CharPointerType title = titleStart;
+        String::CharPointerType needle = inLowercaseNeedle.getCharPointer();
+        
+        while (!needle.isEmpty() && CharacterFunctions::toLowerCase(*title) == *needle)
+        {
+            ++title;
+            ++needle;
+        }
+        
+        if (needle.isEmpty())
+        {
+            return true;
+        }
+    }
+    
+    return false;
+}
+
 SampleFileFilterRuleBase* SampleFileFilter::addFilterRule(SampleFileFilterRuleBase* inFilterRule)
 {
     mFilterRules.add(inFilterRule);
@@ -14,6 +14,32 @@
 #include "BlomeHelpers.h"
 #include "SampleFileFilterRuleBase.h"
 
+/**
+ The values of one numeric sample item property in ascending order.
+ 
+ Lets range rules be resolved by binary search instead of checking every sample item.
+ The ranks hold each sample item's position in the sorted values, or -1 if the item has no valid value.
+ */
+struct SortedPropertyIndex
+{
+    std::vector<double> values;
+    std::vector<int> itemIndices;
+    std::vector<int> ranks;
+    bool isUpToDate = false;
+};
+
+/**
+ Maps every trigram of the lowercased sample item titles to the ascending indices of the items containing it.
+ 
+ Lets title substring rules be resolved to a small candidate set before the titles are searched.
+ */
+struct TitleTrigramIndex
+{
+    std::unordered_map<uint64, std::vector<int>> postings;
+    int numIndexedItems = 0;
+    bool isUpToDate = false;
+};
+
 /**
  The filter class to check if SampleItem objects and files are matching the filter rules.
  
@@ -28,9 +54,8 @@ public:
      The constructor for the sample file filter.
      
      @param inDescription the description of the file filter.
-     @param inFilteredSampleItems the collection of filtered sample items in the library.
      */
-    SampleFileFilter(String const & inDescription, OwnedArray<SampleItem>& inFilteredSampleItems);
+    SampleFileFilter(String const & inDescription);
     ~SampleFileFilter();
     /**
      Checks if all filter rules apply to the sample item.
@@ -40,6 +65,46 @@ public:
      @returns whether the sample item matches all the rules.
      */
     bool matchesRules(SampleItem& inSampleItem);
+    /**
+     Compiles the active rules into flat comparisons and checks them for a whole collection at once.
+     
+     Numeric rules are resolved to ranges of their property's sorted index. Only the sample items in the smallest range
+     are checked against the other ranges, title rules only for the items that are still matching.
+     
+     @param inSampleItems the sample items to apply the filter to.
+     @param inPropertyIndexes the sorted indexes for each property, outdated indexes are rebuilt when a rule needs them.
+     @param inTitleIndex the trigram index of the titles, rebuilt when outdated and a title rule needs it.
+     
+     @returns the indices of all sample items that match all the rules in ascending order.
+     */
+    std::vector<int> matchRules(OwnedArray<SampleItem>& inSampleItems,
+                                std::vector<SortedPropertyIndex>& inPropertyIndexes,
+                                TitleTrigramIndex& inTitleIndex);
+    /**
+     Builds the trigram index for the titles of all sample items.
+     
+     @param inSampleItems the sample items to index.
+     @param outTitleIndex the index to fill.
+     */
+    void buildTitleIndex(OwnedArray<SampleItem>& inSampleItems, TitleTrigramIndex& outTitleIndex);
+    /**
+     Adds the trigrams of a title to the index.
+     
+     Item indices have to be added in ascending order to keep the postings sorted, except when re-adding a renamed item.
+     
+     @param inItemIndex the index of the sample item in the collection.
+     @param inTitle the title of the sample item.
+     @param outTitleIndex the index to add the title to.
+     */
+    void addToTitleIndex(int inItemIndex, String const & inTitle, TitleTrigramIndex& outTitleIndex);
+    /**
+     Removes the trigrams of a title from the index, e.g. before a sample item is renamed.
+     
+     @param inItemIndex the index of the sample item in the collection.
+     @param inTitle the title the sample item was indexed with.
+     @param outTitleIndex the index to remove the title from.
+     */
+    void removeFromTitleIndex(int inItemIndex, String const & inTitle, TitleTrigramIndex& outTitleIndex);
     /**
      Adds a filter rule to the rule collection.
      
@@ -64,12 +129,96 @@ public:
      @returns whether the filter is active and has any active rules that can have an effect on the sample collection.
      */
     bool canHaveEffect();
+    /**
+     Replaces the set of filtered file paths and the directory sample counts that the directory contents list checks against.
+     
+     The new set is published atomically, so the directory scanner thread can keep reading without a lock.
+     
+     @param inFilteredFilePaths the paths of all filtered sample items.
+     */
+    void setFilteredFilePaths(StringArray const & inFilteredFilePaths);
+    /**
+     @param inDirectory the directory to look up.
+     
+     @returns the number of filtered samples in the directory and all its subdirectories.
+     */
+    int getNumFilteredSamplesInDirectory(File const & inDirectory) const;
     
 private:
+    /**
+     The filtered file paths and the number of filtered samples below each directory, published together.
+     */
+    struct FilteredPaths
+    {
+        std::unordered_set<String> filePaths;
+        std::unordered_map<String, int> directorySampleCounts;
+    };
+    
     OwnedArray<SampleFileFilterRuleBase> mFilterRules;
-    OwnedArray<SampleItem>& filteredSampleItems;
+    std::shared_ptr<FilteredPaths const> mFilteredPaths;
     bool isActive;
     
+    /**
+     @returns the compiled comparisons of all active rules that can have an effect.
+     */
+    std::vector<CompiledFilterRule> compileRules();
+    /**
+     Fills a column with the values of a numeric property for all sample items.
+     
+     @param inPropertyIndex the index of the property in PROPERTY_NAMES.
+     @param inSampleItems the sample items to read the property from.
+     @param outColumn the column to fill.
+     */
+    void fillPropertyColumn(int inPropertyIndex, OwnedArray<SampleItem>& inSampleItems, std::vector<double>& outColumn);
+    /**
+     Sorts the values of a numeric property of all sample items into an index.
+     
+     @param inPropertyIndex the index of the property in PROPERTY_NAMES.
+     @param inSampleItems the sample items to read the property from.
+     @param outPropertyIndex the index to fill.
+     */
+    void buildPropertyIndex(int inPropertyIndex, OwnedArray<SampleItem>& inSampleItems, SortedPropertyIndex& outPropertyIndex);
+    /**
+     Finds the positions in a sorted property index of all values that match a numeric rule.
+     
+     @param inRule the compiled numeric rule.
+     @param inPropertyIndex the sorted index of the rule's property.
+     
+     @returns the range of matching positions in the index.
+     */
+    Range<int> findMatchingRange(CompiledFilterRule const & inRule, SortedPropertyIndex const & inPropertyIndex);
+    /**
+     Reduces the matching items to the ones that contain all trigrams of the rule's lowercase needle.
+     
+     @param inRule the compiled title contains rule with a needle of at least three characters.
+     @param inTitleIndex the up to date trigram index of the titles.
+     @param outMatchingIndices the ascending indices of the matching items.
+     */
+    void intersectWithTitleCandidates(CompiledFilterRule const & inRule,
+                                      TitleTrigramIndex const & inTitleIndex,
+                                      std::vector<int>& outMatchingIndices);
+    /**
+     @param inTitle the title to get the trigrams of.
+     
+     @returns the distinct trigrams of the lowercased title.
+     */
+    std::vector<uint64> getTitleTrigrams(String const & inTitle);
+    /**
+     @param inRule the compiled title rule.
+     @param inTitle the title of the sample item.
+     
+     @returns whether the title matches the rule.
+     */
+    bool matchesTitleRule(CompiledFilterRule const & inRule, String const & inTitle);
+    /**
+     Searches a lowercase needle in a title while lowering the title's characters on the fly.
+     
+     @param inTitle the title to search in.
+     @param inLowercaseNeedle the lowercased text to search for.
+     
+     @returns whether the title contains the needle, ignoring case.
+     */
+    bool containsLowercaseNeedle(String const & inTitle, String const & inLowercaseNeedle);
     bool isFileSuitable (File const & file) const override;
     bool isDirectorySuitable (File const & file) const override;
     
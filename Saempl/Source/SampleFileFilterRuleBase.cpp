@@ -45,3 +45,14 @@ void SampleFileFilterRuleBase::setIsActive(bool inIsActive)
 {
     isActive = inIsActive;
 }
+
+CompiledFilterRule SampleFileFilterRuleBase::createCompiledRule(double inCompareValue, String const & inCompareText)
+{
+    CompiledFilterRule compiledRule;
+    compiledRule.propertyIndex = PROPERTY_NAMES.indexOf(mRulePropertyName);
+    compiledRule.compareOperator = mCompareOperator;
+    compiledRule.compareValue = inCompareValue;
+    compiledRule.compareText = inCompareText;
+    
+    return compiledRule;
+}
@@ -13,6 +13,19 @@
 #include "SampleItem.h"
 #include "BlomeHelpers.h"
 
+/**
+ A filter rule reduced to a single comparison on one sample item property.
+ 
+ SampleFileFilter evaluates these over a whole collection instead of calling each rule per item.
+ */
+struct CompiledFilterRule
+{
+    int propertyIndex;
+    CompareOperators compareOperator;
+    double compareValue;
+    String compareText;
+};
+
 /**
  The base class for SampleFileFilter rules.
  
@@ -54,6 +67,10 @@ public:
      @returns whether the rule is active and if it can have any effect on the sample collection filtering.
      */
     virtual bool canHaveEffect() = 0;
+    /**
+     @returns the rule as a comparison on the property column with the index of the rule's property name.
+     */
+    virtual CompiledFilterRule compile() = 0;
     /**
      Sets if the rule is active.
      
@@ -70,5 +87,15 @@ protected:
     String mRulePropertyName;
     bool isActive;
     
+    /**
+     Creates the compiled comparison for the rule's property and compare operator.
+     
+     @param inCompareValue the value numeric properties are compared against.
+     @param inCompareText the text the title is compared against.
+     
+     @returns the compiled rule.
+     */
+    CompiledFilterRule createCompiledRule(double inCompareValue, String const & inCompareText);
+    
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(SampleFileFilterRuleBase);
 };
@@ -70,3 +70,8 @@ bool SampleFileFilterRuleCentroid::canHaveEffect()
 {
     return isActive && (mCompareOperator != GREATER_THAN || mCompareValue > -1);
 }
+
+CompiledFilterRule SampleFileFilterRuleCentroid::compile()
+{
+    return createCompiledRule(mCompareValue, String());
+}
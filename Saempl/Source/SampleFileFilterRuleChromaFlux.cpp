@@ -70,3 +70,8 @@ bool SampleFileFilterRuleChromaFlux::canHaveEffect()
 {
     return isActive && (mCompareOperator != GREATER_THAN || mCompareValue > -1);
 }
+
+CompiledFilterRule SampleFileFilterRuleChromaFlux::compile()
+{
+    return createCompiledRule(mCompareValue, String());
+}
@@ -70,3 +70,8 @@ bool SampleFileFilterRuleDynamicRange::canHaveEffect()
 {
     return isActive && (mCompareOperator != GREATER_THAN || mCompareValue > -1);
 }
+
+CompiledFilterRule SampleFileFilterRuleDynamicRange::compile()
+{
+    return createCompiledRule(mCompareValue, String());
+}
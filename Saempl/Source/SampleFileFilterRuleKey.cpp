@@ -70,3 +70,19 @@ bool SampleFileFilterRuleKey::canHaveEffect()
 {
     return isActive;
 }
+
+CompiledFilterRule SampleFileFilterRuleKey::compile()
+{
+    // Compare key indices instead of key names
+    double keyIndex = std::numeric_limits<double>::quiet_NaN();
+    
+    for (auto const & key : KEY_INDEX_TO_KEY_NAME)
+    {
+        if (key.second == mCompareValue)
+        {
+            keyIndex = key.first;
+        }
+    }
+    
+    return createCompiledRule(keyIndex, String());
+}
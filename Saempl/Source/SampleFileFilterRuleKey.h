@@ -38,6 +38,7 @@ public:
      */
     void setCompareValue(String const & inCompareValue);
     bool canHaveEffect() override;
+    CompiledFilterRule compile() override;
     
 private:
     String mCompareValue;
@@ -70,3 +70,8 @@ bool SampleFileFilterRuleLength::canHaveEffect()
 {
     return isActive && (mCompareOperator != GREATER_THAN || mCompareValue != 0.0);
 }
+
+CompiledFilterRule SampleFileFilterRuleLength::compile()
+{
+    return createCompiledRule(mCompareValue, String());
+}
@@ -70,3 +70,8 @@ bool SampleFileFilterRuleLoudnessDecibel::canHaveEffect()
 {
     return isActive && (mCompareOperator != GREATER_THAN || mCompareValue != -300);
 }
+
+CompiledFilterRule SampleFileFilterRuleLoudnessDecibel::compile()
+{
+    return createCompiledRule(mCompareValue, String());
+}
@@ -70,3 +70,8 @@ bool SampleFileFilterRuleLoudnessLUFS::canHaveEffect()
 {
     return isActive && (mCompareOperator != GREATER_THAN || mCompareValue != -300);
 }
+
+CompiledFilterRule SampleFileFilterRuleLoudnessLUFS::compile()
+{
+    return createCompiledRule(mCompareValue, String());
+}
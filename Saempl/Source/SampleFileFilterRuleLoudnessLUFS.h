@@ -38,6 +38,7 @@ public:
      */
     void setCompareValue(double const & inCompareValue);
     bool canHaveEffect() override;
+    CompiledFilterRule compile() override;
     
 private:
     double mCompareValue;
@@ -70,3 +70,8 @@ bool SampleFileFilterRuleRolloff::canHaveEffect()
 {
     return isActive && (mCompareOperator != GREATER_THAN || mCompareValue > -1);
 }
+
+CompiledFilterRule SampleFileFilterRuleRolloff::compile()
+{
+    return createCompiledRule(mCompareValue, String());
+}
@@ -70,3 +70,8 @@ bool SampleFileFilterRuleSpectralFlux::canHaveEffect()
 {
     return isActive && (mCompareOperator != GREATER_THAN || mCompareValue > -1);
 }
+
+CompiledFilterRule SampleFileFilterRuleSpectralFlux::compile()
+{
+    return createCompiledRule(mCompareValue, String());
+}
@@ -70,3 +70,8 @@ bool SampleFileFilterRuleSpectralSpread::canHaveEffect()
 {
     return isActive && (mCompareOperator != GREATER_THAN || mCompareValue > -1);
 }
+
+CompiledFilterRule SampleFileFilterRuleSpectralSpread::compile()
+{
+    return createCompiledRule(mCompareValue, String());
+}
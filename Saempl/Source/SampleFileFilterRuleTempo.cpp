@@ -70,3 +70,8 @@ bool SampleFileFilterRuleTempo::canHaveEffect()
 {
     return isActive && (mCompareOperator != GREATER_THAN || mCompareValue > -1);
 }
+
+CompiledFilterRule SampleFileFilterRuleTempo::compile()
+{
+    return createCompiledRule(mCompareValue, String());
+}
@@ -38,6 +38,7 @@ public:
      */
     void setCompareValue(int const & inCompareValue);
     bool canHaveEffect() override;
+    CompiledFilterRule compile() override;
     
 private:
     int mCompareValue;
@@ -69,3 +69,9 @@ bool SampleFileFilterRuleTitle::canHaveEffect()
 {
     return isActive && (mCompareOperator != CONTAINS || mCompareValue != "");
 }
+
+CompiledFilterRule SampleFileFilterRuleTitle::compile()
+{
+    // The needle for contains is lowercased once instead of for every title
+    return createCompiledRule(0.0, mCompareOperator == CONTAINS ? mCompareValue.toLowerCase() : mCompareValue);
+}
@@ -70,3 +70,8 @@ bool SampleFileFilterRuleZeroCrossingRate::canHaveEffect()
 {
     return isActive && (mCompareOperator != GREATER_THAN || mCompareValue > -1);
 }
+
+CompiledFilterRule SampleFileFilterRuleZeroCrossingRate::compile()
+{
+    return createCompiledRule(mCompareValue, String());
+}
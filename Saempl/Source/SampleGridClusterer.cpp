@@ -16,27 +16,72 @@
 
 #include "SampleGridClusterer.h"
 
-SampleGridClusterer::SampleGridClusterer(OwnedArray<SampleItem>& inSampleItems)
+SampleGridClusterer::SampleGridClusterer()
 :
 ThreadWithProgressWindow("Improving sample grid clustering quality", true, true, 10000, "Stop improving", nullptr),
 ThreadPool(SystemStats::getNumCpus() * 1),
-numThreads(SystemStats::getNumCpus() * 1),
-sampleItems(inSampleItems)
+numThreads(SystemStats::getNumCpus() * 1)
 {
     
 }
 
 SampleGridClusterer::~SampleGridClusterer()
 {
-    
+    cancelClustering();
+    mGridItems.clear();
 }
 
-void SampleGridClusterer::applyClustering(int inRows, int inColumns, bool doWrap)
+void SampleGridClusterer::applyClustering(Array<SampleItem*> const & inGridItems,
+                                          int inRows,
+                                          int inColumns,
+                                          bool doWrap,
+                                          bool inBackground)
 {
+    if (isThreadRunning())
+    {
+        cancelClustering();
+    }
+    
     rows = inRows;
     columns = inColumns;
     applyWrap = doWrap;
-    launchThread();
+    runInBackground = inBackground;
+    clusteringIsFinished = false;
+    clusteringWasCancelled = false;
+    clusteringGeneration++;
+    
+    // Work on a copy of the collection so it stays untouched while the clustering runs
+    mGridItems.clear();
+    mGridItems.addArray(inGridItems);
+    
+    {
+        CriticalSection::ScopedLockType const scopedLock(mSnapshotLock);
+        snapshotIsNew = false;
+    }
+    
+    if (runInBackground)
+    {
+        startThread(Thread::Priority::low);
+    }
+    else
+    {
+        launchThread();
+    }
+}
+
+void SampleGridClusterer::cancelClustering()
+{
+    // Drop the queued swap jobs first, so the clustering thread doesn't work off the rest of its radius step
+    // and only the few running swaps are waited for, the timeouts are only a last resort
+    clusteringWasCancelled = true;
+    clusteringGeneration++;
+    signalThreadShouldExit();
+    removeAllJobs(true, 10000);
+    stopThread(10000);
+    
+    // A change message of the cancelled run may still be queued, its grid items can be freed after this call
+    CriticalSection::ScopedLockType const scopedLock(mSnapshotLock);
+    snapshotIsNew = false;
 }
 
 void SampleGridClusterer::setFeatureWeights(std::vector<float> inFeatureWeights)
@@ -49,53 +94,134 @@ void SampleGridClusterer::run()
 {
     int64 startTime = Time::currentTimeMillis();
     setProgressAndStatus(0.0, startTime);
+    updateFeatureVectors();
+    clusterGridItems(startTime, warmStartIsEnabled);
+    
+    // A cancelled clustering is discarded, stopping it via the progress window keeps the current layout
+    if (clusteringWasCancelled)
+    {
+        return;
+    }
     
-    // Assign input vectors to random grid positions
-    unsigned seed = (unsigned) std::chrono::system_clock::now().time_since_epoch().count();
-    std::shuffle(sampleItems.getRawDataPointer(),
-                 sampleItems.getRawDataPointer() + sampleItems.size(),
-                 std::default_random_engine(seed));
+    storeGridLayout();
+    distancePreservationQuality = calculateDistancePreservationQuality();
+    publishGridSnapshot();
+    clusteringIsFinished = true;
     
-    // Copy weighted features to feature vectors
+    if (runInBackground)
+    {
+        sendChangeMessage();
+    }
+}
+
+void SampleGridClusterer::updateFeatureVectors()
+{
+    // The last layout is only a useful seed if the feature vectors didn't change
     if (featureWeightsChanged)
     {
-        for (SampleItem* sample : sampleItems)
+        mPreviousGridPositions.clear();
+    }
+    
+    // Copy weighted features to feature vectors,
+    // only samples that were added since the last clustering need them
+    for (SampleItem* sample : mGridItems)
+    {
+        if (!featureWeightsChanged && sample->getFeatureVector().size() == NUM_FEATURES + NUM_SPECTRAL_BANDS + NUM_CHROMA)
         {
-            std::vector<float> featureVector = std::vector<float>(NUM_FEATURES + NUM_SPECTRAL_BANDS + NUM_CHROMA);
-            
-            featureVector[0] = sample->getLength() / 60 * mFeatureWeights[0];
-            featureVector[1] = (sample->getLoudnessLUFS() + 300) / (3 + 300) * mFeatureWeights[1];
-            featureVector[2] = (sample->getDynamicRange() - 0) / (303 - 0) * mFeatureWeights[2];
-            featureVector[3] = sample->getZeroCrossingRate() / sample->getSampleRate() * mFeatureWeights[3];
-            featureVector[4] = (sample->getTempo() - LOWER_BPM_LIMIT) / (UPPER_BPM_LIMIT - LOWER_BPM_LIMIT) * mFeatureWeights[4];
-            featureVector[5] = sample->getKey() * 1.0 / NUM_CHROMA * mFeatureWeights[5];
-            featureVector[6] = sample->getSpectralCentroid() / 20000 * mFeatureWeights[6];
-            featureVector[7] = sample->getSpectralSpread() / 100 * mFeatureWeights[7];
-            featureVector[8] = sample->getSpectralRolloff() / 100 * mFeatureWeights[8];
-            featureVector[9] = sample->getSpectralFlux() / 100 * mFeatureWeights[9];
-            featureVector[10] = sample->getChromaFlux() / 100 * mFeatureWeights[10];
-            
-            std::vector<float> spectralDistribution = sample->getSpectralDistribution();
-            for (int sb = 0; sb < NUM_SPECTRAL_BANDS; sb++)
-            {
-                featureVector[NUM_FEATURES + sb] = spectralDistribution[sb] * mFeatureWeights[11];
-            }
-            
-            std::vector<float> chromaDistribution = sample->getChromaDistribution();
-            for (int c = 0; c < NUM_CHROMA; c++)
-            {
-                featureVector[NUM_FEATURES + NUM_SPECTRAL_BANDS + c] = chromaDistribution[c] * mFeatureWeights[12];
-            }
-            
-            sample->setFeatureVector(featureVector);
+            continue;
+        }
+        
+        std::vector<float> featureVector = std::vector<float>(NUM_FEATURES + NUM_SPECTRAL_BANDS + NUM_CHROMA);
+        
+        featureVector[0] = sample->getLength() / 60 * mFeatureWeights[0];
+        featureVector[1] = (sample->getLoudnessLUFS() + 300) / (3 + 300) * mFeatureWeights[1];
+        featureVector[2] = (sample->getDynamicRange() - 0) / (303 - 0) * mFeatureWeights[2];
+        featureVector[3] = sample->getZeroCrossingRate() / sample->getSampleRate() * mFeatureWeights[3];
+        featureVector[4] = (sample->getTempo() - LOWER_BPM_LIMIT) / (UPPER_BPM_LIMIT - LOWER_BPM_LIMIT) * mFeatureWeights[4];
+        featureVector[5] = sample->getKey() * 1.0 / NUM_CHROMA * mFeatureWeights[5];
+        featureVector[6] = sample->getSpectralCentroid() / 20000 * mFeatureWeights[6];
+        featureVector[7] = sample->getSpectralSpread() / 100 * mFeatureWeights[7];
+        featureVector[8] = sample->getSpectralRolloff() / 100 * mFeatureWeights[8];
+        featureVector[9] = sample->getSpectralFlux() / 100 * mFeatureWeights[9];
+        featureVector[10] = sample->getChromaFlux() / 100 * mFeatureWeights[10];
+        
+        std::vector<float> spectralDistribution = sample->getSpectralDistribution();
+        for (int sb = 0; sb < NUM_SPECTRAL_BANDS; sb++)
+        {
+            featureVector[NUM_FEATURES + sb] = spectralDistribution[sb] * mFeatureWeights[11];
         }
         
-        featureWeightsChanged = false;
+        std::vector<float> chromaDistribution = sample->getChromaDistribution();
+        for (int c = 0; c < NUM_CHROMA; c++)
+        {
+            featureVector[NUM_FEATURES + NUM_SPECTRAL_BANDS + c] = chromaDistribution[c] * mFeatureWeights[12];
+        }
+        
+        sample->setFeatureVector(featureVector);
     }
     
+    featureWeightsChanged = false;
+}
+
+void SampleGridClusterer::clusterGridItems(int64 startTime, bool allowWarmStart)
+{
+    // Every swap job draws from its own stream of the clustering seed
+    clusteringSeed = randomSeed != 0 ? randomSeed : (uint64) Time::getHighResolutionTicks();
+    mRandom = RandomStream(clusteringSeed);
+    numCheckedSwaps = 0;
+    
+    // Seed the grid from the last layout or assign input vectors to random grid positions
+    bool isWarmStart = allowWarmStart && seedGridFromPreviousLayout();
+    int blockSize = 0;
+    
+    if (!isWarmStart)
+    {
+        std::shuffle(mGridItems.getRawDataPointer(),
+                     mGridItems.getRawDataPointer() + mGridItems.size(),
+                     mRandom);
+        
+        // Large grids are first sorted coarsely with prototypes of the collection
+        if (rows * columns >= minHierarchicalGridSize)
+        {
+            blockSize = seedGridFromPrototypes(startTime);
+        }
+    }
+    
+    // Calculate initial radius
+    float rad = jmax<int>(columns, rows) * initialRadiusFactor;
+    
+    if (isWarmStart)
+    {
+        // A seeded grid is already coarsely sorted and only needs the small radius refinement
+        rad = jmin<float>(rad, jmax<float>(warmStartRadius, jmax<int>(columns, rows) * warmStartRadiusFactor));
+    }
+    else if (blockSize > 0)
+    {
+        // Samples only need to be sorted within and across neighbouring blocks
+        rad = jmin<float>(rad, blockSize);
+        
+        if (runInBackground && !threadShouldExit())
+        {
+            publishGridSnapshot();
+            sendChangeMessage();
+        }
+    }
+    
+    sortGrid(mGridItems, rows, columns, rad, blockSize > 0 ? prototypeProgressShare : 0.0, 1.0, startTime, runInBackground);
+}
+
+void SampleGridClusterer::sortGrid(Array<SampleItem*>& inGridItems,
+                                   int inRows,
+                                   int inColumns,
+                                   float inRadius,
+                                   double progressStart,
+                                   double progressEnd,
+                                   int64 startTime,
+                                   bool publishSnapshots)
+{
     // Initialise vectors
-    int numDimensions = (int) sampleItems.getFirst()->getFeatureVector().size();
-    int gridSize = columns * rows;
+    int numDimensions = (int) inGridItems.getFirst()->getFeatureVector().size();
+    int gridSize = inColumns * inRows;
     std::vector<std::vector<float>> grid;
     grid.resize(gridSize);
     for (int pos = 0; pos < grid.size(); pos++)
@@ -104,10 +230,10 @@ void SampleGridClusterer::run()
     }
     std::vector<float> weights;
     weights.resize(gridSize);
-    numSwapPositions = jmin<int>(maxSwapPositions, columns * rows);
+    numSwapPositions = jmin<int>(maxSwapPositions, gridSize);
     
-    // Calculate initial radius and number of reductions
-    float rad = jmax<int>(columns, rows) * initialRadiusFactor;
+    // Calculate number of reductions
+    float rad = inRadius;
     float utilRadius = rad;
     int numRadiusReductions = 0;
     
@@ -131,14 +257,14 @@ void SampleGridClusterer::run()
             break;
         }
         
-        setProgressAndStatus(progressCounter++ * 1.0 / numRadiusReductions, startTime);
+        setProgressAndStatus(progressStart + (progressEnd - progressStart) * progressCounter++ / numRadiusReductions, startTime);
         
         int radius = jmax<int>(1, std::round(rad));
-        int radiusX = jmax<int>(1, jmin<int>(columns / 2, radius));
-        int radiusY = jmax<int>(1, jmin<int>(rows / 2, radius));
+        int radiusX = jmax<int>(1, jmin<int>(inColumns / 2, radius));
+        int radiusY = jmax<int>(1, jmin<int>(inRows / 2, radius));
         
         // Copy feature vectors to grid
-        copyFeatureVectorsToGrid(grid, numDimensions, weights);
+        copyFeatureVectorsToGrid(inGridItems, grid, numDimensions, weights);
         
         // Apply filter
         int filterSizeX = 2 * radiusX + 1;
@@ -147,22 +273,22 @@ void SampleGridClusterer::run()
         if (applyWrap)
         {
             // Apply filter to grid
-            grid = filterHorizontallyWrap(grid, rows, columns, numDimensions, filterSizeX);
-            grid = filterVerticallyWrap(grid, rows, columns, numDimensions, filterSizeY);
+            grid = filterHorizontallyWrap(grid, inRows, inColumns, numDimensions, filterSizeX);
+            grid = filterVerticallyWrap(grid, inRows, inColumns, numDimensions, filterSizeY);
             
             // Apply filter to weights
-            weights = filterHorizontallyWrap(weights, rows, columns, filterSizeX);
-            weights = filterVerticallyWrap(weights, rows, columns, filterSizeY);
+            weights = filterHorizontallyWrap(weights, inRows, inColumns, filterSizeX);
+            weights = filterVerticallyWrap(weights, inRows, inColumns, filterSizeY);
         }
         else
         {
             // Apply filter to grid
-            grid = filterHorizontallyMirror(grid, rows, columns, numDimensions, filterSizeX);
-            grid = filterVerticallyMirror(grid, rows, columns, numDimensions, filterSizeY);
+            grid = filterHorizontallyMirror(grid, inRows, inColumns, numDimensions, filterSizeX);
+            grid = filterVerticallyMirror(grid, inRows, inColumns, numDimensions, filterSizeY);
             
             // Apply filter to weights
-            weights = filterHorizontallyMirror(weights, rows, columns, filterSizeX);
-            weights = filterVerticallyMirror(weights, rows, columns, filterSizeY);
+            weights = filterHorizontallyMirror(weights, inRows, inColumns, filterSizeX);
+            weights = filterVerticallyMirror(weights, inRows, inColumns, filterSizeY);
         }
         
         // Apply weights to grid vectors
@@ -177,10 +303,17 @@ void SampleGridClusterer::run()
         }
         
         // Find optimal random swaps
-        checkRandomSwaps(radius, grid, rows, columns);
+        checkRandomSwaps(inGridItems, radius, grid, inRows, inColumns);
         
         // Reduce the filter radius
         rad *= getRadiusDecay(rad);
+        
+        // Let the grid view show the intermediate layout
+        if (publishSnapshots && !threadShouldExit())
+        {
+            publishGridSnapshot();
+            sendChangeMessage();
+        }
     }
 }
 
@@ -189,14 +322,726 @@ void SampleGridClusterer::threadComplete(bool userPressedCancel)
     sendChangeMessage();
 }
 
-void SampleGridClusterer::copyFeatureVectorsToGrid(std::vector<std::vector<float>>& grid,
+bool SampleGridClusterer::seedGridFromPreviousLayout()
+{
+    if (mPreviousGridPositions.empty())
+    {
+        return false;
+    }
+    
+    // Sort grid items into samples that kept their place, new samples and empty squares
+    Array<SampleItem*> keptSamples;
+    Array<SampleItem*> newSamples;
+    Array<SampleItem*> emptySquares;
+    
+    for (SampleItem* sample : mGridItems)
+    {
+        if (sample->getCurrentFilePath() == EMPTY_TILE_PATH)
+        {
+            emptySquares.add(sample);
+        }
+        else if (mPreviousGridPositions.find(sample->getCurrentFilePath()) != mPreviousGridPositions.end())
+        {
+            keptSamples.add(sample);
+        }
+        else
+        {
+            newSamples.add(sample);
+        }
+    }
+    
+    // Fall back to a full clustering if the collection changed too much
+    int numRemovedSamples = (int) mPreviousGridPositions.size() - keptSamples.size();
+    int numSamples = keptSamples.size() + newSamples.size();
+    
+    if (keptSamples.isEmpty() || newSamples.size() + numRemovedSamples > numSamples * maxWarmStartChangeRatio)
+    {
+        return false;
+    }
+    
+    // Place the kept samples at their previous position, scaled to the new grid dimensions
+    std::vector<SampleItem*> seededGrid(rows * columns, nullptr);
+    std::vector<int> keptPositions(keptSamples.size());
+    float scaleX = previousColumns > 1 ? (columns - 1) * 1.0 / (previousColumns - 1) : 0.0;
+    float scaleY = previousRows > 1 ? (rows - 1) * 1.0 / (previousRows - 1) : 0.0;
+    
+    for (int k = 0; k < keptSamples.size(); k++)
+    {
+        int previousPosition = mPreviousGridPositions[keptSamples.getUnchecked(k)->getCurrentFilePath()];
+        int x = roundToInt((previousPosition % previousColumns) * scaleX);
+        int y = roundToInt((previousPosition / previousColumns) * scaleY);
+        int pos = findNearestFreePosition(seededGrid, x, y);
+        seededGrid[pos] = keptSamples.getUnchecked(k);
+        keptPositions[k] = pos;
+    }
+    
+    // Place each new sample next to its most similar kept sample
+    int numDimensions = (int) keptSamples.getFirst()->getFeatureVector().size();
+    std::vector<float> keptFeatures(keptSamples.size() * numDimensions);
+    
+    for (int k = 0; k < keptSamples.size(); k++)
+    {
+        std::vector<float> featureVector = keptSamples.getUnchecked(k)->getFeatureVector();
+        std::copy(featureVector.begin(), featureVector.end(), keptFeatures.begin() + k * numDimensions);
+    }
+    
+    for (SampleItem* sample : newSamples)
+    {
+        std::vector<float> featureVector = sample->getFeatureVector();
+        int nearestSample = 0;
+        float minDistance = std::numeric_limits<float>::max();
+        
+        for (int k = 0; k < keptSamples.size(); k++)
+        {
+            float const * keptFeature = keptFeatures.data() + k * numDimensions;
+            float distance = 0.0;
+            
+            for (int d = 0; d < numDimensions; d++)
+            {
+                float dist = featureVector[d] - keptFeature[d];
+                distance += dist * dist;
+            }
+            
+            if (distance < minDistance)
+            {
+                minDistance = distance;
+                nearestSample = k;
+            }
+        }
+        
+        int pos = findNearestFreePosition(seededGrid,
+                                          keptPositions[nearestSample] % columns,
+                                          keptPositions[nearestSample] / columns);
+        seededGrid[pos] = sample;
+    }
+    
+    // Fill the remaining positions with empty squares
+    int e = 0;
+    
+    for (int pos = 0; pos < (int) seededGrid.size(); pos++)
+    {
+        if (seededGrid[pos] == nullptr)
+        {
+            seededGrid[pos] = emptySquares.getUnchecked(e++);
+        }
+        
+        mGridItems.set(pos, seededGrid[pos]);
+    }
+    
+    return true;
+}
+
+int SampleGridClusterer::findNearestFreePosition(std::vector<SampleItem*>& inSeededGrid, int x, int y)
+{
+    int maxRing = jmax<int>(columns, rows);
+    
+    // Search rings of growing distance around the position
+    for (int ring = 0; ring <= maxRing; ring++)
+    {
+        for (int dy = -ring; dy <= ring; dy++)
+        {
+            int currentY = y + dy;
+            
+            if (currentY < 0 || currentY >= rows)
+            {
+                continue;
+            }
+            
+            // Only the left and right border of the ring, unless it is the top or bottom row
+            int stepX = (abs(dy) == ring) ? 1 : jmax<int>(1, 2 * ring);
+            
+            for (int dx = -ring; dx <= ring; dx += stepX)
+            {
+                int currentX = x + dx;
+                
+                if (currentX < 0 || currentX >= columns)
+                {
+                    continue;
+                }
+                
+                int pos = currentY * columns + currentX;
+                
+                if (inSeededGrid[pos] == nullptr)
+                {
+                    return pos;
+                }
+            }
+        }
+    }
+    
+    jassertfalse;
+    return 0;
+}
+
+void SampleGridClusterer::storeGridLayout()
+{
+    mPreviousGridPositions.clear();
+    previousRows = rows;
+    previousColumns = columns;
+    
+    for (int pos = 0; pos < mGridItems.size(); pos++)
+    {
+        SampleItem* sample = mGridItems.getUnchecked(pos);
+        
+        if (sample->getCurrentFilePath() != EMPTY_TILE_PATH)
+        {
+            mPreviousGridPositions[sample->getCurrentFilePath()] = pos;
+        }
+    }
+}
+
+int SampleGridClusterer::seedGridFromPrototypes(int64 startTime)
+{
+    // Separate the samples from the empty squares
+    Array<SampleItem*> samples;
+    Array<SampleItem*> emptySquares;
+    
+    for (SampleItem* sample : mGridItems)
+    {
+        if (sample->getCurrentFilePath() == EMPTY_TILE_PATH)
+        {
+            emptySquares.add(sample);
+        }
+        else
+        {
+            samples.add(sample);
+        }
+    }
+    
+    // Choose the block size so that the coarse grid holds about the wanted number of prototypes
+    int numWantedPrototypes = roundToInt(jmap<float>(sortingQuality, minSortingQuality, 1.0, minNumPrototypes, maxNumPrototypes));
+    int blockSize = jmax<int>(2, std::ceil(std::sqrt(rows * columns * 1.0 / numWantedPrototypes)));
+    int coarseRows = (rows + blockSize - 1) / blockSize;
+    int coarseColumns = (columns + blockSize - 1) / blockSize;
+    int numPrototypes = coarseRows * coarseColumns;
+    
+    if (samples.size() < numPrototypes || numPrototypes < maxSwapPositions)
+    {
+        return 0;
+    }
+    
+    // Copy the feature vectors into one buffer
+    int numSamples = samples.size();
+    int numDimensions = (int) samples.getFirst()->getFeatureVector().size();
+    std::vector<float> features(numSamples * numDimensions);
+    
+    for (int s = 0; s < numSamples; s++)
+    {
+        std::vector<float> featureVector = samples.getUnchecked(s)->getFeatureVector();
+        std::copy(featureVector.begin(), featureVector.end(), features.begin() + s * numDimensions);
+    }
+    
+    setStatusMessage("Finding prototypes...");
+    std::vector<float> prototypes = calculatePrototypes(features, numSamples, numDimensions, numPrototypes);
+    
+    if (threadShouldExit())
+    {
+        return 0;
+    }
+    
+    // Sort the prototypes on the coarse grid
+    OwnedArray<SampleItem> prototypeItems;
+    
+    for (int k = 0; k < numPrototypes; k++)
+    {
+        // Prototypes need a path to not be weighted as empty squares
+        SampleItem* prototypeItem = prototypeItems.add(new SampleItem());
+        prototypeItem->setCurrentFilePath(String());
+        prototypeItem->setFeatureVector(std::vector<float>(prototypes.begin() + k * numDimensions,
+                                                           prototypes.begin() + (k + 1) * numDimensions));
+    }
+    
+    // Sort a view of the prototypes, the owned array keeps them alive
+    Array<SampleItem*> prototypeGridItems;
+    prototypeGridItems.addArray(prototypeItems);
+    sortGrid(prototypeGridItems,
+             coarseRows,
+             coarseColumns,
+             jmax<int>(coarseColumns, coarseRows) * initialRadiusFactor,
+             0.0,
+             prototypeProgressShare,
+             startTime,
+             false);
+    
+    if (threadShouldExit())
+    {
+        return 0;
+    }
+    
+    for (int k = 0; k < numPrototypes; k++)
+    {
+        std::vector<float> featureVector = prototypeGridItems.getUnchecked(k)->getFeatureVector();
+        std::copy(featureVector.begin(), featureVector.end(), prototypes.begin() + k * numDimensions);
+    }
+    
+    // Each block holds the samples of the prototype at its coarse grid position
+    std::vector<int> freeCapacities(numPrototypes);
+    
+    for (int cy = 0; cy < coarseRows; cy++)
+    {
+        for (int cx = 0; cx < coarseColumns; cx++)
+        {
+            int blockWidth = jmin<int>(blockSize, columns - cx * blockSize);
+            int blockHeight = jmin<int>(blockSize, rows - cy * blockSize);
+            freeCapacities[cy * coarseColumns + cx] = blockWidth * blockHeight;
+        }
+    }
+    
+    // Assign the samples closest to their prototype first, so the outliers move to neighbouring prototypes
+    std::vector<int> nearestPrototypes(numSamples);
+    std::vector<float> nearestDistances(numSamples);
+    
+    for (int s = 0; s < numSamples; s++)
+    {
+        nearestPrototypes[s] = findNearestPrototype(features.data() + s * numDimensions,
+                                                    prototypes,
+                                                    numDimensions,
+                                                    std::vector<int>(),
+                                                    nearestDistances[s]);
+    }
+    
+    std::vector<int> assignmentOrder(numSamples);
+    std::iota(assignmentOrder.begin(), assignmentOrder.end(), 0);
+    std::sort(assignmentOrder.begin(), assignmentOrder.end(), [&nearestDistances](int a, int b)
+    {
+        return nearestDistances[a] < nearestDistances[b];
+    });
+    
+    std::vector<std::vector<SampleItem*>> blockSamples(numPrototypes);
+    
+    for (int s : assignmentOrder)
+    {
+        int block = nearestPrototypes[s];
+        
+        if (freeCapacities[block] == 0)
+        {
+            float distance;
+            block = findNearestPrototype(features.data() + s * numDimensions,
+                                         prototypes,
+                                         numDimensions,
+                                         freeCapacities,
+                                         distance);
+        }
+        
+        freeCapacities[block]--;
+        blockSamples[block].push_back(samples.getUnchecked(s));
+    }
+    
+    // Write the blocks to the grid and fill them up with empty squares
+    int e = 0;
+    
+    for (int cy = 0; cy < coarseRows; cy++)
+    {
+        for (int cx = 0; cx < coarseColumns; cx++)
+        {
+            std::vector<SampleItem*>& currentBlockSamples = blockSamples[cy * coarseColumns + cx];
+            int i = 0;
+            
+            for (int y = cy * blockSize; y < jmin<int>((cy + 1) * blockSize, rows); y++)
+            {
+                for (int x = cx * blockSize; x < jmin<int>((cx + 1) * blockSize, columns); x++)
+                {
+                    SampleItem* item = i < currentBlockSamples.size()
+                    ? currentBlockSamples[i++]
+                    : emptySquares.getUnchecked(e++);
+                    mGridItems.set(y * columns + x, item);
+                }
+            }
+        }
+    }
+    
+    return blockSize;
+}
+
+std::vector<float> SampleGridClusterer::calculatePrototypes(std::vector<float>& inFeatures,
+                                                            int numSamples,
+                                                            int numDimensions,
+                                                            int numPrototypes)
+{
+    // Train on a random subset, the prototypes only need to represent the collection
+    std::vector<int> sampleIndices(numSamples);
+    std::iota(sampleIndices.begin(), sampleIndices.end(), 0);
+    std::shuffle(sampleIndices.begin(), sampleIndices.end(), mRandom);
+    int numTrainingSamples = jmin<int>(numSamples, numPrototypes * trainingSamplesPerPrototype);
+    
+    // Start with random samples as prototypes
+    std::vector<float> prototypes(numPrototypes * numDimensions);
+    
+    for (int k = 0; k < numPrototypes; k++)
+    {
+        std::copy(inFeatures.begin() + sampleIndices[k] * numDimensions,
+                  inFeatures.begin() + (sampleIndices[k] + 1) * numDimensions,
+                  prototypes.begin() + k * numDimensions);
+    }
+    
+    // Move the prototypes to the centroids of their samples (k-means)
+    std::vector<float> centroidSums(numPrototypes * numDimensions);
+    std::vector<int> numAssignedSamples(numPrototypes);
+    int numIterations = roundToInt(jmap<float>(sortingQuality,
+                                                minSortingQuality,
+                                                1.0,
+                                                minNumPrototypeIterations,
+                                                maxNumPrototypeIterations));
+    
+    for (int i = 0; i < numIterations; i++)
+    {
+        if (threadShouldExit())
+        {
+            break;
+        }
+        
+        std::fill(centroidSums.begin(), centroidSums.end(), 0.0);
+        std::fill(numAssignedSamples.begin(), numAssignedSamples.end(), 0);
+        
+        for (int t = 0; t < numTrainingSamples; t++)
+        {
+            float const * feature = inFeatures.data() + sampleIndices[t] * numDimensions;
+            float distance;
+            int k = findNearestPrototype(feature, prototypes, numDimensions, std::vector<int>(), distance);
+            numAssignedSamples[k]++;
+            
+            for (int d = 0; d < numDimensions; d++)
+            {
+                centroidSums[k * numDimensions + d] += feature[d];
+            }
+        }
+        
+        for (int k = 0; k < numPrototypes; k++)
+        {
+            if (numAssignedSamples[k] == 0)
+            {
+                // Move unused prototypes to a random sample
+                int t = sampleIndices[mRandom.nextInt(numTrainingSamples)];
+                std::copy(inFeatures.begin() + t * numDimensions,
+                          inFeatures.begin() + (t + 1) * numDimensions,
+                          prototypes.begin() + k * numDimensions);
+                continue;
+            }
+            
+            for (int d = 0; d < numDimensions; d++)
+            {
+                prototypes[k * numDimensions + d] = centroidSums[k * numDimensions + d] / numAssignedSamples[k];
+            }
+        }
+    }
+    
+    return prototypes;
+}
+
+int SampleGridClusterer::findNearestPrototype(float const * inFeature,
+                                              std::vector<float> const & inPrototypes,
+                                              int numDimensions,
+                                              std::vector<int> const & inFreeCapacities,
+                                              float& outDistance)
+{
+    int numPrototypes = (int) inPrototypes.size() / numDimensions;
+    int nearestPrototype = -1;
+    outDistance = std::numeric_limits<float>::max();
+    
+    for (int k = 0; k < numPrototypes; k++)
+    {
+        if (!inFreeCapacities.empty() && inFreeCapacities[k] == 0)
+        {
+            continue;
+        }
+        
+        float const * prototype = inPrototypes.data() + k * numDimensions;
+        float distance = 0.0;
+        
+        for (int d = 0; d < numDimensions; d++)
+        {
+            float dist = inFeature[d] - prototype[d];
+            distance += dist * dist;
+        }
+        
+        if (distance < outDistance)
+        {
+            outDistance = distance;
+            nearestPrototype = k;
+        }
+    }
+    
+    jassert(nearestPrototype >= 0);
+    return nearestPrototype;
+}
+
+float SampleGridClusterer::calculateDistancePreservationQuality()
+{
+    // Collect the grid positions and feature vectors of the samples
+    std::vector<int> positions;
+    std::vector<float> features;
+    
+    for (int pos = 0; pos < mGridItems.size(); pos++)
+    {
+        SampleItem* sample = mGridItems.getUnchecked(pos);
+        
+        if (sample->getCurrentFilePath() != EMPTY_TILE_PATH)
+        {
+            std::vector<float> featureVector = sample->getFeatureVector();
+            positions.push_back(pos);
+            features.insert(features.end(), featureVector.begin(), featureVector.end());
+        }
+    }
+    
+    int numSamples = (int) positions.size();
+    
+    if (numSamples < 2)
+    {
+        return 1.0;
+    }
+    
+    // Average the neighbourhood distances over an evenly spread subset of samples
+    int numDimensions = (int) features.size() / numSamples;
+    int numNeighbours = numSamples - 1;
+    int numQueries = jmin<int>(numSamples, maxNumQualityQueries);
+    int numEvaluatedQueries = 0;
+    double randomDistance = 0.0;
+    std::vector<double> featureNeighbourDistances(numNeighbours);
+    std::vector<double> gridNeighbourDistances(numNeighbours);
+    std::vector<float> distances(numNeighbours);
+    std::vector<std::pair<int, float>> gridNeighbours(numNeighbours);
+    
+    for (int q = 0; q < numQueries; q++)
+    {
+        if (threadShouldExit())
+        {
+            break;
+        }
+        
+        int i = (int) ((int64) q * numSamples / numQueries);
+        float const * queryFeature = features.data() + i * numDimensions;
+        int queryX = positions[i] % columns;
+        int queryY = positions[i] / columns;
+        
+        for (int j = 0, n = 0; j < numSamples; j++)
+        {
+            if (j == i)
+            {
+                continue;
+            }
+            
+            float const * neighbourFeature = features.data() + j * numDimensions;
+            float distance = 0.0;
+            
+            for (int d = 0; d < numDimensions; d++)
+            {
+                float dist = queryFeature[d] - neighbourFeature[d];
+                distance += dist * dist;
+            }
+            
+            distance = std::sqrt(distance);
+            randomDistance += distance;
+            distances[n] = distance;
+            int dx = positions[j] % columns - queryX;
+            int dy = positions[j] / columns - queryY;
+            gridNeighbours[n++] = std::make_pair(dx * dx + dy * dy, distance);
+        }
+        
+        // Mean distance to the k closest samples in feature space
+        std::sort(distances.begin(), distances.end());
+        double distanceSum = 0.0;
+        
+        for (int k = 0; k < numNeighbours; k++)
+        {
+            distanceSum += distances[k];
+            featureNeighbourDistances[k] += distanceSum / (k + 1);
+        }
+        
+        // Mean distance to the k closest samples on the grid,
+        // samples at the same grid distance can't be told apart, so they count with their mean distance
+        std::sort(gridNeighbours.begin(), gridNeighbours.end(), [](auto const & a, auto const & b)
+        {
+            return a.first < b.first;
+        });
+        distanceSum = 0.0;
+        
+        for (int k = 0; k < numNeighbours;)
+        {
+            int end = k;
+            double tieSum = 0.0;
+            
+            while (end < numNeighbours && gridNeighbours[end].first == gridNeighbours[k].first)
+            {
+                tieSum += gridNeighbours[end++].second;
+            }
+            
+            double tieMean = tieSum / (end - k);
+            
+            for (; k < end; k++)
+            {
+                distanceSum += tieMean;
+                gridNeighbourDistances[k] += distanceSum / (k + 1);
+            }
+        }
+        
+        numEvaluatedQueries++;
+    }
+    
+    if (numEvaluatedQueries == 0)
+    {
+        return 0.0;
+    }
+    
+    // DPQ_p relates how much closer the grid neighbourhoods are than random ones to the best possible neighbourhoods
+    randomDistance /= (double) numEvaluatedQueries * numNeighbours;
+    double gridDeviation = 0.0;
+    double optimalDeviation = 0.0;
+    
+    for (int k = 0; k < numNeighbours; k++)
+    {
+        gridDeviation += std::pow(jmax<double>(0.0, randomDistance - gridNeighbourDistances[k] / numEvaluatedQueries), qualityExponent);
+        optimalDeviation += std::pow(jmax<double>(0.0, randomDistance - featureNeighbourDistances[k] / numEvaluatedQueries), qualityExponent);
+    }
+    
+    if (optimalDeviation <= 0.0)
+    {
+        return 1.0;
+    }
+    
+    return std::pow(gridDeviation / optimalDeviation, 1.0 / qualityExponent);
+}
+
+void SampleGridClusterer::publishGridSnapshot()
+{
+    // Only the clustering thread writes to the back buffer, so it can be filled without holding the lock
+    Array<SampleItem*>& backSnapshot = mGridSnapshots[1 - frontSnapshotIndex];
+    backSnapshot.clearQuick();
+    backSnapshot.addArray(mGridItems.getRawDataPointer(), mGridItems.size());
+    
+    CriticalSection::ScopedLockType const scopedLock(mSnapshotLock);
+    frontSnapshotIndex = 1 - frontSnapshotIndex;
+    snapshotIsNew = true;
+    snapshotGeneration = clusteringGeneration;
+}
+
+bool SampleGridClusterer::getGridSnapshot(Array<SampleItem*>& outGridSnapshot)
+{
+    CriticalSection::ScopedLockType const scopedLock(mSnapshotLock);
+    
+    // Snapshots of cancelled runs are dropped
+    if (!snapshotIsNew || snapshotGeneration != clusteringGeneration)
+    {
+        return false;
+    }
+    
+    outGridSnapshot = mGridSnapshots[frontSnapshotIndex];
+    snapshotIsNew = false;
+    
+    return true;
+}
+
+void SampleGridClusterer::setWarmStartIsEnabled(bool inWarmStartIsEnabled)
+{
+    warmStartIsEnabled = inWarmStartIsEnabled;
+}
+
+void SampleGridClusterer::clearGridLayout()
+{
+    cancelClustering();
+    mPreviousGridPositions.clear();
+}
+
+void SampleGridClusterer::setSortingQuality(float inSortingQuality)
+{
+    sortingQuality = jlimit<float>(minSortingQuality, 1.0, inSortingQuality);
+}
+
+float SampleGridClusterer::getDistancePreservationQuality()
+{
+    return distancePreservationQuality;
+}
+
+void SampleGridClusterer::setRandomSeed(unsigned inRandomSeed)
+{
+    randomSeed = inRandomSeed;
+}
+
+SampleGridClusterer::BenchmarkResult SampleGridClusterer::runBenchmark(int numSamples, int numDimensions, unsigned seed)
+{
+    // The loops check the thread's exit flag, which only startThread clears again
+    jassert(numSamples >= minNumBenchmarkSamples && numDimensions > 0 && seed != 0);
+    jassert(!isThreadRunning() && !threadShouldExit());
+    
+    // Generate samples spread normally around random cluster centres
+    std::mt19937 generator(seed);
+    std::uniform_real_distribution<float> centreDistribution(0.0, 1.0);
+    std::normal_distribution<float> spreadDistribution(0.0, benchmarkClusterSpread);
+    int numClusters = jmax<int>(1, numSamples / benchmarkSamplesPerCluster);
+    std::vector<std::vector<float>> clusterCentres(numClusters, std::vector<float>(numDimensions));
+    
+    for (std::vector<float>& clusterCentre : clusterCentres)
+    {
+        for (float& value : clusterCentre)
+        {
+            value = centreDistribution(generator);
+        }
+    }
+    
+    OwnedArray<SampleItem> syntheticItems;
+    
+    for (int s = 0; s < numSamples; s++)
+    {
+        std::vector<float> featureVector = clusterCentres[s % numClusters];
+        
+        for (float& value : featureVector)
+        {
+            value += spreadDistribution(generator);
+        }
+        
+        SampleItem* syntheticItem = syntheticItems.add(new SampleItem());
+        syntheticItem->setCurrentFilePath(String());
+        syntheticItem->setFeatureVector(featureVector);
+    }
+    
+    // Fill up the grid with empty squares
+    int benchmarkRows = (int) std::sqrt(numSamples);
+    int benchmarkColumns = (numSamples + benchmarkRows - 1) / benchmarkRows;
+    
+    for (int e = numSamples; e < benchmarkRows * benchmarkColumns; e++)
+    {
+        syntheticItems.add(new SampleItem())->setFeatureVector(std::vector<float>(numDimensions));
+    }
+    
+    // Cluster on the calling thread without touching the layout of the library grid
+    rows = benchmarkRows;
+    columns = benchmarkColumns;
+    applyWrap = false;
+    runInBackground = false;
+    clusteringWasCancelled = false;
+    mGridItems.clear();
+    mGridItems.addArray(syntheticItems);
+    unsigned librarySeed = randomSeed;
+    randomSeed = seed;
+    
+    double startTime = Time::getMillisecondCounterHiRes();
+    clusterGridItems(Time::currentTimeMillis(), false);
+    
+    BenchmarkResult result;
+    result.wallTimeSeconds = (Time::getMillisecondCounterHiRes() - startTime) / 1000.0;
+    result.numCheckedSwaps = numCheckedSwaps;
+    result.swapsPerSecond = numCheckedSwaps / jmax<double>(result.wallTimeSeconds, 0.001);
+    result.distancePreservationQuality = calculateDistancePreservationQuality();
+    
+    randomSeed = librarySeed;
+    mGridItems.clear();
+    
+    return result;
+}
+
+bool SampleGridClusterer::getClusteringIsFinished()
+{
+    return clusteringIsFinished;
+}
+
+void SampleGridClusterer::copyFeatureVectorsToGrid(Array<SampleItem*>& inGridItems,
+                                                   std::vector<std::vector<float>>& grid,
                                                    int numDimensions,
                                                    std::vector<float>& weights)
 {
     for (int pos = 0; pos < grid.size(); pos++)
     {
         std::vector<float>& gridCell = grid[pos];
-        SampleItem* sampleItem = sampleItems.getUnchecked(pos);
+        SampleItem* sampleItem = inGridItems.getUnchecked(pos);
         
         if (sampleItem->getCurrentFilePath() != EMPTY_TILE_PATH)
         {
@@ -720,7 +1565,11 @@ std::vector<float> SampleGridClusterer::filterVerticallyMirror(std::vector<float
     return output;
 }
 
-void SampleGridClusterer::checkRandomSwaps(int radius, std::vector<std::vector<float>> & grid, int rows, int columns)
+void SampleGridClusterer::checkRandomSwaps(Array<SampleItem*>& inGridItems,
+                                           int radius,
+                                           std::vector<std::vector<float>> & grid,
+                                           int rows,
+                                           int columns)
 {
     // Set swap size
     int swapAreaWidth = jmin<int>(2 * radius + 1, columns);
@@ -753,16 +1602,20 @@ void SampleGridClusterer::checkRandomSwaps(int radius, std::vector<std::vector<f
     }
     
     // Shuffle swap indices
-    unsigned seed = (unsigned) std::chrono::system_clock::now().time_since_epoch().count();
     std::shuffle(swapAreaIndices.begin(),
                  swapAreaIndices.begin() + swapAreaIndices.size(),
-                 std::default_random_engine(seed));
+                 mRandom);
     
-    int numSwapTries = jmax<int>(1, (sampleFactor * rows * columns / numSwapPositions));
+    int numSwapTries = jmax<int>(1, (sampleFactor * sortingQuality * rows * columns / numSwapPositions));
     
     for (int n = 0; n < numSwapTries; n++)
     {
-        addJob(new SampleSwapJob(sampleItems,
+        if (threadShouldExit())
+        {
+            break;
+        }
+        
+        addJob(new SampleSwapJob(inGridItems,
                                  startIndicesInUse,
                                  swapPositionsInUse,
                                  mSwapLock,
@@ -773,7 +1626,8 @@ void SampleGridClusterer::checkRandomSwaps(int radius, std::vector<std::vector<f
                                  swapAreaHeight,
                                  rows,
                                  columns,
-                                 grid),
+                                 grid,
+                                 RandomStream(clusteringSeed, ++numCheckedSwaps)),
                true);
         
         // Don't do multithreading when radius is too small
@@ -19,6 +19,7 @@
 #include "SampleItem.h"
 #include "SampleSwapJob.h"
 #include <random>
+#include <numeric>
 #include <limits.h>
 
 /**
@@ -31,20 +32,101 @@ public ChangeBroadcaster,
 public ThreadPool
 {
 public:
-    SampleGridClusterer(OwnedArray<SampleItem>& inSampleItems);
+    /**
+     The measurements of a benchmark clustering.
+     */
+    struct BenchmarkResult
+    {
+        double wallTimeSeconds = 0.0;
+        int64 numCheckedSwaps = 0;
+        double swapsPerSecond = 0.0;
+        float distancePreservationQuality = 0.0;
+    };
+    
+    // A benchmark grid needs more tiles than a swap area holds
+    static int const minNumBenchmarkSamples = 10;
+    
+    SampleGridClusterer();
     ~SampleGridClusterer();
     /**
      Applies the clustering algorithm to the given grid of sample items.
      
+     The sample items are copied into a working grid, so the library collection can be changed while the clustering is running.
+     
+     @param inGridItems the sample items and empty squares to arrange on the grid.
      @param rows the number of rows in the grid.
      @param columns the number of columns in the grid.
      @param doWrap whether the clustering should wrap around the edges of the grid.
+     @param inBackground if true, runs without the progress window and publishes a grid snapshot after every radius reduction.
      */
-    void applyClustering(int rows, int columns, bool doWrap);
+    void applyClustering(Array<SampleItem*> const & inGridItems, int rows, int columns, bool doWrap, bool inBackground);
+    /**
+     Stops a running clustering and discards its result, including a snapshot that wasn't picked up yet.
+     */
+    void cancelClustering();
     /**
      Sets the collection feature weights.
      */
     void setFeatureWeights(std::vector<float> inFeatureWeights);
+    /**
+     Sets whether a clustering may start from the last finished layout.
+     
+     If only a small part of the collection changed, the kept samples are placed at their previous positions,
+     new samples next to their most similar kept sample, and only the small radius refinement is run.
+     
+     @param inWarmStartIsEnabled whether the last layout is used as a seed.
+     */
+    void setWarmStartIsEnabled(bool inWarmStartIsEnabled);
+    /**
+     Forgets the last layout, e.g. after another library was loaded, so the next clustering starts from scratch.
+     */
+    void clearGridLayout();
+    /**
+     Sets the trade-off between clustering quality and time.
+     
+     Lower values check fewer swaps per radius and, on large grids, use fewer and less refined prototypes for the coarse sorting.
+     
+     @param inSortingQuality the quality between 0.2 and 1.0.
+     */
+    void setSortingQuality(float inSortingQuality);
+    /**
+     @returns the Distance Preservation Quality (DPQ) of the last finished layout,
+     1.0 means the grid neighbourhoods are as similar as the closest samples of the collection, 0.0 means they are random.
+     */
+    float getDistancePreservationQuality();
+    /**
+     Sets the seed for the random positions of the clustering, so layouts can be reproduced.
+     
+     @param inRandomSeed the seed, or 0 to seed every clustering with the current time.
+     */
+    void setRandomSeed(unsigned inRandomSeed);
+    /**
+     Clusters a synthetic collection of normally distributed feature vectors on the calling thread,
+     so changes to the clustering can be compared in speed and layout quality.
+     
+     Needs a clusterer that isn't clustering and was never cancelled, like a fresh one,
+     because a cancelled clustering leaves the thread's exit flag set until the thread is started again.
+     The layout of the library grid is left untouched.
+     
+     @param numSamples the number of synthetic samples, at least minNumBenchmarkSamples.
+     @param numDimensions the number of dimensions in a feature vector.
+     @param seed the seed for the synthetic collection and the clustering.
+     
+     @returns the wall time, the number of checked swaps per second and the layout quality.
+     */
+    BenchmarkResult runBenchmark(int numSamples, int numDimensions, unsigned seed);
+    /**
+     Copies the most recently published grid into the given array.
+     
+     @param outGridSnapshot the array to copy the grid's sample items into, ordered by grid position.
+     
+     @returns false if no new snapshot was published since the last call or the clustering that published it was cancelled.
+     */
+    bool getGridSnapshot(Array<SampleItem*>& outGridSnapshot);
+    /**
+     @returns whether the last clustering ran to completion and its final grid was published.
+     */
+    bool getClusteringIsFinished();
     
 private:
     constexpr static float const initialRadiusFactor = 0.5; // Keep <= 0.5 to not waste time
@@ -52,32 +134,104 @@ private:
     constexpr static float const weightHole = 0.01;
     constexpr static float const weightTile = 1.0;
     constexpr static float const sampleFactor = 2.0; // How often all tiles in the swap area are swapped per radius reduction
+    constexpr static float const warmStartRadius = 3.0;
+    constexpr static float const warmStartRadiusFactor = 0.1;
+    constexpr static float const maxWarmStartChangeRatio = 0.2; // Share of added and removed samples up to which the last layout is reused
+    constexpr static float const prototypeProgressShare = 0.2;
+    constexpr static float const minSortingQuality = 0.2;
+    constexpr static float const qualityExponent = 16.0; // The p of DPQ_p, emphasises the closest neighbourhoods
+    constexpr static float const benchmarkClusterSpread = 0.05;
     static int const maxSwapPositions = 9;
+    static int const minHierarchicalGridSize = 4096; // Grids of this size are sorted coarse-to-fine
+    static int const minNumPrototypes = 256;
+    static int const maxNumPrototypes = 1024;
+    static int const minNumPrototypeIterations = 2;
+    static int const maxNumPrototypeIterations = 10;
+    static int const trainingSamplesPerPrototype = 16;
+    static int const maxNumQualityQueries = 256;
+    static int const benchmarkSamplesPerCluster = 50;
     int const numThreads;
     std::set<int> swapPositionsInUse;
     std::set<int> startIndicesInUse;
     CriticalSection mSwapLock;
-    OwnedArray<SampleItem>& sampleItems;
+    Array<SampleItem*> mGridItems;
+    Array<SampleItem*> mGridSnapshots[2];
+    // Keyed by file path, a freed sample item's address may be reused by a new one
+    std::map<String, int> mPreviousGridPositions;
+    CriticalSection mSnapshotLock;
     std::vector<float> mFeatureWeights;
     int rows;
     int columns;
     int numSwapPositions;
     bool applyWrap;
     bool featureWeightsChanged = true;
+    bool runInBackground = false;
+    bool warmStartIsEnabled = true;
+    float sortingQuality = 1.0;
+    unsigned randomSeed = 0;
+    uint64 clusteringSeed = 0;
+    RandomStream mRandom;
+    int64 numCheckedSwaps = 0;
+    int previousRows = 0;
+    int previousColumns = 0;
+    int frontSnapshotIndex = 0;
+    bool snapshotIsNew = false;
+    // The clustering run a published snapshot belongs to, runs are counted up when started or cancelled
+    int snapshotGeneration = 0;
+    std::atomic<int> clusteringGeneration { 0 };
+    std::atomic<bool> clusteringIsFinished { false };
+    std::atomic<bool> clusteringWasCancelled { false };
+    std::atomic<float> distancePreservationQuality { 0.0 };
     
     /**
      Runs the clustering of the sample items while setting the progress for the progress bar.
      */
     void run() override;
     void threadComplete(bool userPressedCancel) override;
+    /**
+     Copies the weighted features of the sample items to their feature vectors,
+     for all items if the feature weights changed and otherwise only for newly added items.
+     */
+    void updateFeatureVectors();
+    /**
+     Seeds the working grid and sorts it, from prototypes on large grids.
+     
+     @param startTime the start time of the clustering.
+     @param allowWarmStart whether the grid may be seeded from the last finished layout.
+     */
+    void clusterGridItems(int64 startTime, bool allowWarmStart);
+    /**
+     Sorts the given grid with shrinking filter radii, starting at the given radius.
+     
+     @param inGridItems the items of the grid to sort.
+     @param inRows the number of rows in the grid.
+     @param inColumns the number of columns in the grid.
+     @param inRadius the initial filter radius.
+     @param progressStart the progress at the start of the sorting.
+     @param progressEnd the progress at the end of the sorting.
+     @param startTime the start time of the clustering.
+     @param publishSnapshots whether to publish a grid snapshot after every radius reduction.
+     */
+    void sortGrid(Array<SampleItem*>& inGridItems,
+                  int inRows,
+                  int inColumns,
+                  float inRadius,
+                  double progressStart,
+                  double progressEnd,
+                  int64 startTime,
+                  bool publishSnapshots);
     /**
      Copies the feature vectors from the sample item collection to the grid and multiplies each dimension with a weight.
      
+     @param inGridItems the items of the grid.
      @param grid the grid of vectors to cluster.
      @param numDimensions the number of dimensions in a feature vector.
      @param weights the weights for the grid positions.
      */
-    void copyFeatureVectorsToGrid(std::vector<std::vector<float>>& grid, int numDimensions, std::vector<float>& weights);
+    void copyFeatureVectorsToGrid(Array<SampleItem*>& inGridItems,
+                                  std::vector<std::vector<float>>& grid,
+                                  int numDimensions,
+                                  std::vector<float>& weights);
     /**
      Filters the grid's vectors horizontally with a low-pass filter, wrapping the grid around the edges.
      
@@ -202,12 +356,17 @@ private:
      Defines an area with the given radius, and checks random swaps within that area around a random sample for optimal relative distances.
      When the optimal permutation is found, the swapping of those positions is performed.
      
+     @param inGridItems the items of the grid.
      @param radius the radius that defines the swap area.
      @param grid the grid of vectors to cluster.
      @param rows the number of rows in the grid.
      @param columns the number of columns in the grid.
      */
-    void checkRandomSwaps(int radius, std::vector<std::vector<float>>& grid, int rows, int columns);
+    void checkRandomSwaps(Array<SampleItem*>& inGridItems,
+                          int radius,
+                          std::vector<std::vector<float>>& grid,
+                          int rows,
+                          int columns);
     /**
      Calculates the radius decay dependent on the current radius.
      
@@ -215,6 +374,73 @@ private:
      @returns the new radius decay.
      */
     float getRadiusDecay(float inRadius);
+    /**
+     Arranges the working grid according to the last finished layout.
+     
+     @returns false if there is no last layout or the collection changed too much, leaving the working grid untouched.
+     */
+    bool seedGridFromPreviousLayout();
+    /**
+     Finds the free grid position closest to the given coordinates.
+     
+     @param inSeededGrid the grid that is being seeded, with free positions set to nullptr.
+     @param x the column to start the search at.
+     @param y the row to start the search at.
+     
+     @returns the index of the closest free position.
+     */
+    int findNearestFreePosition(std::vector<SampleItem*>& inSeededGrid, int x, int y);
+    /**
+     Remembers the grid position of each sample in the finished layout, to seed the next clustering with it.
+     */
+    void storeGridLayout();
+    /**
+     Arranges the working grid in blocks by sorting prototypes of the collection on a coarse grid
+     and filling each block with the samples closest to its prototype.
+     
+     @param startTime the start time of the clustering.
+     
+     @returns the size of the blocks, or 0 if the grid was left untouched.
+     */
+    int seedGridFromPrototypes(int64 startTime);
+    /**
+     Finds prototypes of the collection with k-means clustering on a random subset of the samples.
+     
+     @param inFeatures the feature vectors of the samples, one after another.
+     @param numSamples the number of samples.
+     @param numDimensions the number of dimensions in a feature vector.
+     @param numPrototypes the number of prototypes to find.
+     
+     @returns the prototype vectors, one after another.
+     */
+    std::vector<float> calculatePrototypes(std::vector<float>& inFeatures, int numSamples, int numDimensions, int numPrototypes);
+    /**
+     Finds the prototype closest to the given feature vector.
+     
+     @param inFeature the feature vector.
+     @param inPrototypes the prototype vectors, one after another.
+     @param numDimensions the number of dimensions in a feature vector.
+     @param inFreeCapacities if not empty, prototypes without free capacity are skipped.
+     @param outDistance the squared distance to the closest prototype.
+     
+     @returns the index of the closest prototype.
+     */
+    int findNearestPrototype(float const * inFeature,
+                             std::vector<float> const & inPrototypes,
+                             int numDimensions,
+                             std::vector<int> const & inFreeCapacities,
+                             float& outDistance);
+    /**
+     Calculates the Distance Preservation Quality DPQ_p of the working grid as defined by Barthel et al.,
+     comparing the mean feature distances of the k closest grid neighbours with those of the k closest samples.
+     
+     @returns the quality between 0.0 (random) and 1.0 (optimal).
+     */
+    float calculateDistancePreservationQuality();
+    /**
+     Copies the current working grid into the back snapshot buffer and swaps it to the front.
+     */
+    void publishGridSnapshot();
     /**
      Sets the threads progress bar and status message.
      */
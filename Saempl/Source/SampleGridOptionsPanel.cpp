@@ -293,4 +293,73 @@ void SampleGridOptionsPanel::setPanelComponents()
     mChromaDistributionLabel->attachToComponent(&*mChromaDistributionSlider, true);
     addAndMakeVisible(*mChromaDistributionLabel);
     y += style->PANEL_TITLE_HEIGHT * 0.5 + style->PANEL_MARGIN;
+    
+    // Adds background clustering toggle
+    mClusterInBackgroundButton = std::make_unique<ToggleButton>("ClusterInBackgroundButton");
+    mClusterInBackgroundButton->setBounds(style->PANEL_MARGIN + labelWidth,
+                                          y,
+                                          style->PANEL_TITLE_HEIGHT * 0.5,
+                                          style->PANEL_TITLE_HEIGHT * 0.5);
+    mClusterInBackgroundButton->setToggleState(currentProcessor.getClusterGridInBackground(), NotificationType::dontSendNotification);
+    mClusterInBackgroundButton->setTooltip("Keep browsing while the grid is clustered, instead of waiting for the progress window");
+    mClusterInBackgroundButton->onClick = [this]
+    {
+        currentProcessor.setClusterGridInBackground(mClusterInBackgroundButton->getToggleState());
+    };
+    addAndMakeVisible(*mClusterInBackgroundButton);
+    mClusterInBackgroundLabel = std::make_unique<Label>(String(), "Cluster in Background:");
+    mClusterInBackgroundLabel->attachToComponent(&*mClusterInBackgroundButton, true);
+    addAndMakeVisible(*mClusterInBackgroundLabel);
+    y += style->PANEL_TITLE_HEIGHT * 0.5 + style->PANEL_MARGIN;
+    
+    // Adds warm start toggle
+    mWarmStartButton = std::make_unique<ToggleButton>("WarmStartButton");
+    mWarmStartButton->setBounds(style->PANEL_MARGIN + labelWidth,
+                                y,
+                                style->PANEL_TITLE_HEIGHT * 0.5,
+                                style->PANEL_TITLE_HEIGHT * 0.5);
+    mWarmStartButton->setToggleState(currentProcessor.getGridWarmStartIsEnabled(), NotificationType::dontSendNotification);
+    mWarmStartButton->setTooltip("Start from the current layout when only a few samples were added or removed");
+    mWarmStartButton->onClick = [this]
+    {
+        currentProcessor.setGridWarmStartIsEnabled(mWarmStartButton->getToggleState());
+    };
+    addAndMakeVisible(*mWarmStartButton);
+    mWarmStartLabel = std::make_unique<Label>(String(), "Incremental Update:");
+    mWarmStartLabel->attachToComponent(&*mWarmStartButton, true);
+    addAndMakeVisible(*mWarmStartLabel);
+    y += style->PANEL_TITLE_HEIGHT * 0.5 + style->PANEL_MARGIN;
+    
+    // Adds sorting quality slider
+    mSortingQualitySlider = std::make_unique<Slider>(Slider::LinearHorizontal, Slider::TextBoxLeft);
+    mSortingQualitySlider->setBounds(style->PANEL_MARGIN + labelWidth,
+                                     y,
+                                     getWidth() - style->PANEL_MARGIN * 2.0 - labelWidth,
+                                     style->PANEL_TITLE_HEIGHT * 0.5);
+    mSortingQualitySlider->setTextBoxStyle(Slider::TextBoxLeft, false, textBoxWidth, style->PANEL_TITLE_HEIGHT * 0.5);
+    mSortingQualitySlider->setRange(0.2, 1.0, 0.1);
+    mSortingQualitySlider->setDoubleClickReturnValue(true, 1.0);
+    mSortingQualitySlider->setValue(currentProcessor.getGridSortingQuality(), NotificationType::dontSendNotification);
+    mSortingQualitySlider->setTooltip("Lower values sort large grids faster but less accurately");
+    mSortingQualitySlider->onValueChange = [this]
+    {
+        currentProcessor.setGridSortingQuality(mSortingQualitySlider->getValue());
+    };
+    addAndMakeVisible(*mSortingQualitySlider);
+    mSortingQualityLabel = std::make_unique<Label>(String(), "Sorting Quality:");
+    mSortingQualityLabel->attachToComponent(&*mSortingQualitySlider, true);
+    addAndMakeVisible(*mSortingQualityLabel);
+    y += style->PANEL_TITLE_HEIGHT * 0.5 + style->PANEL_MARGIN;
+    
+    // Adds layout quality of the current grid
+    mLayoutQualityLabel = std::make_unique<Label>(String(),
+                                                  "Layout Quality (DPQ): "
+                                                  + String(currentProcessor.getGridLayoutQuality(), 2));
+    mLayoutQualityLabel->setBounds(style->PANEL_MARGIN,
+                                   y,
+                                   getWidth() - style->PANEL_MARGIN * 2.0,
+                                   style->PANEL_TITLE_HEIGHT * 0.5);
+    mLayoutQualityLabel->setTooltip("How well the grid keeps similar samples next to each other, 1.0 is optimal");
+    addAndMakeVisible(*mLayoutQualityLabel);
+    y += style->PANEL_TITLE_HEIGHT * 0.5 + style->PANEL_MARGIN;
 }
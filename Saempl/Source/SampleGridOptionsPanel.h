@@ -51,6 +51,13 @@ private:
     std::unique_ptr<Label> mSpectralDistributionLabel;
     std::unique_ptr<Slider> mChromaDistributionSlider;
     std::unique_ptr<Label> mChromaDistributionLabel;
+    std::unique_ptr<ToggleButton> mClusterInBackgroundButton;
+    std::unique_ptr<Label> mClusterInBackgroundLabel;
+    std::unique_ptr<ToggleButton> mWarmStartButton;
+    std::unique_ptr<Label> mWarmStartLabel;
+    std::unique_ptr<Slider> mSortingQualitySlider;
+    std::unique_ptr<Label> mSortingQualityLabel;
+    std::unique_ptr<Label> mLayoutQualityLabel;
     static int const labelWidth = 115;
     static int const introTextHeight = 70;
     
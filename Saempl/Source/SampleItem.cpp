@@ -15,6 +15,8 @@ SampleItem::SampleItem()
     mCurrentFilePath = EMPTY_TILE_PATH;
     mKey = NO_KEY_INDEX;
     mTempo = 0;
+    mPeakLevel = 0.0;
+    mAnalysisRevision = 0;
     mFeatureVector = std::vector<float>(NUM_CHROMA + NUM_SPECTRAL_BANDS + NUM_FEATURES);
     mSpectralDistribution = std::vector<float>(NUM_SPECTRAL_BANDS);
     mChromaDistribution = std::vector<float>(NUM_CHROMA);
@@ -204,6 +206,16 @@ void SampleItem::setSampleRate(int inSampleRate)
     mSampleRate = inSampleRate;
 }
 
+float SampleItem::getPeakLevel() const
+{
+    return mPeakLevel;
+}
+
+void SampleItem::setPeakLevel(float inPeakLevel)
+{
+    mPeakLevel = inPeakLevel;
+}
+
 std::vector<float> SampleItem::getFeatureVector() const
 {
     return mFeatureVector;
@@ -213,3 +225,13 @@ void SampleItem::setFeatureVector(std::vector<float> inFeatureVector)
 {
     mFeatureVector = inFeatureVector;
 }
+
+int SampleItem::getAnalysisRevision() const
+{
+    return mAnalysisRevision;
+}
+
+void SampleItem::increaseAnalysisRevision()
+{
+    mAnalysisRevision++;
+}
@@ -178,6 +178,16 @@ public:
      @param inSampleRate the key to set.
      */
     void setSampleRate(int inSampleRate);
+    /**
+     @returns the sample's peak level from 0.0 to 1.0, or 0.0 if it wasn't analysed yet.
+     */
+    float getPeakLevel() const;
+    /**
+     Sets the peak level of the sample item.
+     
+     @param inPeakLevel the peak level to set.
+     */
+    void setPeakLevel(float inPeakLevel);
     /**
      @returns the sample's spectral distribution.
      */
@@ -208,6 +218,14 @@ public:
      @param inFeatureVector the vector to set.
      */
     void setFeatureVector(std::vector<float> inFeatureVector);
+    /**
+     @returns how often the sample was analysed, so views can tell that their formatted values are outdated.
+     */
+    int getAnalysisRevision() const;
+    /**
+     Marks the analysed properties of the sample item as changed.
+     */
+    void increaseAnalysisRevision();
     
 private:
     String mCurrentFilePath;
@@ -223,9 +241,11 @@ private:
     float mSpectralRolloff;
     float mSpectralFlux;
     float mChromaFlux;
+    float mPeakLevel;
     int mSampleRate;
     int mTempo;
     int mKey;
+    int mAnalysisRevision;
     std::vector<float> mSpectralDistribution;
     std::vector<float> mChromaDistribution;
     std::vector<float> mFeatureVector;
@@ -11,7 +11,8 @@
 
 SampleItemComparator::SampleItemComparator()
 {
-    
+    mComparePropertyIndex = -1;
+    mIsForwards = true;
 }
 
 SampleItemComparator::~SampleItemComparator()
@@ -21,60 +22,147 @@ SampleItemComparator::~SampleItemComparator()
 
 int SampleItemComparator::compareElements(SampleItem* first, SampleItem* second)
 {
-    if (mComparePropertyName == PROPERTY_NAMES[0])
-    {
-        return compareElements<String>(first->getTitle(), second->getTitle());
-    }
-    else if (mComparePropertyName == PROPERTY_NAMES[1])
-    {
-        return compareElements<float>(first->getLength(), second->getLength());
-    }
-    else if (mComparePropertyName == PROPERTY_NAMES[2])
-    {
-        return compareElements<float>(first->getLoudnessDecibel(), second->getLoudnessDecibel());
-    }
-    else if (mComparePropertyName == PROPERTY_NAMES[3])
+    switch (mComparePropertyIndex)
     {
-        return compareElements<float>(first->getLoudnessLUFS(), second->getLoudnessLUFS());
+        case 0:
+            return compareElements<String>(first->getTitle(), second->getTitle());
+        case 1:
+            return compareElements<float>(first->getLength(), second->getLength());
+        case 2:
+            return compareElements<float>(first->getLoudnessDecibel(), second->getLoudnessDecibel());
+        case 3:
+            return compareElements<float>(first->getLoudnessLUFS(), second->getLoudnessLUFS());
+        case 4:
+            return compareElements<int>(first->getTempo(), second->getTempo());
+        case 5:
+            return compareElements<int>(first->getKey(), second->getKey());
+        case 6:
+            return compareElements<float>(first->getDynamicRange(), second->getDynamicRange());
+        case 7:
+            return compareElements<float>(first->getSpectralCentroid(), second->getSpectralCentroid());
+        case 8:
+            return compareElements<float>(first->getSpectralRolloff(), second->getSpectralRolloff());
+        case 9:
+            return compareElements<float>(first->getSpectralSpread(), second->getSpectralSpread());
+        case 10:
+            return compareElements<float>(first->getSpectralFlux(), second->getSpectralFlux());
+        case 11:
+            return compareElements<float>(first->getChromaFlux(), second->getChromaFlux());
+        case 12:
+            return compareElements<float>(first->getZeroCrossingRate(), second->getZeroCrossingRate());
+        default:
+            return 0;
     }
-    else if (mComparePropertyName == PROPERTY_NAMES[4])
-    {
-        return compareElements<int>(first->getTempo(), second->getTempo());
-    }
-    else if (mComparePropertyName == PROPERTY_NAMES[5])
+}
+
+void SampleItemComparator::sortSampleItems(OwnedArray<SampleItem>& inSampleItems)
+{
+    int numItems = inSampleItems.size();
+    
+    if (mComparePropertyIndex < 0 || numItems < 2)
     {
-        return compareElements<int>(first->getKey(), second->getKey());
+        return;
     }
-    else if (mComparePropertyName == PROPERTY_NAMES[6])
+    
+    SampleItem** sampleItems = inSampleItems.getRawDataPointer();
+    std::vector<int> sortedIndices;
+    
+    // Extract the sort keys once and sort them together with the item indices
+    if (mComparePropertyIndex == 0)
     {
-        return compareElements<float>(first->getDynamicRange(), second->getDynamicRange());
+        // UTF-8 byte order matches the code point order String uses to compare titles
+        std::vector<std::pair<std::string, int>> sortKeys;
+        sortKeys.reserve(numItems);
+        
+        for (int i = 0; i < numItems; i++)
+        {
+            sortKeys.emplace_back(sampleItems[i]->getTitle().toStdString(), i);
+        }
+        
+        sortedIndices = sortByKeys(sortKeys);
     }
-    else if (mComparePropertyName == PROPERTY_NAMES[7])
+    else
     {
-        return compareElements<float>(first->getSpectralCentroid(), second->getSpectralCentroid());
+        std::vector<std::pair<float, int>> sortKeys;
+        sortKeys.reserve(numItems);
+        
+        for (int i = 0; i < numItems; i++)
+        {
+            sortKeys.emplace_back(getNumericSortKey(sampleItems[i]), i);
+        }
+        
+        sortedIndices = sortByKeys(sortKeys);
     }
-    else if (mComparePropertyName == PROPERTY_NAMES[8])
+    
+    // Apply the sorted permutation to the item pointers
+    Array<SampleItem*> unsortedItems(sampleItems, numItems);
+    
+    for (int i = 0; i < numItems; i++)
     {
-        return compareElements<float>(first->getSpectralRolloff(), second->getSpectralRolloff());
+        sampleItems[i] = unsortedItems.getUnchecked(sortedIndices[i]);
     }
-    else if (mComparePropertyName == PROPERTY_NAMES[9])
+}
+
+float SampleItemComparator::getNumericSortKey(SampleItem* inSampleItem)
+{
+    switch (mComparePropertyIndex)
     {
-        return compareElements<float>(first->getSpectralSpread(), second->getSpectralSpread());
+        case 1:
+            return inSampleItem->getLength();
+        case 2:
+            return inSampleItem->getLoudnessDecibel();
+        case 3:
+            return inSampleItem->getLoudnessLUFS();
+        case 4:
+            return inSampleItem->getTempo();
+        case 5:
+            return inSampleItem->getKey();
+        case 6:
+            return inSampleItem->getDynamicRange();
+        case 7:
+            return inSampleItem->getSpectralCentroid();
+        case 8:
+            return inSampleItem->getSpectralRolloff();
+        case 9:
+            return inSampleItem->getSpectralSpread();
+        case 10:
+            return inSampleItem->getSpectralFlux();
+        case 11:
+            return inSampleItem->getChromaFlux();
+        case 12:
+            return inSampleItem->getZeroCrossingRate();
+        default:
+            return 0.0;
     }
-    else if (mComparePropertyName == PROPERTY_NAMES[10])
+}
+
+template <typename K> std::vector<int> SampleItemComparator::sortByKeys(std::vector<std::pair<K, int>>& inSortKeys)
+{
+    // Equal keys keep their current order in both directions
+    if (mIsForwards)
     {
-        return compareElements<float>(first->getSpectralFlux(), second->getSpectralFlux());
+        std::stable_sort(inSortKeys.begin(), inSortKeys.end(), [](auto const & a, auto const & b)
+        {
+            return a.first < b.first;
+        });
     }
-    else if (mComparePropertyName == PROPERTY_NAMES[11])
+    else
     {
-        return compareElements<float>(first->getChromaFlux(), second->getChromaFlux());
+        std::stable_sort(inSortKeys.begin(), inSortKeys.end(), [](auto const & a, auto const & b)
+        {
+            return b.first < a.first;
+        });
     }
-    else if (mComparePropertyName == PROPERTY_NAMES[12])
+    
+    std::vector<int> sortedIndices;
+    sortedIndices.reserve(inSortKeys.size());
+    
+    for (auto const & sortKey : inSortKeys)
     {
-        return compareElements<float>(first->getZeroCrossingRate(), second->getZeroCrossingRate());
+        sortedIndices.push_back(sortKey.second);
     }
     
-    return 0;
+    return sortedIndices;
 }
 
 template <typename T> int SampleItemComparator::compareElements(T first, T second)
@@ -91,7 +179,7 @@ template <typename T> int SampleItemComparator::compareElements(T first, T secon
 
 void SampleItemComparator::setCompareProperty(String inProperty)
 {
-    mComparePropertyName = inProperty;
+    mComparePropertyIndex = PROPERTY_NAMES.indexOf(inProperty);
 }
 
 void SampleItemComparator::setSortingDirection(bool inIsForwards)
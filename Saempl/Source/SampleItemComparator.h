@@ -43,11 +43,34 @@ public:
      @param isForwards the sorting direction to set.
      */
     void setSortingDirection(bool isForwards);
+    /**
+     Sorts the sample items by the set property and sorting direction.
+     
+     The sort keys are extracted once per item, so no property lookups happen during the comparisons.
+     
+     @param inSampleItems the sample item collection to sort in place.
+     */
+    void sortSampleItems(OwnedArray<SampleItem>& inSampleItems);
     
 private:
-    String mComparePropertyName;
+    int mComparePropertyIndex;
     bool mIsForwards;
     
+    /**
+     @param inSampleItem the sample item to get the sort key for.
+     
+     @returns the value of the set numeric property of the sample item.
+     */
+    float getNumericSortKey(SampleItem* inSampleItem);
+    /**
+     Sorts the extracted keys by the sorting direction.
+     
+     @param inSortKeys pairs of sort key and item index.
+     
+     @returns the item indices in sorted order.
+     */
+    template <typename K> std::vector<int> sortByKeys(std::vector<std::pair<K, int>>& inSortKeys);
+    
     /**
      @see compareElements()
      */
@@ -38,9 +38,10 @@ void SampleItemPanel::paint(Graphics& g)
 void SampleItemPanel::setPanelComponents()
 {
     // Add audio player component
-    mAudioPlayer = std::make_unique<AudioPlayer>();
+    mAudioPlayer = std::make_unique<AudioPlayer>(currentProcessor.getPreviewVoice(PREVIEW_VOICE_SAMPLE_ITEM));
     mAudioPlayer->selectOutputDevice(currentProcessor.getOutputDevice());
     mAudioPlayer->setVolumeIsNormalised(currentProcessor.getVolumeIsNormalised());
+    mAudioPlayer->setAttackCacheBudget((size_t) currentProcessor.getPreviewCacheSize() * 1024 * 1024);
     
     int followTransportButtonHeight = 34;
     
@@ -219,3 +220,18 @@ void SampleItemPanel::selectOutputDevice(String inDeviceName)
 {
     mAudioPlayer->selectOutputDevice(inDeviceName);
 }
+
+void SampleItemPanel::setPreviewCacheSize(int inPreviewCacheSize)
+{
+    mAudioPlayer->setAttackCacheBudget((size_t) inPreviewCacheSize * 1024 * 1024);
+}
+
+int SampleItemPanel::getNumPreviewCacheHits()
+{
+    return mAudioPlayer->getNumAttackCacheHits();
+}
+
+int SampleItemPanel::getNumPreviewCacheMisses()
+{
+    return mAudioPlayer->getNumAttackCacheMisses();
+}
@@ -61,6 +61,20 @@ public:
      Selects an output device for the audio player object.
      */
     void selectOutputDevice(String inDeviceName);
+    /**
+     Sets the memory the audio player may use for the attacks of recently previewed samples.
+     
+     @param inPreviewCacheSize the size in megabytes.
+     */
+    void setPreviewCacheSize(int inPreviewCacheSize);
+    /**
+     @returns how many previews were started from a cached sample attack.
+     */
+    int getNumPreviewCacheHits();
+    /**
+     @returns how many previews had to decode their sample attack from disk.
+     */
+    int getNumPreviewCacheMisses();
     
 private:
     SampleLibrary& sampleLibrary;
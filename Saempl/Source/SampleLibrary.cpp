@@ -13,6 +13,8 @@ SampleLibrary::SampleLibrary()
 {
     mLibraryWasLoaded = false;
     mLibraryWasAltered = false;
+    mPathIndexIsUpToDate = false;
+    mPropertyIndexes.resize(PROPERTY_NAMES.size());
     
     // Initialise library manager
     mSampleLibraryManager = std::make_unique<SampleLibraryManager>(mAllSampleItems,
@@ -21,13 +23,14 @@ SampleLibrary::SampleLibrary()
                                                                    mAddedSampleItems,
                                                                    mAlteredSampleItems);
     mSampleLibraryManager->addChangeListener(this);
+    mSampleLibraryManager->getAnalysisBroadcaster().addChangeListener(this);
     
     // Create thread for scanning the sample library directory
     mDirectoryScannerThread = std::make_unique<TimeSliceThread>("DirectoryScannerThread");
     mDirectoryScannerThread->startThread(Thread::Priority::normal);
     
     // Set file filter
-    mFileFilter = std::make_unique<SampleFileFilter>("AudioFormatsFilter", mFilteredSampleItems);
+    mFileFilter = std::make_unique<SampleFileFilter>("AudioFormatsFilter");
     mDirectoryContentsList = std::make_unique<DirectoryContentsList>(&*mFileFilter, *mDirectoryScannerThread);
     mDirectoryContentsList->addChangeListener(this);
 }
@@ -35,6 +38,7 @@ SampleLibrary::SampleLibrary()
 SampleLibrary::~SampleLibrary()
 {
     mSampleLibraryManager->removeChangeListener(this);
+    mSampleLibraryManager->getAnalysisBroadcaster().removeChangeListener(this);
     mDirectoryContentsList->removeChangeListener(this);
     
     if (mLibraryWasAltered)
@@ -200,10 +204,18 @@ void SampleLibrary::changeListenerCallback(ChangeBroadcaster* inSource)
         
         mRestoredFavouritesPaths.clear();
         
-        // Refresh library
+        // Refresh library and index the titles for searching
+        invalidateFilterIndexes();
+        mFileFilter->buildTitleIndex(mAllSampleItems, mTitleIndex);
         mLibraryWasLoaded = true;
         refreshLibrary();
     }
+    else if (inSource == &mSampleLibraryManager->getAnalysisBroadcaster())
+    {
+        // The indexes were built from the values before the analysis
+        invalidatePropertyIndexes();
+        applyFilter();
+    }
 }
 
 void SampleLibrary::synchWithLibraryDirectory()
@@ -221,7 +233,9 @@ void SampleLibrary::clearSampleItemCollections()
     mFavouritesSampleItems.clear(false);
     mFilteredSampleItems.clear(false);
     mFilteredFilePaths.clear();
+    mFileFilter->setFilteredFilePaths(mFilteredFilePaths);
     mAllSampleItems.clear();
+    invalidateFilterIndexes();
     sendSynchronousChangeMessage();
 }
 
@@ -230,15 +244,17 @@ void SampleLibrary::applyFilter()
     mFilteredSampleItems.clear(false);
     mFilteredFilePaths.clear();
     
-    for (SampleItem* sampleItem : mAllSampleItems)
+    std::vector<int> matchingIndices = mFileFilter->matchRules(mAllSampleItems, mPropertyIndexes, mTitleIndex);
+    mFilteredSampleItems.ensureStorageAllocated((int) matchingIndices.size());
+    
+    for (int itemIndex : matchingIndices)
     {
-        if (mFileFilter->matchesRules(*sampleItem))
-        {
-            mFilteredSampleItems.add(sampleItem);
-            mFilteredFilePaths.add(sampleItem->getCurrentFilePath());
-        }
+        SampleItem* sampleItem = mAllSampleItems.getUnchecked(itemIndex);
+        mFilteredSampleItems.add(sampleItem);
+        mFilteredFilePaths.add(sampleItem->getCurrentFilePath());
     }
     
+    mFileFilter->setFilteredFilePaths(mFilteredFilePaths);
     sendSynchronousChangeMessage();
 }
 
@@ -304,6 +320,21 @@ SampleItem* SampleLibrary::addToSampleItems(File const & inFile)
     SampleItem* addedItem = mSampleLibraryManager->createSampleItem(newFile);
     mAddedSampleItems.add(addedItem);
     
+    // The indexes need a rank for the new item, its analysed values invalidate them again once they are written
+    invalidatePropertyIndexes();
+    
+    // New items are appended, so their title can be added to an up to date index
+    if (mTitleIndex.isUpToDate && mTitleIndex.numIndexedItems == mAllSampleItems.size() - 1)
+    {
+        mFileFilter->addToTitleIndex(mAllSampleItems.size() - 1, addedItem->getTitle(), mTitleIndex);
+        mTitleIndex.numIndexedItems++;
+    }
+    
+    if (mPathIndexIsUpToDate)
+    {
+        mPathIndex[getPathIndexKey(addedItem->getCurrentFilePath())] = addedItem;
+    }
+    
     return addedItem;
 }
 
@@ -333,7 +364,7 @@ bool SampleLibrary::addFileToFavourites(File const & inFile)
 
 bool SampleLibrary::addToFavourites(File const & inFile)
 {
-    SampleItem* itemToAdd = mSampleLibraryManager->getSampleItemWithFilePath(inFile.getFullPathName());
+    SampleItem* itemToAdd = getSampleItemWithFilePath(inFile.getFullPathName());
     
     // Create item if it doesn't yet exist
     if (itemToAdd == nullptr)
@@ -357,12 +388,13 @@ void SampleLibrary::removeSampleItem(String const & inFilePath, bool deletePerma
     File fileToDelete = File(inFilePath);
     
     // Delete sample item
-    SampleItem* itemToDelete = mSampleLibraryManager->getSampleItemWithFilePath(fileToDelete.getFullPathName());
+    SampleItem* itemToDelete = getSampleItemWithFilePath(fileToDelete.getFullPathName());
     mDeletedSampleItems.add(itemToDelete);
     removeFromFavourites(*itemToDelete);
     mAlteredSampleItems.removeObject(itemToDelete, false);
     mAddedSampleItems.removeObject(itemToDelete, false);
     mAllSampleItems.removeObject(itemToDelete, false);
+    invalidateFilterIndexes();
     
     // Delete audio file
     if (fileToDelete.exists())
@@ -392,7 +424,7 @@ void SampleLibrary::reanalyseSampleItem(File const & inFile)
     }
     else
     {
-        SampleItem* itemToReanalyse = mSampleLibraryManager->getSampleItemWithFilePath(inFile.getFullPathName());
+        SampleItem* itemToReanalyse = getSampleItemWithFilePath(inFile.getFullPathName());
         mSampleLibraryManager->analyseSampleItem(itemToReanalyse, inFile, true);
         mAlteredSampleItems.add(itemToReanalyse);
         mLibraryWasAltered = true;
@@ -409,9 +441,59 @@ void SampleLibrary::setRestoredFavouritesPaths(StringArray inRestoredFavouritesP
     mRestoredFavouritesPaths = inRestoredFavouritesPaths;
 }
 
+StringArray SampleLibrary::getFavouritesPaths()
+{
+    StringArray favouritesPaths = mRestoredFavouritesPaths;
+    favouritesPaths.ensureStorageAllocated(favouritesPaths.size() + mFavouritesSampleItems.size());
+    
+    // Look the paths up in a hash set instead of searching the array for every favourite
+    std::unordered_set<String> addedPaths(mRestoredFavouritesPaths.begin(), mRestoredFavouritesPaths.end());
+    
+    for (SampleItem* sampleItem : mFavouritesSampleItems)
+    {
+        String filePath = sampleItem->getCurrentFilePath();
+        
+        if (addedPaths.insert(filePath).second)
+        {
+            favouritesPaths.add(filePath);
+        }
+    }
+    
+    return favouritesPaths;
+}
+
+SampleItem* SampleLibrary::getSampleItemWithFilePath(String const & inFilePath)
+{
+    if (!mPathIndexIsUpToDate)
+    {
+        mPathIndex.clear();
+        mPathIndex.reserve(mAllSampleItems.size());
+        
+        for (SampleItem* sampleItem : mAllSampleItems)
+        {
+            mPathIndex.emplace(getPathIndexKey(sampleItem->getCurrentFilePath()), sampleItem);
+        }
+        
+        mPathIndexIsUpToDate = true;
+    }
+    
+    auto entry = mPathIndex.find(getPathIndexKey(inFilePath));
+    
+    return entry == mPathIndex.end() ? nullptr : entry->second;
+}
+
+String SampleLibrary::getPathIndexKey(String const & inFilePath)
+{
+#if JUCE_MAC
+    return inFilePath.convertToPrecomposedUnicode();
+#else
+    return inFilePath;
+#endif
+}
+
 void SampleLibrary::renameSampleItem(String inOriginalPath, String inNewPath)
 {
-    SampleItem * sample = mSampleLibraryManager->getSampleItemWithFilePath(inOriginalPath);
+    SampleItem * sample = getSampleItemWithFilePath(inOriginalPath);
     String filePath = inNewPath;
     String sampleTitle = File(inNewPath).getFileNameWithoutExtension();
 #if JUCE_MAC
@@ -419,15 +501,53 @@ void SampleLibrary::renameSampleItem(String inOriginalPath, String inNewPath)
     sampleTitle = sampleTitle.convertToPrecomposedUnicode();
 #endif
     sample->setCurrentFilePath(filePath);
+    mPathIndex.erase(getPathIndexKey(inOriginalPath));
+    mPathIndex[getPathIndexKey(filePath)] = sample;
+    
+    // Re-index the renamed title in place
+    if (mTitleIndex.isUpToDate)
+    {
+        int itemIndex = mAllSampleItems.indexOf(sample);
+        mFileFilter->removeFromTitleIndex(itemIndex, sample->getTitle(), mTitleIndex);
+        mFileFilter->addToTitleIndex(itemIndex, sampleTitle, mTitleIndex);
+    }
+    
     sample->setTitle(sampleTitle);
     
     // Handle library state
     mAlteredSampleItems.add(sample);
     mLibraryWasAltered = true;
-    mDirectoryContentsList->refresh();
     
     if (mFileFilter->canHaveEffect())
     {
         applyFilter();
     }
+    else
+    {
+        // The item stays in the filtered collection, only its path changes
+        int filteredPathIndex = mFilteredFilePaths.indexOf(inOriginalPath);
+        
+        if (filteredPathIndex >= 0)
+        {
+            mFilteredFilePaths.set(filteredPathIndex, filePath);
+            mFileFilter->setFilteredFilePaths(mFilteredFilePaths);
+        }
+    }
+    
+    mDirectoryContentsList->refresh();
+}
+
+void SampleLibrary::invalidatePropertyIndexes()
+{
+    for (SortedPropertyIndex& propertyIndex : mPropertyIndexes)
+    {
+        propertyIndex.isUpToDate = false;
+    }
+}
+
+void SampleLibrary::invalidateFilterIndexes()
+{
+    invalidatePropertyIndexes();
+    mTitleIndex.isUpToDate = false;
+    mPathIndexIsUpToDate = false;
 }
@@ -15,6 +15,8 @@
 #include "SampleFileFilter.h"
 #include "SampleFileFilterRuleTitle.h"
 #include "SampleFileFilterRuleLength.h"
+#include <unordered_map>
+#include <unordered_set>
 
 /**
  Manages storage and handling of SampleItems.
@@ -105,10 +107,23 @@ public:
      Sets a collection of restored paths to add to the favourites after the library was loaded.
      */
     void setRestoredFavouritesPaths(StringArray inRestoredFavouritesPaths);
+    /**
+     @returns the file paths of all favourite samples, including restored ones the library has not loaded yet.
+     */
+    StringArray getFavouritesPaths();
     /**
      Renames a sample item.
      */
     void renameSampleItem(String inOriginalPath, String inNewPath);
+    /**
+     Looks up a sample in the library, e.g. to play it with its analysed properties.
+     Hashes the paths of all sample items once, so previews don't search the whole library.
+     
+     @param inFilePath the path of the sample file.
+     
+     @returns the sample item, or nullptr if the file is not in the library.
+     */
+    SampleItem* getSampleItemWithFilePath(String const & inFilePath);
     
 private:
     std::unique_ptr<TimeSliceThread> mDirectoryScannerThread;
@@ -125,6 +140,11 @@ private:
     StringArray mRestoredFavouritesPaths;
     String mDirectoryPathToAddFilesTo;
     std::unique_ptr<SampleLibraryManager> mSampleLibraryManager;
+    std::vector<SortedPropertyIndex> mPropertyIndexes;
+    TitleTrigramIndex mTitleIndex;
+    // The sample items by their precomposed file path, rebuilt on the first lookup after it was invalidated
+    std::unordered_map<String, SampleItem*> mPathIndex;
+    bool mPathIndexIsUpToDate;
     bool mLibraryWasLoaded;
     bool mLibraryWasAltered;
     
@@ -183,6 +203,20 @@ private:
      */
     void reanalyseSampleItem(File const & inFile);
     void changeListenerCallback(ChangeBroadcaster* inSource) override;
+    /**
+     Marks the sorted property indexes as outdated after sample items were added, removed or changed.
+     
+     The filter rebuilds an index the next time one of its rules needs it.
+     */
+    void invalidatePropertyIndexes();
+    /**
+     Marks the property indexes, the title index and the path index as outdated after sample items were removed or replaced.
+     */
+    void invalidateFilterIndexes();
+    /**
+     @returns the path of a sample file in the form the path index uses as key.
+     */
+    static String getPathIndexKey(String const & inFilePath);
     
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(SampleLibrary);
 };
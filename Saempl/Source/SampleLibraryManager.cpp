@@ -28,10 +28,16 @@ alteredSampleItems(inAlteredSampleItems)
 
 SampleLibraryManager::~SampleLibraryManager()
 {
-    
+    // The analysis jobs notify the analysis broadcaster, which is destroyed before the thread pool
+    removeAllJobs(true, 10000);
 }
 
 void SampleLibraryManager::updateSampleLibraryFiles()
+{
+    updateSampleLibraryFiles(std::map<String, DirectorySnapshot>());
+}
+
+void SampleLibraryManager::updateSampleLibraryFiles(std::map<String, DirectorySnapshot> const & inSynchronisedSnapshots)
 {
     setProgress(0.0);
     setStatusMessage("Removing duplicate sample references");
@@ -68,8 +74,28 @@ void SampleLibraryManager::updateSampleLibraryFiles()
         return;
     }
     
-    Array<File> allDirectories = File(libraryDirectory).findChildFiles(File::findDirectories, true);
-    allDirectories.add(File(libraryDirectory));
+    // The snapshots know every library directory, so the directory tree is only walked without them
+    Array<File> allDirectories;
+    
+    for (auto const & snapshot : mDirectorySnapshots)
+    {
+        allDirectories.add(File(snapshot.first));
+    }
+    
+    // A running synchronisation may have found directories that the last one didn't know yet
+    for (auto const & snapshot : inSynchronisedSnapshots)
+    {
+        if (mDirectorySnapshots.count(snapshot.first) == 0)
+        {
+            allDirectories.add(File(snapshot.first));
+        }
+    }
+    
+    if (allDirectories.isEmpty())
+    {
+        allDirectories = File(libraryDirectory).findChildFiles(File::findDirectories, true);
+        allDirectories.add(File(libraryDirectory));
+    }
     
     // Create library files directory if non existent
     File libraryFileDirectory(mLibraryFilesDirectoryPath);
@@ -86,6 +112,12 @@ void SampleLibraryManager::updateSampleLibraryFiles()
             break;
         }
         
+        // Directories that were removed since the last synchronisation keep their library file as before
+        if (!libraryFile.isDirectory())
+        {
+            continue;
+        }
+        
         // Check if library file exists
         File sampleLibraryFile = File(mLibraryFilesDirectoryPath
                                       + DIRECTORY_SEPARATOR
@@ -201,35 +233,81 @@ void SampleLibraryManager::run()
     // already exists in the sample item list, if not add it
     int64 startTime = Time::currentTimeMillis();
     setProgress(0.0);
-    setStatusMessage("Loading...");
-    Array<File> allSampleFiles = libraryDirectory.findChildFiles(File::findFiles,
-                                                                 true,
-                                                                 SUPPORTED_AUDIO_FORMATS_WILDCARD);
+    setStatusMessage("Looking for changed samples");
+    
+    // Without snapshots from an earlier synchronisation every sample file counts as created
+    bool isFullScan = mDirectorySnapshots.empty();
+    std::map<String, DirectorySnapshot> directorySnapshots;
+    StringArray createdFilePaths;
+    StringArray deletedFilePaths;
+    collectDirectoryChanges(directorySnapshots, createdFilePaths, deletedFilePaths);
+    Array<File> allSampleFiles;
     
-    // Shuffle files to make loading speed more even
-    unsigned seed = (unsigned) std::chrono::system_clock::now().time_since_epoch().count();
+    for (String const & filePath : createdFilePaths)
+    {
+        allSampleFiles.add(File(filePath));
+    }
+    
+    // Shuffle files to make loading speed more even,
+    // seeded by the library so every load visits the files in the same order
+    RandomStream random((uint64) libraryDirectory.getFullPathName().hashCode64());
     std::shuffle(allSampleFiles.getRawDataPointer(),
                  allSampleFiles.getRawDataPointer() + allSampleFiles.size(),
-                 std::default_random_engine(seed));
+                 random);
     
     // Go through all current sample items,
     // check if corresponding audio file still exists...
     setStatusMessage("Looking for deleted samples");
-    int si = 0;
-    for (SampleItem* sampleItem : allSampleItems)
+    
+    if (isFullScan)
     {
-        if (threadShouldExit())
+        int si = 0;
+        for (SampleItem* sampleItem : allSampleItems)
         {
-            break;
+            if (threadShouldExit())
+            {
+                break;
+            }
+            
+            if (!File(sampleItem->getCurrentFilePath()).exists())
+            {
+                deletedSampleItems.add(sampleItem);
+            }
+            
+            si++;
+            setProgress(si / (double) allSampleItems.size());
         }
+    }
+    else
+    {
+        // Only the files missing from changed directories have to be looked up,
+        // hashed once per synchronisation instead of searching all sample items for every path
+        std::unordered_map<String, SampleItem*> sampleItemsByPath;
+        std::unordered_set<SampleItem*> alreadyDeletedItems(deletedSampleItems.begin(), deletedSampleItems.end());
         
-        if (!File(sampleItem->getCurrentFilePath()).exists())
+        if (!deletedFilePaths.isEmpty())
         {
-            deletedSampleItems.add(sampleItem);
+            sampleItemsByPath.reserve(allSampleItems.size());
+            
+            for (SampleItem* sampleItem : allSampleItems)
+            {
+                sampleItemsByPath.emplace(sampleItem->getCurrentFilePath(), sampleItem);
+            }
         }
         
-        si++;
-        setProgress(si / (double) allSampleItems.size());
+        // Sample items store their paths precomposed, so only the snapshot paths need converting
+        for (String filePath : deletedFilePaths)
+        {
+#if JUCE_MAC
+            filePath = filePath.convertToPrecomposedUnicode();
+#endif
+            auto sampleItem = sampleItemsByPath.find(filePath);
+            
+            if (sampleItem != sampleItemsByPath.end() && alreadyDeletedItems.insert(sampleItem->second).second)
+            {
+                deletedSampleItems.add(sampleItem->second);
+            }
+        }
     }
     
     // ...and if not, delete sample item
@@ -250,8 +328,13 @@ void SampleLibraryManager::run()
     }
     
     // All files have already been loaded
-    if (addedFilePaths.size() == allSampleFiles.size())
+    if ((isFullScan && addedFilePaths.size() == allSampleFiles.size()) || (!isFullScan && allSampleFiles.isEmpty()))
     {
+        if (!threadShouldExit())
+        {
+            mDirectorySnapshots.swap(directorySnapshots);
+        }
+        
         setProgress(1.0);
         return;
     }
@@ -259,7 +342,7 @@ void SampleLibraryManager::run()
     // Go through all files in directory and add sample items
     // for all that are not yet loaded into the library
     bool isLoadingNewLibrary = allSampleItems.size() == 0;
-    int numItemsToProcess = jmax<int>(0, allSampleFiles.size() - allSampleItems.size());
+    int numItemsToProcess = isFullScan ? jmax<int>(0, allSampleFiles.size() - allSampleItems.size()) : allSampleFiles.size();
     numProcessedItems = 0;
     setProgress(0.0);
     
@@ -306,13 +389,113 @@ void SampleLibraryManager::run()
     
     if (deletedSampleItems.size() + addedSampleItems.size() != 0)
     {
-        updateSampleLibraryFiles();
+        updateSampleLibraryFiles(directorySnapshots);
+        
+        // Keep the waveforms of the analysed samples within the cache budget
+        SampleWaveform::evictCache();
     }
     
     if (threadShouldExit())
     {
         return;
     }
+    
+    // Only a completed synchronisation may skip the unchanged directories next time
+    mDirectorySnapshots.swap(directorySnapshots);
+}
+
+void SampleLibraryManager::collectDirectoryChanges(std::map<String, DirectorySnapshot>& outSnapshots,
+                                                   StringArray& outCreatedFilePaths,
+                                                   StringArray& outDeletedFilePaths)
+{
+    Array<File> directoriesToVisit;
+    directoriesToVisit.add(libraryDirectory);
+    
+    while (!directoriesToVisit.isEmpty())
+    {
+        if (threadShouldExit())
+        {
+            return;
+        }
+        
+        File directory = directoriesToVisit.removeAndReturn(directoriesToVisit.size() - 1);
+        String directoryPath = directory.getFullPathName();
+        Time modificationTime = directory.getLastModificationTime();
+        auto previousSnapshot = mDirectorySnapshots.find(directoryPath);
+        DirectorySnapshot& snapshot = outSnapshots[directoryPath];
+        
+        // Creating, deleting or renaming an entry changes the modification time of its directory
+        if (previousSnapshot != mDirectorySnapshots.end() && previousSnapshot->second.modificationTime == modificationTime)
+        {
+            snapshot = previousSnapshot->second;
+        }
+        else
+        {
+            snapshot.modificationTime = modificationTime;
+            
+            for (File const & child : directory.findChildFiles(File::findFilesAndDirectories, false))
+            {
+                if (child.isDirectory())
+                {
+                    snapshot.subdirectoryPaths.add(child.getFullPathName());
+                    continue;
+                }
+                
+                if (child.hasFileExtension(SUPPORTED_AUDIO_FORMATS_EXTENSIONS))
+                {
+                    String filePath = child.getFullPathName();
+#if JUCE_MAC
+                    filePath = filePath.convertToPrecomposedUnicode();
+#endif
+                    snapshot.filePaths.add(filePath);
+                }
+            }
+            
+            // Compare the directory's files to the last synchronisation by merging both sorted lists
+            snapshot.filePaths.sort(false);
+            StringArray const emptyFilePaths;
+            StringArray const & previousFilePaths = previousSnapshot != mDirectorySnapshots.end()
+            ? previousSnapshot->second.filePaths
+            : emptyFilePaths;
+            int p = 0;
+            int c = 0;
+            
+            while (p < previousFilePaths.size() || c < snapshot.filePaths.size())
+            {
+                int comparison = p == previousFilePaths.size() ? 1
+                : c == snapshot.filePaths.size() ? -1
+                : previousFilePaths[p].compare(snapshot.filePaths[c]);
+                
+                if (comparison < 0)
+                {
+                    outDeletedFilePaths.add(previousFilePaths[p++]);
+                }
+                else if (comparison > 0)
+                {
+                    outCreatedFilePaths.add(snapshot.filePaths[c++]);
+                }
+                else
+                {
+                    p++;
+                    c++;
+                }
+            }
+        }
+        
+        for (String const & subdirectoryPath : snapshot.subdirectoryPaths)
+        {
+            directoriesToVisit.add(File(subdirectoryPath));
+        }
+    }
+    
+    // All files of directories that were removed are deleted
+    for (auto const & previousSnapshot : mDirectorySnapshots)
+    {
+        if (outSnapshots.count(previousSnapshot.first) == 0)
+        {
+            outDeletedFilePaths.addArray(previousSnapshot.second.filePaths);
+        }
+    }
 }
 
 void SampleLibraryManager::threadComplete(bool userPressedCancel)
@@ -323,6 +506,7 @@ void SampleLibraryManager::threadComplete(bool userPressedCancel)
 void SampleLibraryManager::loadSampleLibrary(File const & inLibraryDirectory)
 {
     addedFilePaths.clear();
+    mDirectorySnapshots.clear();
     libraryDirectory = inLibraryDirectory;
     
 //    // BPM statistics
@@ -458,6 +642,11 @@ void SampleLibraryManager::writeSampleItemToXml(SampleItem * sampleItem, XmlElem
     samplePropertyXml->setAttribute("PropertyValue", sampleItem->getSampleRate());
     samplePropertiesXml->prependChildElement(samplePropertyXml);
     
+    // Adding peak level property
+    samplePropertyXml = new XmlElement("Peak-Level");
+    samplePropertyXml->setAttribute("PropertyValue", sampleItem->getPeakLevel());
+    samplePropertiesXml->prependChildElement(samplePropertyXml);
+    
     // Adding feature vector
     std::vector<float> spectralDistribution = sampleItem->getSpectralDistribution();
     
@@ -571,6 +760,14 @@ void SampleLibraryManager::createSampleItemFromXml(const XmlElement * sampleItem
     float sampleRate = samplePropertyXml->getIntAttribute("PropertyValue");
     sampleItem->setSampleRate(sampleRate);
     
+    // Adding peak level to item, libraries from older versions don't have it yet
+    XmlElement* peakLevelXml = samplePropertiesXml->getChildByName("Peak-Level");
+    
+    if (peakLevelXml != nullptr)
+    {
+        sampleItem->setPeakLevel(peakLevelXml->getDoubleAttribute("PropertyValue"));
+    }
+    
     // Adding spectral distribution to item
     std::vector<float> spectralDistribution(NUM_SPECTRAL_BANDS);
     
@@ -711,10 +908,16 @@ void SampleLibraryManager::analyseSampleItem(SampleItem* inSampleItem, File cons
                                 inFile,
                                 inSampleItem,
                                 forceAnalysis,
-                                numProcessedItems),
+                                numProcessedItems,
+                                mAnalysisBroadcaster),
            true);
 }
 
+ChangeBroadcaster& SampleLibraryManager::getAnalysisBroadcaster()
+{
+    return mAnalysisBroadcaster;
+}
+
 String SampleLibraryManager::replaceSpecialChars(String inString)
 {
     // inString = String("_" + inString);
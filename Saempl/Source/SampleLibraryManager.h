@@ -14,6 +14,9 @@
 #include "BlomeHelpers.h"
 #include "SampleAnalysisJob.h"
 #include <random>
+#include <map>
+#include <unordered_map>
+#include <unordered_set>
 
 /**
  Handles updating and creating of directory meta-analysis files.
@@ -97,15 +100,32 @@ public:
      @param forceAnalysis forces analysis even for files longer than one minute.
      */
     void analyseSampleItem(SampleItem* inSampleItem, File const & inFile, bool forceAnalysis);
+    /**
+     @returns the broadcaster that sends a change message when added or reanalysed sample items got their analysed values.
+     */
+    ChangeBroadcaster& getAnalysisBroadcaster();
     
 private:
+    /**
+     The contents of a library directory at the last synchronisation.
+     */
+    struct DirectorySnapshot
+    {
+        Time modificationTime;
+        // Sorted, so two snapshots of a directory are compared in one pass
+        StringArray filePaths;
+        StringArray subdirectoryPaths;
+    };
+    
     File libraryDirectory;
+    std::map<String, DirectorySnapshot> mDirectorySnapshots;
     OwnedArray<SampleItem>& allSampleItems;
     OwnedArray<SampleItem>& favouriteSampleItems;
     OwnedArray<SampleItem>& deletedSampleItems;
     OwnedArray<SampleItem>& addedSampleItems;
     OwnedArray<SampleItem>& alteredSampleItems;
     StringArray addedFilePaths;
+    ChangeBroadcaster mAnalysisBroadcaster;
     InterProcessLock mFileLock{"fileLock"};
     String mLibraryFilesDirectoryPath =
     (File::getSpecialLocation(File::userMusicDirectory)).getFullPathName()
@@ -182,6 +202,25 @@ private:
      Checks for all library files if their directory still exists. If not it deletes the library file.
      */
     void checkValidityOfLibraryFiles();
+    /**
+     Writes the added, altered and deleted sample items to the library files of their directories.
+     
+     @param inSynchronisedSnapshots the directory snapshots of a running synchronisation, empty outside of one.
+     */
+    void updateSampleLibraryFiles(std::map<String, DirectorySnapshot> const & inSynchronisedSnapshots);
+    /**
+     Walks the library directory tree and compares it to the snapshots of the last synchronisation.
+     
+     Directories whose modification time didn't change reuse their snapshot without being listed,
+     so only the directories where files were created, deleted or renamed are read from disk.
+     
+     @param outSnapshots the snapshots of all directories currently in the library.
+     @param outCreatedFilePaths the paths of all sample files that were created since the last synchronisation.
+     @param outDeletedFilePaths the paths of all sample files that were deleted since the last synchronisation.
+     */
+    void collectDirectoryChanges(std::map<String, DirectorySnapshot>& outSnapshots,
+                                 StringArray& outCreatedFilePaths,
+                                 StringArray& outDeletedFilePaths);
     
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(SampleLibraryManager);
 };
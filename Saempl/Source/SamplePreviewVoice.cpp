@@ -0,0 +1,490 @@
+/*
+ ==============================================================================
+ 
+ SamplePreviewVoice.cpp
+ Author:  Jonas Blome
+ 
+ ==============================================================================
+ */
+
+#include "SamplePreviewVoice.h"
+
+SamplePreviewVoice::SamplePreviewVoice()
+:
+mStreamFifo(streamBufferSize),
+mCommandFifo((int) mCommands.size())
+{
+    mFormatManager.registerBasicFormats();
+    mStreamBuffer.setSize(2, streamBufferSize);
+    mReadBuffer.setSize(2, readBlockSize);
+    mStreamRequest = { File(), 0.0, 0.0, NO_KEY_INDEX, nullptr };
+    streamSource = nullptr;
+    mLoadedStreamRequest = mStreamRequest;
+    requestedStreamIndex = 0;
+    loadedStreamIndex = 0;
+    streamNeedsOpening = false;
+    flushRequestIndex = 0;
+    flushedStreamIndex = 0;
+    streamStartPosition = 0.0;
+    streamSampleTempo = 0.0;
+    streamSampleKey = NO_KEY_INDEX;
+    streamIsFinished = true;
+    hostSampleRate = 44100.0;
+    currentPosition = 0.0;
+    finishedPlayIndex = 0;
+    startIsQuantised = false;
+    tempoIsMatched = false;
+    targetTempo = 120.0;
+    targetKey = NO_KEY_INDEX;
+    currentPlayIndex = 0;
+    isStarted = false;
+    currentGain = 1.0;
+    playingIndex = 0;
+    pendingStartPlayIndex = 0;
+    pendingStartStreamIndex = 0;
+    numSamplesUntilStart = 0;
+    numRenderedSamples = 0;
+    renderedStreamStartPosition = 0.0;
+    renderedStreamSampleTempo = 0.0;
+    renderedStreamSampleKey = NO_KEY_INDEX;
+    renderedStreamTargetKey = NO_KEY_INDEX;
+    renderedStreamIsStretched = false;
+    mTimeStretcher.prepare(hostSampleRate);
+    
+    // Create thread for streaming the sample into the ring buffer
+    mReaderThread = std::make_unique<TimeSliceThread>("SamplePreviewReaderThread");
+    mReaderThread->addTimeSliceClient(this);
+    mReaderThread->startThread(Thread::Priority::high);
+}
+
+SamplePreviewVoice::~SamplePreviewVoice()
+{
+    mReaderThread->removeTimeSliceClient(this);
+    mReaderThread->stopThread(10000);
+}
+
+void SamplePreviewVoice::prepareToPlay(double inSampleRate, int inMaximumBlockSize)
+{
+    hostSampleRate = inSampleRate;
+    mTimeStretcher.prepare(inSampleRate);
+    
+    // Stream the current sample again, resampled to the new rate
+    const ScopedLock lock(mRequestLock);
+    
+    if (mStreamRequest.file != File())
+    {
+        mStreamRequest.startPosition = currentPosition.load();
+        requestedStreamIndex++;
+    }
+}
+
+void SamplePreviewVoice::renderNextBlock(AudioBuffer<float>& outputBuffer, Optional<AudioPlayHead::PositionInfo> inHostPosition)
+{
+    int numSamples = outputBuffer.getNumSamples();
+    
+    // Discard what is left of the previous stream once the reader thread asks for it
+    int requestIndex = flushRequestIndex.load(std::memory_order_acquire);
+    
+    if (requestIndex != flushedStreamIndex.load(std::memory_order_relaxed))
+    {
+        mStreamFifo.finishedRead(mStreamFifo.getNumReady());
+        renderedStreamStartPosition = streamStartPosition.load();
+        renderedStreamSampleTempo = streamSampleTempo.load();
+        renderedStreamSampleKey = streamSampleKey.load();
+        // Latch the target key so a key change doesn't retune the sample while it plays
+        renderedStreamTargetKey = targetKey.load();
+        renderedStreamIsStretched = (tempoIsMatched && renderedStreamSampleTempo > 0)
+        || getKeyDistanceInSemitones(renderedStreamSampleKey, renderedStreamTargetKey) != 0;
+        mTimeStretcher.reset();
+        numRenderedSamples = 0;
+        currentPosition = renderedStreamStartPosition;
+        flushedStreamIndex.store(requestIndex, std::memory_order_release);
+    }
+    
+    handleCommands();
+    applyPendingStart(inHostPosition);
+    
+    if (playingIndex == 0)
+    {
+        return;
+    }
+    
+    // Wait for the next beat of the host if the start is quantised
+    int startSample = jmin<int>(numSamplesUntilStart, numSamples);
+    numSamplesUntilStart -= startSample;
+    
+    // Read the finished flag first, so the last samples of the stream are never missed
+    bool streamFinished = streamIsFinished.load(std::memory_order_acquire);
+    int numSamplesRendered = renderedStreamIsStretched
+    ? renderStretchedStream(outputBuffer, startSample, inHostPosition)
+    : renderStream(outputBuffer, startSample);
+    
+    // The preview ends once the reader reached the end of the sample and everything buffered was played
+    if (streamFinished && mStreamFifo.getNumReady() == 0 && numSamplesRendered < numSamples - startSample)
+    {
+        finishedPlayIndex = playingIndex;
+        playingIndex = 0;
+    }
+}
+
+int SamplePreviewVoice::renderStream(AudioBuffer<float>& outputBuffer, int inStartSample)
+{
+    int numSamplesToRead = jmin<int>(outputBuffer.getNumSamples() - inStartSample, mStreamFifo.getNumReady());
+    int start1, size1, start2, size2;
+    mStreamFifo.prepareToRead(numSamplesToRead, start1, size1, start2, size2);
+    
+    for (int ch = 0; ch < outputBuffer.getNumChannels(); ch++)
+    {
+        int streamChannel = jmin<int>(ch, mStreamBuffer.getNumChannels() - 1);
+        
+        if (size1 > 0)
+        {
+            outputBuffer.addFrom(ch, inStartSample, mStreamBuffer, streamChannel, start1, size1, currentGain);
+        }
+        
+        if (size2 > 0)
+        {
+            outputBuffer.addFrom(ch, inStartSample + size1, mStreamBuffer, streamChannel, start2, size2, currentGain);
+        }
+    }
+    
+    mStreamFifo.finishedRead(size1 + size2);
+    numRenderedSamples += size1 + size2;
+    currentPosition = renderedStreamStartPosition + numRenderedSamples / hostSampleRate.load();
+    
+    return size1 + size2;
+}
+
+int SamplePreviewVoice::renderStretchedStream(AudioBuffer<float>& outputBuffer,
+                                              int inStartSample,
+                                              Optional<AudioPlayHead::PositionInfo> const & inHostPosition)
+{
+    mTimeStretcher.setSpeed(getPlaybackSpeed(inHostPosition));
+    mTimeStretcher.setPitchShift(getKeyDistanceInSemitones(renderedStreamSampleKey, renderedStreamTargetKey));
+    int numSamples = outputBuffer.getNumSamples() - inStartSample;
+    int numSamplesRendered = 0;
+    
+    // Refill the stretcher until the block is complete or the ring buffer is empty
+    while (numSamplesRendered < numSamples)
+    {
+        int numSamplesToRead = jmin<int>(mTimeStretcher.getNumInputSamplesWanted(), mStreamFifo.getNumReady());
+        int start1, size1, start2, size2;
+        mStreamFifo.prepareToRead(numSamplesToRead, start1, size1, start2, size2);
+        mTimeStretcher.addInput(mStreamBuffer, start1, size1);
+        mTimeStretcher.addInput(mStreamBuffer, start2, size2);
+        mStreamFifo.finishedRead(size1 + size2);
+        
+        int numNewSamples = mTimeStretcher.render(outputBuffer,
+                                                  inStartSample + numSamplesRendered,
+                                                  numSamples - numSamplesRendered,
+                                                  currentGain);
+        numSamplesRendered += numNewSamples;
+        
+        if (numNewSamples == 0 && size1 + size2 == 0)
+        {
+            break;
+        }
+    }
+    
+    currentPosition = renderedStreamStartPosition + mTimeStretcher.getInputPosition() / hostSampleRate.load();
+    
+    return numSamplesRendered;
+}
+
+double SamplePreviewVoice::getPlaybackSpeed(Optional<AudioPlayHead::PositionInfo> const & inHostPosition)
+{
+    if (!tempoIsMatched || renderedStreamSampleTempo <= 0)
+    {
+        return 1.0;
+    }
+    
+    double tempo = targetTempo.load();
+    
+    if (inHostPosition.hasValue() && inHostPosition->getBpm().hasValue() && *inHostPosition->getBpm() > 0)
+    {
+        tempo = *inHostPosition->getBpm();
+    }
+    
+    double speed = tempo / renderedStreamSampleTempo;
+    
+    // Play loops in half or double time instead of stretching them by more than half an octave of tempo
+    while (speed > MathConstants<double>::sqrt2)
+    {
+        speed *= 0.5;
+    }
+    
+    while (speed < 1.0 / MathConstants<double>::sqrt2)
+    {
+        speed *= 2.0;
+    }
+    
+    return speed;
+}
+
+void SamplePreviewVoice::handleCommands()
+{
+    int start1, size1, start2, size2;
+    mCommandFifo.prepareToRead(mCommandFifo.getNumReady(), start1, size1, start2, size2);
+    
+    auto applyCommands = [this](int inStart, int inSize)
+    {
+        for (int c = inStart; c < inStart + inSize; c++)
+        {
+            Command const & command = mCommands[c];
+            
+            switch (command.type)
+            {
+                case COMMAND_START:
+                    playingIndex = 0;
+                    pendingStartPlayIndex = command.playIndex;
+                    pendingStartStreamIndex = command.streamIndex;
+                    break;
+                case COMMAND_STOP:
+                    playingIndex = 0;
+                    pendingStartPlayIndex = 0;
+                    break;
+                case COMMAND_SET_GAIN:
+                    currentGain = command.value;
+                    break;
+            }
+        }
+    };
+    
+    applyCommands(start1, size1);
+    applyCommands(start2, size2);
+    mCommandFifo.finishedRead(size1 + size2);
+}
+
+void SamplePreviewVoice::applyPendingStart(Optional<AudioPlayHead::PositionInfo> const & inHostPosition)
+{
+    // Starting before the flush would play the rest of the previous stream, or end right away if that one had finished
+    if (pendingStartPlayIndex == 0 || flushedStreamIndex.load(std::memory_order_relaxed) - pendingStartStreamIndex < 0)
+    {
+        return;
+    }
+    
+    playingIndex = pendingStartPlayIndex;
+    pendingStartPlayIndex = 0;
+    numSamplesUntilStart = startIsQuantised ? getNumSamplesUntilNextBeat(inHostPosition) : 0;
+}
+
+int SamplePreviewVoice::getNumSamplesUntilNextBeat(Optional<AudioPlayHead::PositionInfo> const & inHostPosition)
+{
+    if (!inHostPosition.hasValue() || !inHostPosition->getIsPlaying())
+    {
+        return 0;
+    }
+    
+    Optional<double> ppqPosition = inHostPosition->getPpqPosition();
+    Optional<double> bpm = inHostPosition->getBpm();
+    
+    if (!ppqPosition.hasValue() || !bpm.hasValue() || *bpm <= 0)
+    {
+        return 0;
+    }
+    
+    double beatsUntilNextBeat = std::ceil(*ppqPosition) - *ppqPosition;
+    
+    return (int) std::round(beatsUntilNextBeat * 60.0 / *bpm * hostSampleRate.load());
+}
+
+void SamplePreviewVoice::load(File const & inFile,
+                              double inSampleTempo,
+                              int inSampleKey,
+                              std::shared_ptr<AudioBuffer<float> const> inAttack)
+{
+    stop();
+    requestStream({ inFile, 0.0, inSampleTempo, inSampleKey, inAttack });
+}
+
+void SamplePreviewVoice::start()
+{
+    currentPlayIndex++;
+    isStarted = true;
+    sendCommand(COMMAND_START, 0.0);
+}
+
+void SamplePreviewVoice::stop()
+{
+    isStarted = false;
+    sendCommand(COMMAND_STOP, 0.0);
+}
+
+void SamplePreviewVoice::setPosition(double inPosition)
+{
+    StreamRequest request;
+    
+    {
+        const ScopedLock lock(mRequestLock);
+        request = mStreamRequest;
+    }
+    
+    // Show the new position right away, the audio thread takes over once the stream was flushed
+    currentPosition = inPosition;
+    request.startPosition = inPosition;
+    requestStream(request);
+}
+
+double SamplePreviewVoice::getPosition()
+{
+    return currentPosition.load();
+}
+
+bool SamplePreviewVoice::isPlaying()
+{
+    return isStarted && finishedPlayIndex.load() != currentPlayIndex;
+}
+
+void SamplePreviewVoice::setGain(float inGain)
+{
+    sendCommand(COMMAND_SET_GAIN, inGain);
+}
+
+void SamplePreviewVoice::setStartIsQuantised(bool inStartIsQuantised)
+{
+    startIsQuantised = inStartIsQuantised;
+}
+
+void SamplePreviewVoice::setTempoMatching(bool inTempoIsMatched, double inTargetTempo)
+{
+    tempoIsMatched = inTempoIsMatched;
+    targetTempo = inTargetTempo;
+}
+
+void SamplePreviewVoice::setTargetKey(int inTargetKey)
+{
+    targetKey = inTargetKey;
+}
+
+void SamplePreviewVoice::sendCommand(CommandType inType, float inValue)
+{
+    int start1, size1, start2, size2;
+    mCommandFifo.prepareToWrite(1, start1, size1, start2, size2);
+    
+    int streamIndex;
+    
+    {
+        const ScopedLock lock(mRequestLock);
+        streamIndex = requestedStreamIndex;
+    }
+    
+    // The queue only fills up if the host stopped calling the audio callback, the command is dropped then
+    if (size1 > 0)
+    {
+        mCommands[start1] = { inType, currentPlayIndex, streamIndex, inValue };
+    }
+    
+    mCommandFifo.finishedWrite(size1);
+}
+
+void SamplePreviewVoice::requestStream(StreamRequest const & inRequest)
+{
+    {
+        const ScopedLock lock(mRequestLock);
+        mStreamRequest = inRequest;
+        requestedStreamIndex++;
+    }
+    
+    mReaderThread->moveToFrontOfQueue(this);
+}
+
+int SamplePreviewVoice::useTimeSlice()
+{
+    {
+        const ScopedLock lock(mRequestLock);
+        
+        // Stop writing and ask the audio thread to discard what is left of the previous stream
+        if (requestedStreamIndex != loadedStreamIndex)
+        {
+            mLoadedStreamRequest = mStreamRequest;
+            loadedStreamIndex = requestedStreamIndex;
+            closeStream();
+            streamNeedsOpening = true;
+            streamIsFinished = false;
+            streamStartPosition = mLoadedStreamRequest.startPosition;
+            streamSampleTempo = mLoadedStreamRequest.sampleTempo;
+            streamSampleKey = mLoadedStreamRequest.sampleKey;
+            flushRequestIndex.store(loadedStreamIndex, std::memory_order_release);
+        }
+    }
+    
+    // Wait until the audio thread flushed the ring buffer
+    if (flushedStreamIndex.load(std::memory_order_acquire) != loadedStreamIndex)
+    {
+        return 5;
+    }
+    
+    if (streamNeedsOpening)
+    {
+        streamNeedsOpening = false;
+        openStream(mLoadedStreamRequest);
+    }
+    
+    if (mResamplingSource == nullptr)
+    {
+        return 100;
+    }
+    
+    if (mStreamFifo.getFreeSpace() < readBlockSize)
+    {
+        return 5;
+    }
+    
+    mResamplingSource->getNextAudioBlock(AudioSourceChannelInfo(&mReadBuffer, 0, readBlockSize));
+    
+    int start1, size1, start2, size2;
+    mStreamFifo.prepareToWrite(readBlockSize, start1, size1, start2, size2);
+    
+    for (int ch = 0; ch < mStreamBuffer.getNumChannels(); ch++)
+    {
+        mStreamBuffer.copyFrom(ch, start1, mReadBuffer, ch, 0, size1);
+        mStreamBuffer.copyFrom(ch, start2, mReadBuffer, ch, size1, size2);
+    }
+    
+    mStreamFifo.finishedWrite(size1 + size2);
+    
+    // The resampler only holds back a few samples, so the end of the sample is in the ring buffer now
+    if (streamSource->getNextReadPosition() >= streamSource->getTotalLength())
+    {
+        closeStream();
+        streamIsFinished.store(true, std::memory_order_release);
+    }
+    
+    return 0;
+}
+
+void SamplePreviewVoice::openStream(StreamRequest const & inRequest)
+{
+    std::unique_ptr<AudioFormatReader> reader(inRequest.file == File() ? nullptr : mFormatManager.createReaderFor(inRequest.file));
+    
+    if (reader == nullptr)
+    {
+        streamIsFinished.store(true, std::memory_order_release);
+        return;
+    }
+    
+    double fileSampleRate = reader->sampleRate;
+    double sampleRate = hostSampleRate.load();
+    mReaderSource = std::make_unique<AudioFormatReaderSource>(reader.release(), true);
+    streamSource = mReaderSource.get();
+    
+    // The cached attack fills the ring buffer from memory, the file is only read from where it ends
+    if (inRequest.attack != nullptr)
+    {
+        mAttackSource = std::make_unique<AttackCachedAudioSource>(inRequest.attack, *mReaderSource);
+        streamSource = mAttackSource.get();
+    }
+    
+    streamSource->setNextReadPosition((int64) (inRequest.startPosition * fileSampleRate));
+    mResamplingSource = std::make_unique<ResamplingAudioSource>(streamSource, false, 2);
+    mResamplingSource->setResamplingRatio(fileSampleRate / sampleRate);
+    mResamplingSource->prepareToPlay(readBlockSize, sampleRate);
+}
+
+void SamplePreviewVoice::closeStream()
+{
+    mResamplingSource.reset();
+    mAttackSource.reset();
+    mReaderSource.reset();
+    streamSource = nullptr;
+}
@@ -0,0 +1,245 @@
+/*
+ ==============================================================================
+ 
+ SamplePreviewVoice.h
+ Author:  Jonas Blome
+ 
+ ==============================================================================
+ */
+
+#pragma once
+
+#include "JuceHeader.h"
+#include "BlomeHelpers.h"
+#include "SampleTimeStretcher.h"
+#include "AttackCachedAudioSource.h"
+#include <array>
+#include <atomic>
+
+/**
+ Plays the preview of a sample file inside the plugin's audio callback, so auditioning goes through the host's output.
+ 
+ A background reader thread decodes the sample, resamples it to the host's rate and writes it into a preallocated ring buffer.
+ The audio thread only reads from that buffer and takes its start and stop commands from a lock-free queue,
+ so it never locks or allocates. Loading a new sample or seeking flushes the ring buffer with a handshake between both threads.
+ With tempo matching, loops are time stretched on the audio thread to the host's tempo, or to a chosen tempo if the host has none.
+ With key matching, samples are transposed to a chosen key in the same pass.
+ */
+class SamplePreviewVoice
+:
+private TimeSliceClient
+{
+public:
+    SamplePreviewVoice();
+    ~SamplePreviewVoice();
+    /**
+     Prepares the voice for the host's audio callback.
+     
+     @param inSampleRate the sample rate of the host.
+     @param inMaximumBlockSize the largest block the host will ask for.
+     */
+    void prepareToPlay(double inSampleRate, int inMaximumBlockSize);
+    /**
+     Adds the preview to the output of the host's audio callback. Called on the audio thread.
+     
+     @param outputBuffer the buffer to add the preview to.
+     @param inHostPosition the position of the host's transport, if it provides one.
+     */
+    void renderNextBlock(AudioBuffer<float>& outputBuffer, Optional<AudioPlayHead::PositionInfo> inHostPosition);
+    /**
+     Loads a sample file and streams it from its start, the voice stays stopped.
+     
+     @param inFile the sample file to preview, an empty file unloads the voice.
+     @param inSampleTempo the analysed tempo of the sample in bpm, 0 if it has none.
+     @param inSampleKey the analysed key index of the sample.
+     @param inAttack the cached first samples of the file, which are streamed from memory instead of the file if given.
+     */
+    void load(File const & inFile,
+              double inSampleTempo,
+              int inSampleKey,
+              std::shared_ptr<AudioBuffer<float> const> inAttack = nullptr);
+    /**
+     Starts the preview at the current position.
+     */
+    void start();
+    /**
+     Stops the preview and keeps its position.
+     */
+    void stop();
+    /**
+     Moves the preview to a new position.
+     
+     @param inPosition the position in seconds.
+     */
+    void setPosition(double inPosition);
+    /**
+     @returns the current position of the preview in seconds.
+     */
+    double getPosition();
+    /**
+     @returns whether the preview is playing and has not reached the end of the sample yet.
+     */
+    bool isPlaying();
+    /**
+     Sets the gain of the preview.
+     
+     @param inGain the linear gain.
+     */
+    void setGain(float inGain);
+    /**
+     Sets whether a started preview waits for the next beat of the host's transport while it is playing.
+     
+     @param inStartIsQuantised whether the start is quantised to the host's beats.
+     */
+    void setStartIsQuantised(bool inStartIsQuantised);
+    /**
+     Sets whether samples with a tempo are stretched to the host's tempo, which takes effect when the next sample is loaded.
+     
+     @param inTempoIsMatched whether the tempo is matched.
+     @param inTargetTempo the tempo in bpm to match if the host doesn't provide one.
+     */
+    void setTempoMatching(bool inTempoIsMatched, double inTargetTempo);
+    /**
+     Sets the key samples are transposed to, which takes effect when the next sample is loaded.
+     
+     @param inTargetKey the key index to transpose to, NO_KEY_INDEX keeps the samples' pitch.
+     */
+    void setTargetKey(int inTargetKey);
+    
+private:
+    /**
+     The commands the message thread sends to the audio thread.
+     */
+    enum CommandType
+    {
+        COMMAND_START = 0,
+        COMMAND_STOP,
+        COMMAND_SET_GAIN,
+    };
+    
+    struct Command
+    {
+        CommandType type;
+        int playIndex;
+        // The stream requested when the command was sent, a start waits until it was flushed
+        int streamIndex;
+        float value;
+    };
+    
+    /**
+     A sample file and position the reader thread should stream from.
+     */
+    struct StreamRequest
+    {
+        File file;
+        double startPosition;
+        double sampleTempo;
+        int sampleKey;
+        std::shared_ptr<AudioBuffer<float> const> attack;
+    };
+    
+    std::unique_ptr<TimeSliceThread> mReaderThread;
+    AudioFormatManager mFormatManager;
+    std::unique_ptr<AudioFormatReaderSource> mReaderSource;
+    std::unique_ptr<AttackCachedAudioSource> mAttackSource;
+    // The attack source if the file's attack was cached, the reader source otherwise
+    PositionableAudioSource* streamSource;
+    std::unique_ptr<ResamplingAudioSource> mResamplingSource;
+    AudioBuffer<float> mReadBuffer;
+    // Written by the reader thread, read by the audio thread
+    AbstractFifo mStreamFifo;
+    AudioBuffer<float> mStreamBuffer;
+    // Written by the message thread, read by the audio thread
+    AbstractFifo mCommandFifo;
+    std::array<Command, 64> mCommands;
+    // Guards the stream request between the message thread and the reader thread, never taken on the audio thread
+    CriticalSection mRequestLock;
+    StreamRequest mStreamRequest;
+    int requestedStreamIndex;
+    // Only used on the reader thread
+    StreamRequest mLoadedStreamRequest;
+    int loadedStreamIndex;
+    bool streamNeedsOpening;
+    std::atomic<int> flushRequestIndex;
+    std::atomic<int> flushedStreamIndex;
+    std::atomic<double> streamStartPosition;
+    std::atomic<double> streamSampleTempo;
+    std::atomic<int> streamSampleKey;
+    std::atomic<bool> streamIsFinished;
+    std::atomic<double> hostSampleRate;
+    std::atomic<double> currentPosition;
+    std::atomic<int> finishedPlayIndex;
+    std::atomic<bool> startIsQuantised;
+    std::atomic<bool> tempoIsMatched;
+    std::atomic<double> targetTempo;
+    std::atomic<int> targetKey;
+    // Only used on the message thread
+    int currentPlayIndex;
+    bool isStarted;
+    // Only used on the audio thread
+    float currentGain;
+    int playingIndex;
+    int pendingStartPlayIndex;
+    int pendingStartStreamIndex;
+    int numSamplesUntilStart;
+    int64 numRenderedSamples;
+    double renderedStreamStartPosition;
+    double renderedStreamSampleTempo;
+    int renderedStreamSampleKey;
+    int renderedStreamTargetKey;
+    bool renderedStreamIsStretched;
+    SampleTimeStretcher mTimeStretcher;
+    static int const streamBufferSize = 1 << 16;
+    static int const readBlockSize = 2048;
+    
+    /**
+     Opens the stream request, flushes the ring buffer and refills it while there is space.
+     */
+    int useTimeSlice() override;
+    /**
+     Hands a new stream request to the reader thread.
+     */
+    void requestStream(StreamRequest const & inRequest);
+    /**
+     Opens the requested sample file at its start position for the current host sample rate.
+     */
+    void openStream(StreamRequest const & inRequest);
+    /**
+     Releases the sources of the current stream.
+     */
+    void closeStream();
+    /**
+     Sends a command to the audio thread.
+     */
+    void sendCommand(CommandType inType, float inValue);
+    /**
+     Applies the commands that were sent since the last block. Called on the audio thread.
+     */
+    void handleCommands();
+    /**
+     Starts a pending preview once the stream it was started for replaced the previous one in the ring buffer. Called on the audio thread.
+     */
+    void applyPendingStart(Optional<AudioPlayHead::PositionInfo> const & inHostPosition);
+    /**
+     Adds the next samples of the ring buffer to the output. Called on the audio thread.
+     
+     @returns the number of samples that were written.
+     */
+    int renderStream(AudioBuffer<float>& outputBuffer, int inStartSample);
+    /**
+     Stretches the next samples of the ring buffer to the target tempo and key and adds them to the output. Called on the audio thread.
+     
+     @returns the number of samples that were written.
+     */
+    int renderStretchedStream(AudioBuffer<float>& outputBuffer, int inStartSample, Optional<AudioPlayHead::PositionInfo> const & inHostPosition);
+    /**
+     @returns the speed that plays the current sample at the host's or the chosen tempo, 1.0 if the tempo isn't matched.
+     */
+    double getPlaybackSpeed(Optional<AudioPlayHead::PositionInfo> const & inHostPosition);
+    /**
+     @returns the number of samples until the next beat of the host's transport, 0 if it isn't playing.
+     */
+    int getNumSamplesUntilNextBeat(Optional<AudioPlayHead::PositionInfo> const & inHostPosition);
+    
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(SamplePreviewVoice);
+};
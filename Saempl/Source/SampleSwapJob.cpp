@@ -9,7 +9,7 @@
 
 #include "SampleSwapJob.h"
 
-SampleSwapJob::SampleSwapJob(OwnedArray<SampleItem> & inSampleItems,
+SampleSwapJob::SampleSwapJob(Array<SampleItem*> & inSampleItems,
                              std::set<int> & inSwapPositionsInUse,
                              std::set<int> & inStartIndicesInUse,
                              CriticalSection & inSwapLock,
@@ -20,7 +20,8 @@ SampleSwapJob::SampleSwapJob(OwnedArray<SampleItem> & inSampleItems,
                              int inSwapAreaHeight,
                              int inRows,
                              int inColumns,
-                             std::vector<std::vector<float>> & inGrid)
+                             std::vector<std::vector<float>> & inGrid,
+                             RandomStream inRandom)
 :
 ThreadPoolJob("SampleSwapJob"),
 numSwapPositions(inNumSwapPositions),
@@ -34,7 +35,8 @@ swapPositionsInUse(inSwapPositionsInUse),
 startIndicesInUse(inStartIndicesInUse),
 swapLock(inSwapLock),
 swapAreaIndices(inSwapAreaIndices),
-grid(inGrid)
+grid(inGrid),
+mRandom(inRandom)
 {
     
 }
@@ -96,14 +98,9 @@ int SampleSwapJob::findSwapPositionsWrap(std::vector<int>& swapAreaIndices,
                                          int rows,
                                          int columns)
 {
-    std::random_device random;
-    std::mt19937 generator(random());
-    
-    std::uniform_int_distribution<> distribution1(0, (int) swapAreaIndices.size() - (int) numSwapPositions);
-    int startIndex = ((int) swapAreaIndices.size() - numSwapPositions > 0) ? distribution1(generator) : 0;
-    
-    std::uniform_int_distribution<> distribution2(0, rows * columns);
-    int randomPosition = distribution2(generator);
+    int numStartIndices = (int) swapAreaIndices.size() - numSwapPositions + 1;
+    int startIndex = (numStartIndices > 1) ? mRandom.nextInt(numStartIndices) : 0;
+    int randomPosition = mRandom.nextInt(rows * columns + 1);
     int numActualSwapPositions = 0;
     for (int j = startIndex; j < (int) swapAreaIndices.size() && numActualSwapPositions < numSwapPositions; j++)
     {
@@ -142,12 +139,8 @@ int SampleSwapJob::findSwapPositions(std::vector<int>& swapAreaIndices,
                                      int rows,
                                      int columns)
 {
-    std::random_device random;
-    std::mt19937 generator(random());
-    
     // Find random position in grid
-    std::uniform_int_distribution<> distribution1(0, rows * columns);
-    int randomPosition = distribution1(generator);
+    int randomPosition = mRandom.nextInt(rows * columns + 1);
     int randomX = randomPosition % columns;
     int randomY = randomPosition / columns;
     
@@ -166,16 +159,16 @@ int SampleSwapJob::findSwapPositions(std::vector<int>& swapAreaIndices,
     }
     
     // Select random index in swap area
-    std::uniform_int_distribution<> distribution2(0, (int) swapAreaIndices.size() - numSwapPositions);
+    int numStartIndices = (int) swapAreaIndices.size() - numSwapPositions + 1;
     int numActualSwapPositions = 0;
     CriticalSection::ScopedLockType const scopedLock(swapLock);
     
     // Get the start index and look for a new one if it is already in use
-    startIndex = ((int) swapAreaIndices.size() - numSwapPositions > 0) ? distribution2(generator) : 0;
+    startIndex = (numStartIndices > 1) ? mRandom.nextInt(numStartIndices) : 0;
     
     while (startIndicesInUse.find(startIndex) != startIndicesInUse.end())
     {
-        startIndex = ((int) swapAreaIndices.size() - numSwapPositions > 0) ? distribution2(generator) : 0;
+        startIndex = (numStartIndices > 1) ? mRandom.nextInt(numStartIndices) : 0;
     }
     
     startIndicesInUse.insert(startIndex);
@@ -235,9 +228,7 @@ void SampleSwapJob::doSwaps(std::vector<int> & swapPositions,
         
         for (int s = 0; s < numSwapPositions; s++)
         {
-            sampleItems.set(swapPositions[optimalPermutation[s]],
-                            swappedElements[s],
-                            false);
+            sampleItems.set(swapPositions[optimalPermutation[s]], swappedElements[s]);
         }
         
         // Remove used start indices and swap positions
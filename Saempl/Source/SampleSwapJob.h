@@ -11,7 +11,6 @@
 
 #include "JuceHeader.h"
 #include "SampleItem.h"
-#include <random>
 
 class SampleSwapJob
 :
@@ -21,7 +20,7 @@ public:
     /**
      The sample swap job constructor.
      */
-    SampleSwapJob(OwnedArray<SampleItem>& inSampleItems,
+    SampleSwapJob(Array<SampleItem*>& inSampleItems,
                   std::set<int> & inStartIndicesInUse,
                   std::set<int> & inSwapPositionsInUse,
                   CriticalSection & inSwapLock,
@@ -32,7 +31,8 @@ public:
                   int inSwapAreaHeight,
                   int inRows,
                   int inColumns,
-                  std::vector<std::vector<float>> & inGrid);
+                  std::vector<std::vector<float>> & inGrid,
+                  RandomStream inRandom);
     ~SampleSwapJob();
     
 private:
@@ -44,7 +44,7 @@ private:
     int const rows;
     int const columns;
     int startIndex;
-    OwnedArray<SampleItem> & sampleItems;
+    Array<SampleItem*> & sampleItems;
     std::set<int> & swapPositionsInUse;
     std::set<int> & startIndicesInUse;
     CriticalSection & swapLock;
@@ -56,6 +56,7 @@ private:
     std::vector<std::vector<float>> mDistanceMatrix;
     std::vector<std::vector<int>> mDistanceMatrixNormalised;
     std::vector<std::vector<float>>& grid;
+    RandomStream mRandom;
     
     /**
      Runs the swapping of sample items on the grid.
@@ -0,0 +1,292 @@
+/*
+ ==============================================================================
+ 
+ SampleTimeStretcher.cpp
+ Author:  Jonas Blome
+ 
+ ==============================================================================
+ */
+
+#include "SampleTimeStretcher.h"
+
+SampleTimeStretcher::SampleTimeStretcher()
+{
+    frameSize = 0;
+    synthesisHop = 0;
+    seekRange = 0;
+    correlationLength = 0;
+    inputCapacity = 0;
+    speed = 1.0;
+    pitchRatio = 1.0;
+    reset();
+}
+
+SampleTimeStretcher::~SampleTimeStretcher()
+{
+    
+}
+
+void SampleTimeStretcher::prepare(double inSampleRate)
+{
+    // Frames of about 25 ms overlap by half, which sums the Hann windows to one
+    synthesisHop = jmax<int>(64, roundToInt(inSampleRate * 0.0125));
+    frameSize = synthesisHop * 2;
+    seekRange = synthesisHop / 2;
+    correlationLength = synthesisHop;
+    // Holds the furthest reaching frame search at double speed
+    inputCapacity = frameSize * 4;
+    
+    mInput.setSize(2, inputCapacity);
+    mInputMix.setSize(1, inputCapacity);
+    mOutput.setSize(2, frameSize);
+    // Leaves room for the samples the resampling didn't use up yet
+    mReady.setSize(2, synthesisHop + 4);
+    mFrame.setSize(1, frameSize);
+    mWindow.setSize(1, frameSize);
+    
+    float* window = mWindow.getWritePointer(0);
+    
+    for (int s = 0; s < frameSize; s++)
+    {
+        window[s] = 0.5f - 0.5f * std::cos(MathConstants<float>::twoPi * s / frameSize);
+    }
+    
+    reset();
+}
+
+void SampleTimeStretcher::reset()
+{
+    numInputSamples = 0;
+    inputStartIndex = 0;
+    analysisPosition = 0.0;
+    previousFrameStart = 0;
+    hasPreviousFrame = false;
+    numReadySamples = 0;
+    readyPosition = 0;
+    inputPosition = 0.0;
+    mOutput.clear();
+    
+    for (LagrangeInterpolator& interpolator : mInterpolators)
+    {
+        interpolator.reset();
+    }
+}
+
+void SampleTimeStretcher::setSpeed(double inSpeed)
+{
+    speed = jlimit<double>(0.5, 2.0, inSpeed);
+}
+
+void SampleTimeStretcher::setPitchShift(int inNumSemitones)
+{
+    pitchRatio = std::pow(2.0, jlimit<int>(-6, 6, inNumSemitones) / 12.0);
+}
+
+int SampleTimeStretcher::getNumInputSamplesWanted() const
+{
+    return inputCapacity - numInputSamples;
+}
+
+void SampleTimeStretcher::addInput(AudioBuffer<float> const & inBuffer, int inStartSample, int inNumSamples)
+{
+    int numSamples = jmin<int>(inNumSamples, getNumInputSamplesWanted());
+    
+    if (numSamples <= 0)
+    {
+        return;
+    }
+    
+    for (int ch = 0; ch < mInput.getNumChannels(); ch++)
+    {
+        mInput.copyFrom(ch, numInputSamples, inBuffer, jmin<int>(ch, inBuffer.getNumChannels() - 1), inStartSample, numSamples);
+    }
+    
+    // The frame search compares the mix of both channels
+    float* mix = mInputMix.getWritePointer(0, numInputSamples);
+    FloatVectorOperations::copyWithMultiply(mix, mInput.getReadPointer(0, numInputSamples), 0.5f, numSamples);
+    FloatVectorOperations::addWithMultiply(mix, mInput.getReadPointer(1, numInputSamples), 0.5f, numSamples);
+    numInputSamples += numSamples;
+}
+
+int SampleTimeStretcher::render(AudioBuffer<float>& outputBuffer, int inStartSample, int inNumSamples, float inGain)
+{
+    int numRenderedSamples = 0;
+    
+    while (numRenderedSamples < inNumSamples)
+    {
+        // The resampling can use one sample more than the pitch ratio asks for
+        int numUsableSamples = numReadySamples - readyPosition - 1;
+        int numSamples = jmin<int>(inNumSamples - numRenderedSamples, (int) (numUsableSamples / pitchRatio));
+        
+        if (numSamples <= 0)
+        {
+            if (!processFrame())
+            {
+                break;
+            }
+            
+            continue;
+        }
+        
+        int numUsedSamples = 0;
+        
+        for (int ch = 0; ch < jmin<int>(outputBuffer.getNumChannels(), (int) mInterpolators.size()); ch++)
+        {
+            numUsedSamples = mInterpolators[ch].processAdding(pitchRatio,
+                                                              mReady.getReadPointer(ch, readyPosition),
+                                                              outputBuffer.getWritePointer(ch, inStartSample + numRenderedSamples),
+                                                              numSamples,
+                                                              inGain);
+        }
+        
+        readyPosition += numUsedSamples;
+        numRenderedSamples += numSamples;
+    }
+    
+    inputPosition += numRenderedSamples * speed;
+    
+    return numRenderedSamples;
+}
+
+double SampleTimeStretcher::getInputPosition() const
+{
+    return inputPosition;
+}
+
+bool SampleTimeStretcher::processFrame()
+{
+    if (frameSize == 0)
+    {
+        return false;
+    }
+    
+    int64 nominalStart = jmax<int64>(inputStartIndex, (int64) analysisPosition);
+    int64 naturalStart = previousFrameStart + synthesisHop;
+    int64 requiredEnd = hasPreviousFrame
+    ? jmax<int64>(nominalStart + seekRange, naturalStart) + frameSize
+    : nominalStart + frameSize;
+    
+    if (requiredEnd - inputStartIndex > numInputSamples)
+    {
+        return false;
+    }
+    
+    int64 frameStart = hasPreviousFrame ? findBestFrameStart(nominalStart, naturalStart) : nominalStart;
+    int frameOffset = (int) (frameStart - inputStartIndex);
+    float* frame = mFrame.getWritePointer(0);
+    
+    for (int ch = 0; ch < mOutput.getNumChannels(); ch++)
+    {
+        FloatVectorOperations::multiply(frame, mInput.getReadPointer(ch, frameOffset), mWindow.getReadPointer(0), frameSize);
+        FloatVectorOperations::add(mOutput.getWritePointer(ch), frame, frameSize);
+    }
+    
+    // The first hop of the output won't be overlapped by any later frame, it follows the samples the resampling didn't use yet
+    int numLeftoverSamples = numReadySamples - readyPosition;
+    
+    for (int ch = 0; ch < mOutput.getNumChannels(); ch++)
+    {
+        float* output = mOutput.getWritePointer(ch);
+        float* ready = mReady.getWritePointer(ch);
+        std::memmove(ready, ready + readyPosition, (size_t) numLeftoverSamples * sizeof(float));
+        FloatVectorOperations::copy(ready + numLeftoverSamples, output, synthesisHop);
+        std::memmove(output, output + synthesisHop, (size_t) (frameSize - synthesisHop) * sizeof(float));
+        FloatVectorOperations::clear(output + frameSize - synthesisHop, synthesisHop);
+    }
+    
+    numReadySamples = numLeftoverSamples + synthesisHop;
+    readyPosition = 0;
+    previousFrameStart = frameStart;
+    hasPreviousFrame = true;
+    // Stretch by the inverse pitch ratio, so resampling by it plays the stream at the requested speed
+    analysisPosition += synthesisHop * jlimit<double>(0.5, 2.0, speed / pitchRatio);
+    
+    // Drop the input that neither the next natural continuation nor the next frame search can reach
+    int64 firstNeededIndex = jmin<int64>(previousFrameStart + synthesisHop, (int64) analysisPosition - seekRange);
+    
+    if (firstNeededIndex > inputStartIndex)
+    {
+        discardInput((int) (firstNeededIndex - inputStartIndex));
+    }
+    
+    return true;
+}
+
+int64 SampleTimeStretcher::findBestFrameStart(int64 inNominalStart, int64 inNaturalStart)
+{
+    float const * mix = mInputMix.getReadPointer(0);
+    float const * natural = mix + (inNaturalStart - inputStartIndex);
+    int64 firstStart = jmax<int64>(inputStartIndex, inNominalStart - seekRange);
+    int64 lastStart = inNominalStart + seekRange;
+    int64 bestStart = inNominalStart;
+    float bestCorrelation = std::numeric_limits<float>::lowest();
+    
+    // Search every fourth start first and refine around the best one, which keeps the cost per frame low and fixed
+    for (int64 start = firstStart; start <= lastStart; start += 4)
+    {
+        float correlation = getCorrelation(mix + (start - inputStartIndex), natural, correlationLength);
+        
+        if (correlation > bestCorrelation)
+        {
+            bestCorrelation = correlation;
+            bestStart = start;
+        }
+    }
+    
+    int64 coarseBestStart = bestStart;
+    
+    for (int64 start = jmax<int64>(firstStart, coarseBestStart - 3); start <= jmin<int64>(lastStart, coarseBestStart + 3); start++)
+    {
+        float correlation = getCorrelation(mix + (start - inputStartIndex), natural, correlationLength);
+        
+        if (correlation > bestCorrelation)
+        {
+            bestCorrelation = correlation;
+            bestStart = start;
+        }
+    }
+    
+    return bestStart;
+}
+
+void SampleTimeStretcher::discardInput(int inNumSamples)
+{
+    int numSamples = jmin<int>(inNumSamples, numInputSamples);
+    int numRemainingSamples = numInputSamples - numSamples;
+    
+    for (int ch = 0; ch < mInput.getNumChannels(); ch++)
+    {
+        float* input = mInput.getWritePointer(ch);
+        std::memmove(input, input + numSamples, (size_t) numRemainingSamples * sizeof(float));
+    }
+    
+    float* mix = mInputMix.getWritePointer(0);
+    std::memmove(mix, mix + numSamples, (size_t) numRemainingSamples * sizeof(float));
+    numInputSamples = numRemainingSamples;
+    inputStartIndex += numSamples;
+}
+
+float SampleTimeStretcher::getCorrelation(float const * inFirst, float const * inSecond, int inNumSamples)
+{
+    // Four independent sums let the compiler vectorise the loop
+    float sum0 = 0.0f;
+    float sum1 = 0.0f;
+    float sum2 = 0.0f;
+    float sum3 = 0.0f;
+    int s = 0;
+    
+    for (; s + 4 <= inNumSamples; s += 4)
+    {
+        sum0 += inFirst[s] * inSecond[s];
+        sum1 += inFirst[s + 1] * inSecond[s + 1];
+        sum2 += inFirst[s + 2] * inSecond[s + 2];
+        sum3 += inFirst[s + 3] * inSecond[s + 3];
+    }
+    
+    for (; s < inNumSamples; s++)
+    {
+        sum0 += inFirst[s] * inSecond[s];
+    }
+    
+    return sum0 + sum1 + sum2 + sum3;
+}
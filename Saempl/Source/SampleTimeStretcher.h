@@ -0,0 +1,128 @@
+/*
+ ==============================================================================
+ 
+ SampleTimeStretcher.h
+ Author:  Jonas Blome
+ 
+ ==============================================================================
+ */
+
+#pragma once
+
+#include "JuceHeader.h"
+#include <array>
+
+/**
+ Changes the playback speed and the pitch of a stereo stream independently, using waveform similarity overlap-add (WSOLA).
+ 
+ Windowed frames are taken from the input at the speed's pace and added up at a fixed hop in the output.
+ Each frame is moved by a few samples to where it best continues the previous one, which keeps the waveform free of phase jumps.
+ A pitch shift stretches the stream by the inverse of its ratio and resamples the result back to the playback speed,
+ so tempo and key are matched in the same pass.
+ All buffers are allocated in prepare and every frame costs the same, so it can run on the audio thread.
+ */
+class SampleTimeStretcher
+{
+public:
+    SampleTimeStretcher();
+    ~SampleTimeStretcher();
+    /**
+     Allocates the buffers for the given sample rate and resets the stretcher.
+     
+     @param inSampleRate the sample rate of the stream.
+     */
+    void prepare(double inSampleRate);
+    /**
+     Discards all buffered input and output, e.g. before a new stream starts.
+     */
+    void reset();
+    /**
+     Sets the playback speed.
+     
+     @param inSpeed the number of input samples played per output sample, from 0.5 to 2.0.
+     */
+    void setSpeed(double inSpeed);
+    /**
+     Sets the pitch shift.
+     
+     @param inNumSemitones the number of semitones to shift the pitch by, from -6 to 6.
+     */
+    void setPitchShift(int inNumSemitones);
+    /**
+     @returns how many input samples the stretcher can take at the moment.
+     */
+    int getNumInputSamplesWanted() const;
+    /**
+     Adds the next samples of the stream to the input.
+     
+     @param inBuffer the buffer holding the samples.
+     @param inStartSample the first sample to add.
+     @param inNumSamples the number of samples to add, at most as many as are wanted.
+     */
+    void addInput(AudioBuffer<float> const & inBuffer, int inStartSample, int inNumSamples);
+    /**
+     Adds the stretched stream to an output buffer, as far as the buffered input reaches.
+     
+     @param outputBuffer the buffer to add the stream to.
+     @param inStartSample the first sample to write.
+     @param inNumSamples the number of samples to write.
+     @param inGain the gain to apply.
+     
+     @returns the number of samples that were written.
+     */
+    int render(AudioBuffer<float>& outputBuffer, int inStartSample, int inNumSamples, float inGain);
+    /**
+     @returns how many input samples were played since the last reset.
+     */
+    double getInputPosition() const;
+    
+private:
+    AudioBuffer<float> mInput;
+    AudioBuffer<float> mInputMix;
+    AudioBuffer<float> mOutput;
+    AudioBuffer<float> mReady;
+    AudioBuffer<float> mWindow;
+    AudioBuffer<float> mFrame;
+    std::array<LagrangeInterpolator, 2> mInterpolators;
+    int frameSize;
+    int synthesisHop;
+    int seekRange;
+    int correlationLength;
+    int inputCapacity;
+    int numInputSamples;
+    int64 inputStartIndex;
+    double analysisPosition;
+    int64 previousFrameStart;
+    bool hasPreviousFrame;
+    int numReadySamples;
+    int readyPosition;
+    double speed;
+    double pitchRatio;
+    double inputPosition;
+    
+    /**
+     Adds the next frame to the output if there is enough input for it.
+     
+     @returns whether a frame was added.
+     */
+    bool processFrame();
+    /**
+     Searches the input around the nominal frame start for the frame that continues the previous one best.
+     
+     @param inNominalStart the input index the speed would place the frame at.
+     @param inNaturalStart the input index that would seamlessly continue the previous frame.
+     
+     @returns the input index of the best frame start.
+     */
+    int64 findBestFrameStart(int64 inNominalStart, int64 inNaturalStart);
+    /**
+     Removes input samples from the front of the input buffer.
+     */
+    void discardInput(int inNumSamples);
+    /**
+     @returns the cross-correlation of two signals.
+     */
+    static float getCorrelation(float const * inFirst, float const * inSecond, int inNumSamples);
+    
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(SampleTimeStretcher);
+};
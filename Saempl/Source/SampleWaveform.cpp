@@ -0,0 +1,333 @@
+/*
+ ==============================================================================
+ 
+ SampleWaveform.cpp
+ Author:  Jonas Blome
+ 
+ ==============================================================================
+ */
+
+#include "SampleWaveform.h"
+
+std::atomic<int64> SampleWaveform::numBytesWrittenSinceEviction { 0 };
+
+SampleWaveform::SampleWaveform()
+{
+    sampleRate = 0.0;
+    totalNumSamples = 0;
+    numSamplesInCurrentPeak = 0;
+}
+
+SampleWaveform::~SampleWaveform()
+{
+    
+}
+
+void SampleWaveform::reset(int inNumChannels, double inSampleRate)
+{
+    int numChannels = jlimit<int>(1, 2, inNumChannels);
+    sampleRate = inSampleRate;
+    totalNumSamples = 0;
+    numSamplesInCurrentPeak = 0;
+    mLevels.assign(1, std::vector<std::vector<Peak>>(numChannels));
+    currentPeakRanges.assign(numChannels, Range<float>());
+}
+
+void SampleWaveform::addBlock(AudioBuffer<float> const & inBuffer, int inNumSamples)
+{
+    int numChannels = (int) currentPeakRanges.size();
+    int s = 0;
+    
+    while (s < inNumSamples)
+    {
+        int numSamplesToAdd = jmin<int>(samplesPerPeak - numSamplesInCurrentPeak, inNumSamples - s);
+        
+        for (int ch = 0; ch < numChannels; ch++)
+        {
+            Range<float> blockRange = FloatVectorOperations::findMinAndMax(inBuffer.getReadPointer(jmin<int>(ch, inBuffer.getNumChannels() - 1), s),
+                                                                           numSamplesToAdd);
+            currentPeakRanges[ch] = numSamplesInCurrentPeak == 0 ? blockRange : currentPeakRanges[ch].getUnionWith(blockRange);
+        }
+        
+        numSamplesInCurrentPeak += numSamplesToAdd;
+        s += numSamplesToAdd;
+        
+        // Store the peak once its block of samples is complete
+        if (numSamplesInCurrentPeak == samplesPerPeak)
+        {
+            for (int ch = 0; ch < numChannels; ch++)
+            {
+                mLevels[0][ch].push_back(quantisePeak(currentPeakRanges[ch]));
+            }
+            
+            numSamplesInCurrentPeak = 0;
+        }
+    }
+    
+    totalNumSamples += inNumSamples;
+}
+
+void SampleWaveform::finish()
+{
+    if (mLevels.empty())
+    {
+        return;
+    }
+    
+    if (numSamplesInCurrentPeak > 0)
+    {
+        for (int ch = 0; ch < currentPeakRanges.size(); ch++)
+        {
+            mLevels[0][ch].push_back(quantisePeak(currentPeakRanges[ch]));
+        }
+        
+        numSamplesInCurrentPeak = 0;
+    }
+    
+    buildCoarserLevels();
+}
+
+bool SampleWaveform::isEmpty() const
+{
+    return mLevels.empty() || mLevels[0][0].empty();
+}
+
+double SampleWaveform::getLengthInSeconds() const
+{
+    return sampleRate > 0 ? totalNumSamples / sampleRate : 0.0;
+}
+
+SampleWaveform::Peak SampleWaveform::quantisePeak(Range<float> inRange)
+{
+    return { (int8) jlimit<int>(-127, 127, roundToInt(inRange.getStart() * 127)),
+        (int8) jlimit<int>(-127, 127, roundToInt(inRange.getEnd() * 127)) };
+}
+
+void SampleWaveform::buildCoarserLevels()
+{
+    mLevels.resize(1);
+    
+    // Halve the resolution until the level is small enough to draw the whole sample in a few pixels
+    while (mLevels.back()[0].size() > minNumPeaks)
+    {
+        std::vector<std::vector<Peak>> const & finerLevel = mLevels.back();
+        std::vector<std::vector<Peak>> coarserLevel(finerLevel.size());
+        
+        for (int ch = 0; ch < finerLevel.size(); ch++)
+        {
+            std::vector<Peak> const & finerPeaks = finerLevel[ch];
+            coarserLevel[ch].reserve((finerPeaks.size() + 1) / 2);
+            
+            for (size_t p = 0; p < finerPeaks.size(); p += 2)
+            {
+                Peak peak = finerPeaks[p];
+                
+                if (p + 1 < finerPeaks.size())
+                {
+                    peak.minimum = jmin<int8>(peak.minimum, finerPeaks[p + 1].minimum);
+                    peak.maximum = jmax<int8>(peak.maximum, finerPeaks[p + 1].maximum);
+                }
+                
+                coarserLevel[ch].push_back(peak);
+            }
+        }
+        
+        mLevels.push_back(std::move(coarserLevel));
+    }
+}
+
+void SampleWaveform::drawChannels(Graphics& g, Rectangle<int> inArea, double inStartTime, double inEndTime) const
+{
+    if (isEmpty() || inArea.isEmpty() || inEndTime <= inStartTime)
+    {
+        return;
+    }
+    
+    // Find the coarsest level that still has at least one peak per pixel
+    double samplesPerPixel = (inEndTime - inStartTime) * sampleRate / inArea.getWidth();
+    int level = 0;
+    
+    while (level + 1 < mLevels.size() && ((int64) samplesPerPeak << (level + 1)) <= samplesPerPixel)
+    {
+        level++;
+    }
+    
+    double peaksPerSecond = sampleRate / ((int64) samplesPerPeak << level);
+    double secondsPerPixel = (inEndTime - inStartTime) / inArea.getWidth();
+    int numChannels = (int) mLevels[level].size();
+    float channelHeight = inArea.getHeight() * 1.0f / numChannels;
+    
+    for (int ch = 0; ch < numChannels; ch++)
+    {
+        std::vector<Peak> const & peaks = mLevels[level][ch];
+        float halfChannelHeight = channelHeight * 0.5f;
+        float channelCentreY = inArea.getY() + channelHeight * ch + halfChannelHeight;
+        
+        for (int x = 0; x < inArea.getWidth(); x++)
+        {
+            double pixelStartTime = inStartTime + x * secondsPerPixel;
+            int firstPeak = jmax<int>(0, (int) (pixelStartTime * peaksPerSecond));
+            int lastPeak = jmin<int>((int) peaks.size(), jmax<int>(firstPeak + 1, (int) std::ceil((pixelStartTime + secondsPerPixel) * peaksPerSecond)));
+            
+            // The visible range reaches past the end of the sample
+            if (firstPeak >= lastPeak)
+            {
+                break;
+            }
+            
+            int minimum = peaks[firstPeak].minimum;
+            int maximum = peaks[firstPeak].maximum;
+            
+            for (int p = firstPeak + 1; p < lastPeak; p++)
+            {
+                minimum = jmin<int>(minimum, peaks[p].minimum);
+                maximum = jmax<int>(maximum, peaks[p].maximum);
+            }
+            
+            float top = channelCentreY - maximum / 127.0f * halfChannelHeight;
+            float height = jmax<float>(1.0f, (maximum - minimum) / 127.0f * halfChannelHeight);
+            g.fillRect(Rectangle<float>(inArea.getX() + x, top, 1.0f, height));
+        }
+    }
+}
+
+File SampleWaveform::getCacheDirectory()
+{
+    return File((File::getSpecialLocation(File::userMusicDirectory)).getFullPathName()
+                + DIRECTORY_SEPARATOR
+                + "Plugins"
+                + DIRECTORY_SEPARATOR
+                + "Saempl"
+                + DIRECTORY_SEPARATOR
+                + "WaveformCache");
+}
+
+File SampleWaveform::getCacheFile(File const & inSampleFile)
+{
+    String filePath = inSampleFile.getFullPathName();
+#if JUCE_MAC
+    filePath = filePath.convertToPrecomposedUnicode();
+#endif
+    String cacheKey = filePath + String(inSampleFile.getLastModificationTime().toMilliseconds());
+    
+    return getCacheDirectory().getChildFile(String::toHexString(cacheKey.hashCode64()) + ".waveform");
+}
+
+void SampleWaveform::saveToCache(File const & inSampleFile) const
+{
+    if (isEmpty())
+    {
+        return;
+    }
+    
+    File cacheFile = getCacheFile(inSampleFile);
+    cacheFile.getParentDirectory().createDirectory();
+    std::vector<std::vector<Peak>> const & finestLevel = mLevels[0];
+    
+    // Write to a temporary file first, so the preview never reads a half written waveform
+    TemporaryFile temporaryFile(cacheFile);
+    
+    {
+        FileOutputStream stream(temporaryFile.getFile());
+        
+        if (!stream.openedOk())
+        {
+            return;
+        }
+        
+        stream.writeInt(fileFormatVersion);
+        stream.writeDouble(sampleRate);
+        stream.writeInt64(totalNumSamples);
+        stream.writeInt((int) finestLevel.size());
+        stream.writeInt((int) finestLevel[0].size());
+        
+        for (std::vector<Peak> const & peaks : finestLevel)
+        {
+            stream.write(peaks.data(), peaks.size() * sizeof(Peak));
+        }
+    }
+    
+    temporaryFile.overwriteTargetFileWithTemporary();
+    
+    // Only the thread that resets the count evicts, the others keep analysing
+    int64 numBytesWritten = (int64) (finestLevel.size() * finestLevel[0].size() * sizeof(Peak));
+    
+    if (numBytesWrittenSinceEviction.fetch_add(numBytesWritten) + numBytesWritten >= evictionInterval
+        && numBytesWrittenSinceEviction.exchange(0) >= evictionInterval)
+    {
+        evictCache();
+    }
+}
+
+bool SampleWaveform::loadFromCache(File const & inSampleFile)
+{
+    File cacheFile = getCacheFile(inSampleFile);
+    FileInputStream stream(cacheFile);
+    
+    if (!stream.openedOk() || stream.readInt() != fileFormatVersion)
+    {
+        return false;
+    }
+    
+    double newSampleRate = stream.readDouble();
+    int64 newTotalNumSamples = stream.readInt64();
+    int numChannels = stream.readInt();
+    int numPeaks = stream.readInt();
+    
+    if (numChannels < 1 || numChannels > 2 || numPeaks <= 0 || stream.getNumBytesRemaining() != (int64) (numChannels * numPeaks * sizeof(Peak)))
+    {
+        return false;
+    }
+    
+    std::vector<std::vector<Peak>> finestLevel(numChannels, std::vector<Peak>(numPeaks));
+    
+    for (std::vector<Peak>& peaks : finestLevel)
+    {
+        stream.read(peaks.data(), (int) (numPeaks * sizeof(Peak)));
+    }
+    
+    sampleRate = newSampleRate;
+    totalNumSamples = newTotalNumSamples;
+    numSamplesInCurrentPeak = 0;
+    currentPeakRanges.assign(numChannels, Range<float>());
+    mLevels.assign(1, std::move(finestLevel));
+    buildCoarserLevels();
+    
+    // Mark the waveform as recently used for the eviction
+    cacheFile.setLastAccessTime(Time::getCurrentTime());
+    
+    return true;
+}
+
+void SampleWaveform::evictCache()
+{
+    numBytesWrittenSinceEviction = 0;
+    Array<File> cacheFiles = getCacheDirectory().findChildFiles(File::findFiles, false, "*.waveform");
+    int64 cacheSize = 0;
+    
+    for (File const & cacheFile : cacheFiles)
+    {
+        cacheSize += cacheFile.getSize();
+    }
+    
+    if (cacheSize <= cacheBudget)
+    {
+        return;
+    }
+    
+    std::sort(cacheFiles.begin(), cacheFiles.end(), [](auto const & a, auto const & b)
+    {
+        return a.getLastAccessTime() < b.getLastAccessTime();
+    });
+    
+    for (File const & cacheFile : cacheFiles)
+    {
+        if (cacheSize <= cacheBudget)
+        {
+            break;
+        }
+        
+        cacheSize -= cacheFile.getSize();
+        cacheFile.deleteFile();
+    }
+}
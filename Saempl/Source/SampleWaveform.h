@@ -0,0 +1,125 @@
+/*
+ ==============================================================================
+ 
+ SampleWaveform.h
+ Author:  Jonas Blome
+ 
+ ==============================================================================
+ */
+
+#pragma once
+
+#include "JuceHeader.h"
+#include "BlomeHelpers.h"
+
+/**
+ A compact overview of a sample's waveform for drawing it without decoding the audio file.
+ 
+ Holds the minimum and maximum level of every block of samples in a pyramid of resolutions,
+ where each level has half as many peaks as the level before.
+ The finest level is cached on disk, so the overview is only computed once during the sample analysis.
+ */
+class SampleWaveform
+{
+public:
+    SampleWaveform();
+    ~SampleWaveform();
+    /**
+     Clears the waveform to collect the peaks of a new sample.
+     
+     @param inNumChannels the number of channels of the sample, only the first two are kept.
+     @param inSampleRate the sample rate of the sample.
+     */
+    void reset(int inNumChannels, double inSampleRate);
+    /**
+     Adds the next block of the sample to the finest level of the waveform.
+     
+     @param inBuffer the buffer holding the block.
+     @param inNumSamples the number of valid samples in the buffer.
+     */
+    void addBlock(AudioBuffer<float> const & inBuffer, int inNumSamples);
+    /**
+     Stores the last unfinished peak and computes the coarser levels of the pyramid.
+     */
+    void finish();
+    /**
+     @returns whether the waveform holds any peaks.
+     */
+    bool isEmpty() const;
+    /**
+     @returns the length of the sample in seconds.
+     */
+    double getLengthInSeconds() const;
+    /**
+     Draws the channels of the waveform below each other, using the coarsest level that still has a peak for every pixel.
+     
+     @param g the graphics object.
+     @param inArea the area to draw the waveform in.
+     @param inStartTime the time in seconds at the left edge of the area.
+     @param inEndTime the time in seconds at the right edge of the area.
+     */
+    void drawChannels(Graphics& g, Rectangle<int> inArea, double inStartTime, double inEndTime) const;
+    /**
+     Writes the waveform to the disk cache.
+     Evicts the least recently used waveforms once enough were written since the last eviction,
+     so analyses outside a library synchronisation keep the cache within its budget as well.
+     
+     @param inSampleFile the sample file the waveform belongs to.
+     */
+    void saveToCache(File const & inSampleFile) const;
+    /**
+     Loads the waveform of a sample file from the disk cache.
+     
+     @param inSampleFile the sample file to load the waveform for.
+     
+     @returns whether an up to date waveform of the file was cached.
+     */
+    bool loadFromCache(File const & inSampleFile);
+    /**
+     Deletes the least recently used waveforms until the disk cache fits into its budget.
+     */
+    static void evictCache();
+    
+private:
+    /**
+     The quantised minimum and maximum level of a block of samples.
+     */
+    struct Peak
+    {
+        int8 minimum;
+        int8 maximum;
+    };
+    
+    // Indexed by level, channel and peak
+    std::vector<std::vector<std::vector<Peak>>> mLevels;
+    std::vector<Range<float>> currentPeakRanges;
+    double sampleRate;
+    int64 totalNumSamples;
+    int numSamplesInCurrentPeak;
+    static int const samplesPerPeak = 256;
+    static int const minNumPeaks = 16;
+    static int const fileFormatVersion = 1;
+    static int64 const cacheBudget = 256 * 1024 * 1024;
+    static int64 const evictionInterval = cacheBudget / 16;
+    // Shared by the analysis threads that write waveforms
+    static std::atomic<int64> numBytesWrittenSinceEviction;
+    
+    /**
+     @returns the directory that holds the cached waveforms.
+     */
+    static File getCacheDirectory();
+    /**
+     @returns the cache file of a sample file, which changes whenever the sample file is modified.
+     */
+    static File getCacheFile(File const & inSampleFile);
+    /**
+     Quantises a level range to a peak.
+     */
+    static Peak quantisePeak(Range<float> inRange);
+    /**
+     Rebuilds all levels of the pyramid from the finest level.
+     */
+    void buildCoarserLevels();
+    
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(SampleWaveform);
+};